@@ -16,12 +16,13 @@
 
 #include "Common_DebugPrint.h"
 #include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
 #include "Logging_public.h"
 
 #define BATTERY_SENSE      "/dev/lpadc0"
 
-#define BUFFER_NUM         (4)
-#define BUFFER_SIZE        (16 * 1024)
+#define BUFFER_NUM         (2)
+#define BUFFER_SIZE        (32 * 1024)
 #define BATTERY_RECORD_NUM ((BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)) / sizeof(uint16_t))
 
 #define getreg32(a) (*(volatile uint32_t *) (a))
@@ -32,13 +33,16 @@ typedef struct tagBatteryLogBuffer_t {
     LogFooter_t footer;
 } BatteryLogBuffer_t;
 static_assert(sizeof(BatteryLogBuffer_t) == BUFFER_SIZE, "BatteryLogBuffer_t size mismatch");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "BatteryLogBuffer_t must be a whole number of clusters");
 
 typedef struct tagBatteryLogging_t {
-    uint32_t      seqId;
-    LoggingDesc_t logdesc;
+    uint32_t              seqId;
+    uint32_t              overrun;
+    Logging_Buffer_Desc_t logdesc;
+    Logging_Pool_t        pool;
 } BatteryLogging_t;
 
-static BatteryLogBuffer_t batteryLogging_buffer[BUFFER_NUM];
+static BatteryLogBuffer_t batteryLogging_buffer[BUFFER_NUM] LOGGING_BUFFER_ALIGNED;
 static BatteryLogging_t batteryLogging_instance;
 
 static BatteryLogging_t* GetInstance(void)
@@ -46,10 +50,17 @@ static BatteryLogging_t* GetInstance(void)
     return &batteryLogging_instance;
 }
 
+static void ReleaseBuffer(void* ptr)
+{
+    BatteryLogging_t* self = GetInstance();
+
+    Logging_Pool_Release(&self->pool, ptr);
+}
+
 void Battery_Logging_Run(void)
 {
     BatteryLogging_t* self = GetInstance();
-    mqd_t mq = Logging_OpenQueue(false);
+    LoggingQueue_t mq = Logging_OpenQueue(false);
 
     self->seqId = 0;
     int errval = 0;
@@ -80,11 +91,28 @@ void Battery_Logging_Run(void)
         return 2;
     }
 
-    uint32_t seqId = 0;
+    Logging_Pool_Init(&self->pool, batteryLogging_buffer, sizeof(BatteryLogBuffer_t), BUFFER_NUM);
+    self->overrun = 0;
+
     while (true) {
-        BatteryLogBuffer_t* buff = &batteryLogging_buffer[seqId % BUFFER_NUM];
-        Logging_Buffer_Init(&self->logdesc, LoggingUser_POWER, seqId, buff, sizeof(BatteryLogBuffer_t));
-        seqId++;
+        BatteryLogBuffer_t* buff = Logging_Pool_Acquire(&self->pool);
+        if (buff == NULL) {
+            /** @note 空き Buffer が無い間も FIFO を読み捨て，落としたサイズを次の Block に記録する． */
+            uint16_t discard[32];
+            ssize_t nbytes = read(fd, discard, sizeof(discard));
+            up_mdelay(100);
+            if (nbytes < 0) {
+                errval = errno;
+                PRINT_ERROR("read failed:%d", errval);
+                break;
+            }
+            self->overrun += nbytes;
+            continue;
+        }
+        Logging_Buffer_Init(&self->logdesc, LoggingUser_POWER, self->seqId, self->overrun, buff,
+            sizeof(BatteryLogBuffer_t));
+        self->seqId++;
+        self->overrun = 0;
         while (true) {
             /* read data */
             uint16_t* val       = Logging_Buffer_GetNextPos(&self->logdesc);
@@ -117,11 +145,12 @@ void Battery_Logging_Run(void)
         desc.type = LoggingType_WRITE;
         desc.user = LoggingUser_POWER;
         desc.ptr  = buff;
-        desc.size = sizeof(BatteryLogBuffer_t);
+        desc.size     = sizeof(BatteryLogBuffer_t);
+        desc.callback = ReleaseBuffer;
         PRINT_DEBUG("Writing data: type=%x user=%x ptr=%x size=%x callback=%p\n", desc.type, desc.user,
             desc.ptr, desc.size, desc.callback);
 
-        Logging_SendQueue(mq, &desc);
+        Logging_Buffer_Send(mq, &desc, &self->overrun);
     } /* Battery_Logging_Run */
 
     /* Stop A/D conversion */
@@ -20,11 +20,13 @@
 #include <arch/chip/scu.h>
 #include <arch/chip/adc.h>
 #include "Battery_Logging.h"
+#include "Common_Sched.h"
 
 #define BATTERY_SENSE    "/dev/lpadc2"
 
 int main(int argc, char *argv[])
 {
+    Common_Sched_Apply(Common_SchedTask_BATTERY);
     Battery_Logging_Run();    
     return 0;
 }
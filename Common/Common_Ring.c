@@ -0,0 +1,125 @@
+#include "Common_Ring.h"
+
+#include <string.h>
+#include <time.h>
+
+/**
+ * @note head と tail は剰余を取らない通し番号で，Slot は番号 & mask．差が Slot の数に達すると満杯．
+ *       書き込み側は Slot を埋めてから head を release で進め，読み出し側は head を acquire で読んでから Slot を読む．
+ *       読み出し側は Slot を読み終えてから tail を release で進め，書き込み側は tail を acquire で読んでから Slot を上書きする．
+ *       SMP で割り込みハンドラと読み出しタスクが別の CPU で動いても，Slot の中身は番号と対で見える．
+ *       満杯の時は新しい要素を捨てる．古い要素を捨てるには tail を進める必要があり，書き込み側が 1 つである前提が崩れる．
+ */
+
+/**
+ * @param slots    elementSize * numSlots バイトの領域
+ * @param numSlots 2 の冪
+ */
+bool Common_Ring_Init(Common_Ring_t* ring, void* slots, uint32_t elementSize, uint32_t numSlots)
+{
+    if (numSlots == 0 || (numSlots & (numSlots - 1)) != 0 || elementSize == 0) {
+        return false;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overflowCount, 0);
+    ring->mask        = numSlots - 1;
+    ring->elementSize = elementSize;
+    ring->slots       = slots;
+    sem_init(&ring->smph, 0, 0);
+#ifdef SEM_PRIO_NONE
+    /** @note 通知用の semaphore は優先度継承を無効にする (NuttX のみ)． */
+    sem_setprotocol(&ring->smph, SEM_PRIO_NONE);
+#endif
+    return true;
+}
+
+void Common_Ring_Destroy(Common_Ring_t* ring)
+{
+    sem_destroy(&ring->smph);
+}
+
+/**
+ * @brief 要素を 1 つ書き込み，読み出し側を起こす
+ *
+ * @note 割り込みハンドラから呼べる．
+ *
+ * @return 満杯のため捨てた場合 false
+ */
+bool Common_Ring_Push(Common_Ring_t* ring, const void* element)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail > ring->mask) {
+        atomic_store_explicit(&ring->overflowCount,
+            atomic_load_explicit(&ring->overflowCount, memory_order_relaxed) + 1, memory_order_relaxed);
+        return false;
+    }
+    memcpy(ring->slots + (head & ring->mask) * ring->elementSize, element, ring->elementSize);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    sem_post(&ring->smph);
+    return true;
+}
+
+/**
+ * @brief 要素を 1 つ読み出す．待たない．
+ *
+ * @return 空の場合 false
+ */
+bool Common_Ring_Pop(Common_Ring_t* ring, void* element)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+    memcpy(element, ring->slots + (tail & ring->mask) * ring->elementSize, ring->elementSize);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Push または Common_Ring_Wakeup() を待つ
+ *
+ * @note Push 1 回につき 1 回起きる．起きても Ring が空の場合 (Wakeup，先にまとめて読み出した分) がある．
+ *
+ * @param timeoutMs COMMON_RING_WAIT_FOREVER で無期限
+ *
+ * @return timeout またはシグナルで中断した場合 false
+ */
+bool Common_Ring_Wait(Common_Ring_t* ring, int32_t timeoutMs)
+{
+    if (timeoutMs < 0) {
+        return sem_wait(&ring->smph) == 0;
+    }
+
+    struct timespec abstime;
+    clock_gettime(CLOCK_MONOTONIC, &abstime);
+    abstime.tv_sec  += timeoutMs / 1000;
+    abstime.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (abstime.tv_nsec >= 1000000000L) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000L;
+    }
+    return sem_clockwait(&ring->smph, CLOCK_MONOTONIC, &abstime) == 0;
+}
+
+/**
+ * @brief 要素を書き込まずに読み出し側を起こす (停止の通知等)
+ */
+void Common_Ring_Wakeup(Common_Ring_t* ring)
+{
+    sem_post(&ring->smph);
+}
+
+/**
+ * @note 読み出し側から呼ぶ．pushCount は呼び出し時点までに書き込まれた数．
+ */
+void Common_Ring_GetStatistics(Common_Ring_t* ring, Common_Ring_Statistics_t* stats)
+{
+    stats->pushCount     = atomic_load_explicit(&ring->head, memory_order_acquire);
+    stats->popCount      = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    stats->overflowCount = atomic_load_explicit(&ring->overflowCount, memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#include "Common_Sched.h"
+
+#include <nuttx/config.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * @brief 全タスクの CPU，優先度，スタックサイズの計画
+ *
+ * @note CPU1 は IMU の取得スレッドに渡し，SD への書き込みを含む他のタスクは CPU0 にまとめる．
+ *       優先度は IMU の取得 > 電源ボタン > 書き込み > GNSS > PPS の同期 > 書き込みの補助 > 電池 > Trace の出力 の順とする．
+ *       タスクのスタックサイズは起動時に決まるため，各 Makefile の PRIORITY，STACKSIZE をこの表と合わせる．
+ */
+static const Common_SchedPlan_t common_Sched_plan[Common_SchedTask_NUM] = {
+    [Common_SchedTask_POWERCTRL]       = { "PowerCtrl",       0, 120, 2048 },
+    [Common_SchedTask_LOGGING]         = { "Logging",         0, 110, 2048 },
+    [Common_SchedTask_LOGGING_ROTATOR] = { "Logging rotator", 0,  90, 2048 },
+    [Common_SchedTask_LOGGING_TRACE]   = { "Logging trace",   0,  60, 3072 },
+    [Common_SchedTask_GNSS]            = { "Gnss",            0, 100, 2048 },
+    [Common_SchedTask_GNSS_PPS]        = { "Gnss PPS",        0,  95, 2048 },
+    [Common_SchedTask_BATTERY]         = { "Battery",         0,  80, 2048 },
+    [Common_SchedTask_IMU]             = { "Imu",             0, 100, 2048 },
+    [Common_SchedTask_IMU_ACQUISITION] = { "Imu acquisition", 1, 150, 2048 },
+};
+
+const Common_SchedPlan_t* Common_Sched_GetPlan(Common_SchedTask_e task)
+{
+    return &common_Sched_plan[task];
+}
+
+/**
+ * @brief 呼び出したタスクを計画の CPU に固定し，優先度を設定する
+ *
+ * @note 各タスクの main の先頭で呼ぶ．以後に作るスレッドは固定した CPU を引き継ぐ．
+ */
+int Common_Sched_Apply(Common_SchedTask_e task)
+{
+    const Common_SchedPlan_t* plan = Common_Sched_GetPlan(task);
+    struct sched_param param;
+    int ret = OK;
+
+#ifdef CONFIG_SMP
+    if (plan->cpu != COMMON_SCHED_CPU_ANY) {
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(plan->cpu, &cpuset);
+        if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+            printf("ERROR: Failed to pin %s to CPU%d.\n", plan->name, plan->cpu);
+            ret = ERROR;
+        }
+    }
+#endif
+
+    param.sched_priority = plan->priority;
+    if (sched_setparam(0, &param) != 0) {
+        printf("ERROR: Failed to set %s priority %d.\n", plan->name, plan->priority);
+        ret = ERROR;
+    }
+
+    return ret;
+}
+
+void Common_Sched_Print(void)
+{
+    for (int task = 0; task < Common_SchedTask_NUM; ++task) {
+        const Common_SchedPlan_t* plan = Common_Sched_GetPlan(task);
+
+        if (plan->cpu == COMMON_SCHED_CPU_ANY) {
+            printf("%-16s any CPU  priority:%3d stack:%d\n", plan->name, plan->priority, plan->stackSize);
+        } else {
+            printf("%-16s CPU%d     priority:%3d stack:%d\n", plan->name, plan->cpu, plan->priority,
+                plan->stackSize);
+        }
+    }
+}
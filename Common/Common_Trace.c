@@ -0,0 +1,132 @@
+#include "Common_Trace.h"
+
+#include <assert.h>
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "Common_Rtc.h"
+
+#define TRACE_RING_SIZE (128) /* Records, power of two */
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+
+typedef struct tagCommon_TraceSlot_t {
+    atomic_uint          seq; /* Sequence minus the slot index, so that zero-initialized slots are empty */
+    Common_TraceRecord_t record;
+} Common_TraceSlot_t;
+
+/**
+ * @brief 全タスク共有の Trace の Ring
+ *
+ * @note Flat build では全タスクが同じ領域を使う．書き込みは複数 (任意のタスク・CPU)，読み出しは 1 つ (Drain タスク)．
+ *       Slot 毎の seq で状態を表す (空: pos，書き込み済み: pos + 1，読み出し済み: pos + TRACE_RING_SIZE)．
+ *       書き込み側は head を CAS で進めて Slot を確保し，埋めた後に seq を release で公開する．
+ *       Lock も待ち合わせも無く，空きが無ければ捨てて dropped を数える．
+ */
+typedef struct tagCommon_Trace_t {
+    atomic_uint        head;
+    uint32_t           tail;
+    atomic_uint        writeCount;
+    atomic_uint        dropCount;
+    Common_TraceSlot_t slots[TRACE_RING_SIZE];
+} Common_Trace_t;
+
+static Common_Trace_t common_Trace_instance;
+
+static Common_Trace_t* GetInstance(void)
+{
+    return &common_Trace_instance;
+}
+
+static uint32_t LoadSeq(Common_TraceSlot_t* slot, uint32_t index)
+{
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) + index;
+}
+
+static void StoreSeq(Common_TraceSlot_t* slot, uint32_t index, uint32_t seq)
+{
+    atomic_store_explicit(&slot->seq, seq - index, memory_order_release);
+}
+
+/**
+ * @brief Record を Ring に書き込む
+ *
+ * @note COMMON_TRACE() から呼ぶ．割り込みハンドラからも呼べる．
+ */
+void Common_Trace_Write(Common_TraceId_e id, uint32_t numArgs, const Common_TraceArg_t* args)
+{
+    Common_Trace_t* self = GetInstance();
+    uint32_t pos = atomic_load_explicit(&self->head, memory_order_relaxed);
+    Common_TraceSlot_t* slot;
+
+    for (;;) {
+        slot = &self->slots[pos % TRACE_RING_SIZE];
+        int32_t diff = (int32_t) (LoadSeq(slot, pos % TRACE_RING_SIZE) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&self->head, &pos, pos + 1, memory_order_relaxed,
+                memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&self->dropCount, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&self->head, memory_order_relaxed);
+        }
+    }
+
+    Common_TraceRecord_t* record = &slot->record;
+    if (numArgs > COMMON_TRACE_MAX_ARGS) {
+        numArgs = COMMON_TRACE_MAX_ARGS;
+    }
+    record->id      = id;
+    record->numArgs = numArgs;
+#ifdef CONFIG_SMP
+    record->cpu     = up_cpu_index();
+#else
+    record->cpu     = 0;
+#endif
+    record->dropped = atomic_load_explicit(&self->dropCount, memory_order_relaxed);
+    record->time    = Common_Rtc_GetCount(Common_RtcChannel_1);
+    memcpy(record->args, args, numArgs * sizeof(args[0]));
+    atomic_fetch_add_explicit(&self->writeCount, 1, memory_order_relaxed);
+
+    StoreSeq(slot, pos % TRACE_RING_SIZE, pos + 1);
+} /* Common_Trace_Write */
+
+/**
+ * @brief 書き込み済みの Record を古い順に取り出す
+ *
+ * @note 読み出しは 1 つのタスクからのみ行う．確保済みで書き込み中の Slot があればその手前で止める．
+ *
+ * @return 取り出した Record 数
+ */
+uint32_t Common_Trace_Read(Common_TraceRecord_t* records, uint32_t maxRecords)
+{
+    Common_Trace_t* self = GetInstance();
+    uint32_t num = 0;
+
+    while (num < maxRecords) {
+        uint32_t index = self->tail % TRACE_RING_SIZE;
+        Common_TraceSlot_t* slot = &self->slots[index];
+
+        if (LoadSeq(slot, index) != self->tail + 1) {
+            break;
+        }
+        records[num++] = slot->record;
+        StoreSeq(slot, index, self->tail + TRACE_RING_SIZE);
+        self->tail++;
+    }
+
+    return num;
+}
+
+void Common_Trace_GetStatistics(Common_Trace_Statistics_t* stats)
+{
+    Common_Trace_t* self = GetInstance();
+
+    stats->writeCount = atomic_load_explicit(&self->writeCount, memory_order_relaxed);
+    stats->dropCount  = atomic_load_explicit(&self->dropCount, memory_order_relaxed);
+}
@@ -0,0 +1,83 @@
+#include "Common_Trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FORMAT_SPEC_LENGTH (16)
+
+static const char* const common_Trace_formats[Common_TraceId_NUM] = {
+#define COMMON_TRACE_FORMAT(id, format) format,
+    COMMON_TRACE_CATALOG(COMMON_TRACE_FORMAT)
+#undef COMMON_TRACE_FORMAT
+};
+
+/**
+ * @brief Record を Catalog の書式で文字列にする
+ *
+ * @note Drain タスクとホスト用のツールで共用するため，libc の書式化のみを使う．
+ *       変換指定を 1 つずつ取り出し，長さ修飾子を除いて引数の型に合わせた snprintf に渡す．
+ *
+ * @return 書き出した文字数 (終端を除く)
+ */
+int Common_Trace_Format(const Common_TraceRecord_t* record, char* buff, uint32_t size)
+{
+    const char* format;
+    uint32_t len = 0;
+    uint32_t arg = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (record->id >= Common_TraceId_NUM) {
+        return snprintf(buff, size, "unknown trace id:%u", record->id);
+    }
+
+    format = common_Trace_formats[record->id];
+    while (*format != '\0' && len + 1 < size) {
+        if (*format != '%') {
+            buff[len++] = *format++;
+            continue;
+        }
+
+        char spec[FORMAT_SPEC_LENGTH];
+        uint32_t specLen = 0;
+
+        spec[specLen++] = *format++;
+        while (*format != '\0' && strchr("-+ #0123456789.", *format) != NULL && specLen < FORMAT_SPEC_LENGTH - 2) {
+            spec[specLen++] = *format++;
+        }
+        while (*format != '\0' && strchr("hlLqjzt", *format) != NULL) {
+            format++;
+        }
+        char conversion = *format;
+        if (conversion == '\0') {
+            break;
+        }
+        format++;
+        spec[specLen++] = conversion;
+        spec[specLen]   = '\0';
+
+        int ret;
+        Common_TraceArg_t value = { 0 };
+        if (conversion != '%') {
+            if (arg < record->numArgs) {
+                value = record->args[arg];
+            }
+            arg++;
+        }
+        if (strchr("fFeEgG", conversion) != NULL) {
+            ret = snprintf(buff + len, size - len, spec, value.d);
+        } else if (strchr("diuxXoc", conversion) != NULL) {
+            ret = snprintf(buff + len, size - len, spec, (int) value.i);
+        } else {
+            ret = snprintf(buff + len, size - len, "%s", conversion == '%' ? "%" : "?");
+        }
+        if (ret < 0) {
+            break;
+        }
+        len += (uint32_t) ret < size - len ? (uint32_t) ret : size - len - 1;
+    }
+    buff[len] = '\0';
+
+    return len;
+} /* Common_Trace_Format */
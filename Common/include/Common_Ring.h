@@ -0,0 +1,41 @@
+#ifndef COMMON_RING_H
+#define COMMON_RING_H
+
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COMMON_RING_WAIT_FOREVER (-1)
+
+/**
+ * @brief 割り込みハンドラからタスクへ固定長の要素を渡す Ring
+ *
+ * @note 書き込み (Push) は 1 つ (割り込みハンドラまたは 1 タスク)，読み出し (Pop) も 1 つのタスクに限る．
+ *       Slot の数は 2 の冪．要素と Slot の領域は呼び出し側が用意する．
+ */
+typedef struct tagCommon_Ring_t {
+    atomic_uint head;          /* Written by the producer only */
+    atomic_uint tail;          /* Written by the consumer only */
+    atomic_uint overflowCount; /* Pushes dropped because the ring was full */
+    uint32_t    mask;
+    uint32_t    elementSize;
+    uint8_t*    slots;
+    sem_t       smph;
+} Common_Ring_t;
+
+typedef struct tagCommon_Ring_Statistics_t {
+    uint32_t pushCount;
+    uint32_t popCount;
+    uint32_t overflowCount;
+} Common_Ring_Statistics_t;
+
+bool Common_Ring_Init(Common_Ring_t* ring, void* slots, uint32_t elementSize, uint32_t numSlots);
+void Common_Ring_Destroy(Common_Ring_t* ring);
+bool Common_Ring_Push(Common_Ring_t* ring, const void* element);
+bool Common_Ring_Pop(Common_Ring_t* ring, void* element);
+bool Common_Ring_Wait(Common_Ring_t* ring, int32_t timeoutMs);
+void Common_Ring_Wakeup(Common_Ring_t* ring);
+void Common_Ring_GetStatistics(Common_Ring_t* ring, Common_Ring_Statistics_t* stats);
+
+#endif /* COMMON_RING_H */
@@ -10,5 +10,6 @@ typedef enum tagCommon_RtcChannel_e {
 
 uint64_t Common_Rtc_GetCountUninterruptible(Common_RtcChannel_e channel);
 uint64_t Common_Rtc_GetCount(Common_RtcChannel_e channel);
+uint64_t Common_Rtc_GetCountByCapture(Common_RtcChannel_e channel);
 
 #endif /* COMMON_RTC_H */
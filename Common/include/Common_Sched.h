@@ -0,0 +1,32 @@
+#ifndef COMMON_SCHED_H
+#define COMMON_SCHED_H
+
+#include <stdint.h>
+
+#define COMMON_SCHED_CPU_ANY (-1) /* Leave the task free to run on any CPU */
+
+typedef enum tagCommon_SchedTask_e {
+    Common_SchedTask_POWERCTRL,
+    Common_SchedTask_LOGGING,
+    Common_SchedTask_LOGGING_ROTATOR,
+    Common_SchedTask_LOGGING_TRACE,
+    Common_SchedTask_GNSS,
+    Common_SchedTask_GNSS_PPS,
+    Common_SchedTask_BATTERY,
+    Common_SchedTask_IMU,
+    Common_SchedTask_IMU_ACQUISITION,
+    Common_SchedTask_NUM,
+} Common_SchedTask_e;
+
+typedef struct tagCommon_SchedPlan_t {
+    const char* name;
+    int         cpu;       /* COMMON_SCHED_CPU_ANY or a CPU number */
+    int         priority;
+    int         stackSize; /* Tasks: must match STACKSIZE in the Makefile */
+} Common_SchedPlan_t;
+
+const Common_SchedPlan_t* Common_Sched_GetPlan(Common_SchedTask_e task);
+int  Common_Sched_Apply(Common_SchedTask_e task);
+void Common_Sched_Print(void);
+
+#endif /* COMMON_SCHED_H */
@@ -0,0 +1,71 @@
+#ifndef COMMON_TRACE_H
+#define COMMON_TRACE_H
+
+#include <stdint.h>
+
+#include "Common_TraceCatalog.h"
+
+#define COMMON_TRACE_MAX_ARGS (8)
+
+typedef enum tagCommon_TraceId_e {
+#define COMMON_TRACE_ID(id, format) Common_TraceId_##id,
+    COMMON_TRACE_CATALOG(COMMON_TRACE_ID)
+#undef COMMON_TRACE_ID
+    Common_TraceId_NUM,
+} Common_TraceId_e;
+
+/** @note 整数は符号拡張，float は double に広げて 1 引数 8 バイトで保存する． */
+typedef union tagCommon_TraceArg_t {
+    int64_t i;
+    double  d;
+} Common_TraceArg_t;
+
+typedef struct tagCommon_TraceRecord_t {
+    uint16_t          id;      /* Common_TraceId_e */
+    uint8_t           numArgs;
+    uint8_t           cpu;
+    uint32_t          dropped; /* Records dropped (ring full) since start, up to this one */
+    uint64_t          time;    /* RTC count */
+    Common_TraceArg_t args[COMMON_TRACE_MAX_ARGS];
+} Common_TraceRecord_t;
+
+typedef struct tagCommon_Trace_Statistics_t {
+    uint32_t writeCount;
+    uint32_t dropCount;
+} Common_Trace_Statistics_t;
+
+#define COMMON_TRACE_ARG(x)                         \
+        _Generic((x),                               \
+        float: (Common_TraceArg_t) { .d = (x) },    \
+        double: (Common_TraceArg_t) { .d = (x) },   \
+        default: (Common_TraceArg_t) { .i = (int64_t) (x) })
+
+#define COMMON_TRACE_NARGS(...)    COMMON_TRACE_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define COMMON_TRACE_NARGS_(a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+#define COMMON_TRACE_MAP_1(x)      COMMON_TRACE_ARG(x)
+#define COMMON_TRACE_MAP_2(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_1(__VA_ARGS__)
+#define COMMON_TRACE_MAP_3(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_2(__VA_ARGS__)
+#define COMMON_TRACE_MAP_4(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_3(__VA_ARGS__)
+#define COMMON_TRACE_MAP_5(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_4(__VA_ARGS__)
+#define COMMON_TRACE_MAP_6(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_5(__VA_ARGS__)
+#define COMMON_TRACE_MAP_7(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_6(__VA_ARGS__)
+#define COMMON_TRACE_MAP_8(x, ...) COMMON_TRACE_ARG(x), COMMON_TRACE_MAP_7(__VA_ARGS__)
+#define COMMON_TRACE_MAP_(n, ...)  COMMON_TRACE_MAP_##n(__VA_ARGS__)
+#define COMMON_TRACE_MAP(n, ...)   COMMON_TRACE_MAP_(n, __VA_ARGS__)
+
+/**
+ * @brief 書式化を行わずに Trace を記録する
+ *
+ * @note COMMON_TRACE(GNSS_READ, i, ret) のように Common_TraceCatalog.h の ID と 1〜8 個の引数を渡す．
+ *       引数は整数か浮動小数点のみ．文字列やポインタは渡さない．
+ */
+#define COMMON_TRACE(id, ...)                                                        \
+        Common_Trace_Write(Common_TraceId_##id, COMMON_TRACE_NARGS(__VA_ARGS__),     \
+        (const Common_TraceArg_t[]) { COMMON_TRACE_MAP(COMMON_TRACE_NARGS(__VA_ARGS__), __VA_ARGS__) })
+
+void     Common_Trace_Write(Common_TraceId_e id, uint32_t numArgs, const Common_TraceArg_t* args);
+uint32_t Common_Trace_Read(Common_TraceRecord_t* records, uint32_t maxRecords);
+int      Common_Trace_Format(const Common_TraceRecord_t* record, char* buff, uint32_t size);
+void     Common_Trace_GetStatistics(Common_Trace_Statistics_t* stats);
+
+#endif /* COMMON_TRACE_H */
@@ -0,0 +1,18 @@
+#ifndef COMMON_TRACECATALOG_H
+#define COMMON_TRACECATALOG_H
+
+/**
+ * @brief Trace の呼び出し箇所の一覧
+ *
+ * @note X(ID, format) の順が Common_TraceId_e の値になり，ログに残る．既存の行の順は変えず，末尾に追加する．
+ *       format の変換は d, i, u, x, X, c (整数) と f, e, g (浮動小数点) のみ．長さ修飾子は無視する．
+ */
+#define COMMON_TRACE_CATALOG(X)                                                 \
+        X(GNSS_READ,     "gnss idx:%u read %d bytes")                           \
+        X(GNSS_POSITION, "gnss lat:%.6f lon:%.6f alt:%.2f")                     \
+        X(GNSS_TIME,     "gnss time:%d-%02d-%02d %02d:%02d:%02d.%06d")          \
+        X(IMU_TIMEOUT,   "imu%d poll timeout after %dms, last timestamp:%u")    \
+        X(GNSS_PVTLOG,   "gnss pvtlog read %u fixes, total:%u")             \
+        X(GNSS_PPS,      "pps pin:%u capture:%u")
+
+#endif /* COMMON_TRACECATALOG_H */
@@ -0,0 +1,363 @@
+#include "Gnss_Compact.h"
+
+#include <string.h>
+
+/**
+ * @note ホストのデコーダからもそのままビルドするため，NuttX 依存のヘッダを含めないこと．
+ *
+ * 測位結果の大半の Field (DOP，日付，衛星系の bitmap 等) は Record 毎にはほとんど変わらず，
+ * タイムスタンプや時刻は一定間隔で進む．予測と一致した Field は bitmap の 1 bit だけになる．
+ */
+
+#define NUM_GROUPS(numFields) (((numFields) + 7) / 8)
+
+static uint64_t ZigZag(uint64_t value)
+{
+    return (value << 1) ^ (uint64_t) ((int64_t) value >> 63);
+}
+
+static uint64_t UnZigZag(uint64_t value)
+{
+    return (value >> 1) ^ (uint64_t) -(int64_t) (value & 1);
+}
+
+static uint32_t GetVarintLength(uint64_t value)
+{
+    uint32_t length = 1;
+
+    while (value >= 0x80) {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+static uint8_t* WriteVarint(uint8_t* ptr, uint64_t value)
+{
+    while (value >= 0x80) {
+        *ptr++  = (uint8_t) value | 0x80;
+        value >>= 7;
+    }
+    *ptr++ = (uint8_t) value;
+    return ptr;
+}
+
+static const uint8_t* ReadVarint(const uint8_t* ptr, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for (uint32_t shift = 0; shift < 64 && ptr < end; shift += 7) {
+        uint8_t byte = *ptr++;
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t GetMask(const GnssCompact_Field_t* field)
+{
+    return field->size >= 8 ? UINT64_MAX : ((uint64_t) 1 << (field->size * 8)) - 1;
+}
+
+static uint64_t LoadField(const GnssCompact_Field_t* field, const uint8_t* record)
+{
+    uint64_t value = 0;
+
+    memcpy(&value, record + field->offset, field->size);
+    return value;
+}
+
+static void StoreField(const GnssCompact_Field_t* field, uint8_t* record, uint64_t value)
+{
+    memcpy(record + field->offset, &value, field->size);
+}
+
+static uint64_t Predict(const Gnss_Compact_State_t* state, const GnssCompact_Field_t* field)
+{
+    uint64_t prev = LoadField(field, state->prev);
+
+    if (field->kind == GnssCompact_Kind_LINEAR && state->numHistory >= 2) {
+        return (2 * prev - LoadField(field, state->prev2)) & GetMask(field);
+    }
+    return prev;
+}
+
+/**
+ * @brief 予測との差を ZigZag 変換した値を求める．差は Field の幅で符号拡張する．
+ */
+static uint64_t GetResidual(const Gnss_Compact_State_t* state, const GnssCompact_Field_t* field, const uint8_t* record)
+{
+    uint64_t delta = (LoadField(field, record) - Predict(state, field)) & GetMask(field);
+    uint32_t bits  = field->size * 8;
+
+    if (bits < 64 && (delta >> (bits - 1)) != 0) {
+        delta |= ~GetMask(field);
+    }
+    return ZigZag(delta);
+}
+
+static void PushHistory(Gnss_Compact_State_t* state, const void* record)
+{
+    memcpy(state->prev2, state->prev, state->recordSize);
+    memcpy(state->prev, record, state->recordSize);
+    if (state->numHistory < 2) {
+        state->numHistory++;
+    }
+}
+
+static bool AddField(Gnss_Compact_State_t* state, uint32_t offset, uint32_t size, uint8_t kind)
+{
+    if (state->numFields >= GNSS_COMPACT_MAX_FIELDS) {
+        return false;
+    }
+    GnssCompact_Field_t* field = &state->fields[state->numFields++];
+    field->offset = offset;
+    field->size   = size;
+    field->kind   = kind;
+    return true;
+}
+
+/**
+ * @brief offset から size バイトを 4 バイト単位の Field に分割して追加する
+ */
+static bool AddLanes(Gnss_Compact_State_t* state, uint32_t offset, uint32_t size, uint8_t kind)
+{
+    while (size > 0) {
+        uint32_t lane = size >= sizeof(uint32_t) && offset % sizeof(uint32_t) == 0 ? sizeof(uint32_t) : 1;
+        if (!AddField(state, offset, lane, kind)) {
+            return false;
+        }
+        offset += lane;
+        size   -= lane;
+    }
+    return true;
+}
+
+/**
+ * @brief Record の Field の表を作る
+ *
+ * @param fields 予測方法を指定する Field．offset の昇順で重ならないこと．
+ *               8 バイトを超える Field (構造体) は 4 バイト単位に分け，表に無い隙間は HOLD で埋める．
+ *
+ * @retval false Field の表が不正，または Record が大きすぎる
+ */
+bool Gnss_Compact_Init(Gnss_Compact_State_t* state, uint32_t user, uint32_t recordSize,
+    const GnssCompact_Field_t* fields, uint32_t numFields)
+{
+    uint32_t offset = 0;
+
+    if (recordSize == 0 || recordSize > GNSS_COMPACT_MAX_RECORD_SIZE) {
+        return false;
+    }
+    memset(state, 0, sizeof(*state));
+    state->recordSize = recordSize;
+    state->user       = user;
+
+    for (uint32_t i = 0; i < numFields; ++i) {
+        const GnssCompact_Field_t* field = &fields[i];
+
+        if (field->offset < offset || field->offset + field->size > recordSize || field->size == 0) {
+            return false;
+        }
+        bool isAdded = AddLanes(state, offset, field->offset - offset, GnssCompact_Kind_HOLD);
+        if (field->size <= sizeof(uint64_t)) {
+            isAdded = isAdded && AddField(state, field->offset, field->size, field->kind);
+        } else {
+            isAdded = isAdded && AddLanes(state, field->offset, field->size, field->kind);
+        }
+        if (!isAdded) {
+            return false;
+        }
+        offset = field->offset + field->size;
+    }
+    return AddLanes(state, offset, recordSize - offset, GnssCompact_Kind_HOLD);
+} /* Gnss_Compact_Init */
+
+uint32_t Gnss_Compact_GetFormatSize(const Gnss_Compact_State_t* state)
+{
+    return sizeof(GnssCompact_Format_t) + state->numFields * sizeof(GnssCompact_Field_t);
+}
+
+/**
+ * @brief Block の先頭に置く Format と Field の表を書く
+ *
+ * @note numRecords は 0 で書く．Block を送る前に呼び出し側が更新する．
+ * @return 書いたバイト数
+ */
+uint32_t Gnss_Compact_WriteFormat(const Gnss_Compact_State_t* state, void* dst)
+{
+    GnssCompact_Format_t format = { 0 };
+
+    format.recordSize = state->recordSize;
+    format.numFields  = state->numFields;
+    format.user       = state->user;
+    memcpy(dst, &format, sizeof(format));
+    memcpy((uint8_t *) dst + sizeof(format), state->fields, state->numFields * sizeof(GnssCompact_Field_t));
+    return Gnss_Compact_GetFormatSize(state);
+}
+
+/**
+ * @brief Block の先頭の Format と Field の表を読み，復号の状態を初期化する
+ *
+ * @return 消費したバイト数，不正な場合は -1
+ */
+int32_t Gnss_Compact_ReadFormat(Gnss_Compact_State_t* state, const void* src, uint32_t size, uint32_t* numRecords)
+{
+    GnssCompact_Format_t format;
+
+    if (size < sizeof(format)) {
+        return -1;
+    }
+    memcpy(&format, src, sizeof(format));
+    if (format.recordSize == 0 || format.recordSize > GNSS_COMPACT_MAX_RECORD_SIZE
+        || format.numFields > GNSS_COMPACT_MAX_FIELDS
+        || size < sizeof(format) + format.numFields * sizeof(GnssCompact_Field_t)) {
+        return -1;
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->recordSize = format.recordSize;
+    state->numFields  = format.numFields;
+    state->user       = format.user;
+    memcpy(state->fields, (const uint8_t *) src + sizeof(format), format.numFields * sizeof(GnssCompact_Field_t));
+    for (uint32_t i = 0; i < state->numFields; ++i) {
+        const GnssCompact_Field_t* field = &state->fields[i];
+        if (field->size == 0 || field->size > sizeof(uint64_t) || field->offset + field->size > state->recordSize) {
+            return -1;
+        }
+    }
+
+    *numRecords = format.numRecords;
+    return Gnss_Compact_GetFormatSize(state);
+}
+
+/**
+ * @brief 次の Record を KEY にする
+ *
+ * @note 新しい Block を始める毎に呼ぶ．
+ */
+void Gnss_Compact_Reset(Gnss_Compact_State_t* state)
+{
+    state->numHistory = 0;
+}
+
+/**
+ * @brief 1 Record を符号化する
+ *
+ * @param dst GNSS_COMPACT_MAX_ENCODED_BYTES 以上の領域
+ * @return 符号化後のバイト数
+ *
+ * @note DELTA が元の Record より大きくなる場合は KEY にする．
+ */
+uint32_t Gnss_Compact_EncodeRecord(Gnss_Compact_State_t* state, const void* record, uint8_t* dst)
+{
+    uint32_t numGroups = NUM_GROUPS(state->numFields);
+    uint32_t length    = 1 + (numGroups + 7) / 8;
+
+    if (state->numHistory > 0) {
+        uint32_t group = UINT32_MAX;
+
+        for (uint32_t i = 0; i < state->numFields && length <= state->recordSize; ++i) {
+            uint64_t residual = GetResidual(state, &state->fields[i], record);
+            if (residual != 0) {
+                length += (i / 8 != group) ? 1 + GetVarintLength(residual) : GetVarintLength(residual);
+                group   = i / 8;
+            }
+        }
+    }
+
+    if (state->numHistory == 0 || length > state->recordSize) {
+        dst[0] = GNSS_COMPACT_FRAME_KEY;
+        memcpy(dst + 1, record, state->recordSize);
+        PushHistory(state, record);
+        return 1 + state->recordSize;
+    }
+
+    uint8_t* groupBitmap = dst + 1;
+    uint8_t* ptr         = groupBitmap + (numGroups + 7) / 8;
+
+    dst[0] = GNSS_COMPACT_FRAME_DELTA;
+    memset(groupBitmap, 0, ptr - groupBitmap);
+    for (uint32_t group = 0; group < numGroups; ++group) {
+        uint8_t* fieldBitmap = ptr;
+        uint32_t end         = (group + 1) * 8 < state->numFields ? (group + 1) * 8 : state->numFields;
+
+        *ptr++ = 0;
+        for (uint32_t i = group * 8; i < end; ++i) {
+            uint64_t residual = GetResidual(state, &state->fields[i], record);
+            if (residual != 0) {
+                *fieldBitmap |= 1 << (i % 8);
+                ptr = WriteVarint(ptr, residual);
+            }
+        }
+        if (*fieldBitmap != 0) {
+            groupBitmap[group / 8] |= 1 << (group % 8);
+        } else {
+            ptr--;
+        }
+    }
+    PushHistory(state, record);
+
+    return ptr - dst;
+} /* Gnss_Compact_EncodeRecord */
+
+/**
+ * @brief 1 Record を復号する
+ *
+ * @param size src の残りバイト数
+ * @return 消費したバイト数，src が足りないか不正な場合は -1
+ */
+int32_t Gnss_Compact_DecodeRecord(Gnss_Compact_State_t* state, const uint8_t* src, uint32_t size, void* record)
+{
+    const uint8_t* end = src + size;
+    uint32_t numGroups = NUM_GROUPS(state->numFields);
+
+    if (size < 1) {
+        return -1;
+    }
+    if (src[0] == GNSS_COMPACT_FRAME_KEY) {
+        if (size < 1 + state->recordSize) {
+            return -1;
+        }
+        memcpy(record, src + 1, state->recordSize);
+        PushHistory(state, record);
+        return 1 + state->recordSize;
+    }
+    if (src[0] != GNSS_COMPACT_FRAME_DELTA || state->numHistory == 0 || size < 1 + (numGroups + 7) / 8) {
+        return -1;
+    }
+
+    const uint8_t* groupBitmap = src + 1;
+    const uint8_t* ptr         = groupBitmap + (numGroups + 7) / 8;
+    uint8_t* dst               = record;
+
+    for (uint32_t i = 0; i < state->numFields; ++i) {
+        StoreField(&state->fields[i], dst, Predict(state, &state->fields[i]));
+    }
+    for (uint32_t group = 0; group < numGroups; ++group) {
+        if ((groupBitmap[group / 8] & (1 << (group % 8))) == 0) {
+            continue;
+        }
+        if (ptr >= end) {
+            return -1;
+        }
+        uint8_t fieldBitmap = *ptr++;
+        for (uint32_t bit = 0; bit < 8; ++bit) {
+            uint32_t i = group * 8 + bit;
+            uint64_t residual;
+
+            if ((fieldBitmap & (1 << bit)) == 0) {
+                continue;
+            }
+            if (i >= state->numFields || (ptr = ReadVarint(ptr, end, &residual)) == NULL) {
+                return -1;
+            }
+            const GnssCompact_Field_t* field = &state->fields[i];
+            StoreField(field, dst, (LoadField(field, dst) + UnZigZag(residual)) & GetMask(field));
+        }
+    }
+    PushHistory(state, record);
+
+    return ptr - src;
+} /* Gnss_Compact_DecodeRecord */
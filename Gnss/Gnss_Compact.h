@@ -0,0 +1,30 @@
+#ifndef GNSS_COMPACT_H
+#define GNSS_COMPACT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Gnss_Compact_public.h"
+
+#define GNSS_COMPACT_MAX_ENCODED_BYTES (1 + GNSS_COMPACT_MAX_RECORD_SIZE)
+
+typedef struct tagGnss_Compact_State_t {
+    uint32_t            recordSize;
+    uint32_t            numFields;
+    uint32_t            user;
+    uint32_t            numHistory; /* Records since the last key frame, up to 2 */
+    GnssCompact_Field_t fields[GNSS_COMPACT_MAX_FIELDS];
+    uint8_t             prev[GNSS_COMPACT_MAX_RECORD_SIZE];
+    uint8_t             prev2[GNSS_COMPACT_MAX_RECORD_SIZE];
+} Gnss_Compact_State_t;
+
+bool     Gnss_Compact_Init(Gnss_Compact_State_t* state, uint32_t user, uint32_t recordSize,
+    const GnssCompact_Field_t* fields, uint32_t numFields);
+uint32_t Gnss_Compact_GetFormatSize(const Gnss_Compact_State_t* state);
+uint32_t Gnss_Compact_WriteFormat(const Gnss_Compact_State_t* state, void* dst);
+int32_t  Gnss_Compact_ReadFormat(Gnss_Compact_State_t* state, const void* src, uint32_t size, uint32_t* numRecords);
+void     Gnss_Compact_Reset(Gnss_Compact_State_t* state);
+uint32_t Gnss_Compact_EncodeRecord(Gnss_Compact_State_t* state, const void* record, uint8_t* dst);
+int32_t  Gnss_Compact_DecodeRecord(Gnss_Compact_State_t* state, const uint8_t* src, uint32_t size, void* record);
+
+#endif /* GNSS_COMPACT_H */
@@ -4,8 +4,10 @@
 #include <arch/chip/gnss.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <nuttx/config.h>
 #include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
 
@@ -14,8 +16,13 @@
 #include <nuttx/irq.h>
 
 #include "Common_DebugPrint.h"
+#include "Common_Ring.h"
 #include "Common_Rtc.h"
+#include "Common_Sched.h"
+#include "Common_Trace.h"
+#include "Gnss_Sync.h"
 #include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
 #include "Logging_public.h"
 
 #define CXD56_INTC_BASE   0xe0045000
@@ -24,26 +31,57 @@
 #define putreg32(v, a) (*(volatile uint32_t *) (a) = (v))
 #define getreg32(a)    (*(volatile uint32_t *) (a))
 
+#define PPS_RING_SIZE  (32)
+#define NUM_BUFFERS    (2)
+#define BUFFER_SIZE    (32 * 1024)
+
+#define PPS_PRIORITY   (Common_Sched_GetPlan(Common_SchedTask_GNSS_PPS)->priority)
+#define PPS_STACK_SIZE (Common_Sched_GetPlan(Common_SchedTask_GNSS_PPS)->stackSize)
+
+typedef struct tagGnssSyncLogBuffer_t {
+    LogHeader_t header;
+    uint8_t     body[BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)];
+    LogFooter_t footer;
+} GnssSyncLogBuffer_t;
+static_assert(sizeof(GnssSyncLogBuffer_t) == BUFFER_SIZE, "GnssSyncLogBuffer_t size mismatch");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "GnssSyncLogBuffer_t must be a whole number of clusters");
+
 typedef enum tagIntEdge_e {
     IntEdge_RISING = 0,
     IntEdge_FALLING,
 } IntEdge_e;
 
+/**
+ * @brief PPS と測位結果の時刻から RTC と GPS 時刻の関係を推定する
+ *
+ * @note 割り込みで PPS の立ち上がりの RTC (Common_RtcChannel_1) を捉え，同期スレッドを起こす．
+ *       Gnss タスクは測位結果を受け取る毎に Gnss_Pps_SetTime() で GPS 時刻を渡す．
+ *       同期スレッドは両者を Gnss_Sync で対応付け，推定したモデルを LoggingUser_SYNCHRONIZE の Record として残す．
+ */
 typedef struct tagGnss_Pps_t {
-    IntEdge_e edge;
-    uint32_t  head;
-    uint32_t  tail;
-    sem_t     smph;
-    uint64_t  times[32];
-    uint64_t  count;
-    time_t    time;
+    IntEdge_e             edge;
+    Common_Ring_t         ring;
+    uint64_t              times[PPS_RING_SIZE];
+    volatile bool         isRunning;
+    pthread_t             thread;
+    pthread_mutex_t       mutex;
+    bool                  isFixPending;
+    int64_t               fixGpsSec;
+    uint32_t              fixUsec;
+    uint64_t              fixRtc;
+    Gnss_Sync_t           sync;
+    LoggingQueue_t        mq;
+    bool                  isOpen;
+    uint32_t              seqId;
+    uint32_t              overrun;
+    Logging_Buffer_Desc_t logdesc;
+    Logging_Pool_t        pool;
 } Gnss_Pps_t;
 
+static GnssSyncLogBuffer_t gnssPps_buffer[NUM_BUFFERS] LOGGING_BUFFER_ALIGNED;
 static Gnss_Pps_t gnssPps_instance = {
     .edge  = IntEdge_RISING,
-    .head  = 0,
-    .tail  = 0,
-    .times = { 0 },
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
 };
 
 static Gnss_Pps_t* GetGnssPpsInstance(void)
@@ -57,10 +95,12 @@ static int pps_handler(int irq, void* context, void* arg)
     uint32_t pin     = (uint32_t) (uintptr_t) arg;
 
     if (self->edge == IntEdge_RISING) {
-        self->times[self->head] = Common_Rtc_GetCountByCapture(Common_RtcChannel_0);
-        self->head++;
-        PRINT_DEBUG("PPS: %d %llu", pin, self->times[self->head]);
-        self->head %= 32;
+        uint64_t count = Common_Rtc_GetCountByCapture(Common_RtcChannel_1);
+
+        if (self->isRunning) {
+            Common_Ring_Push(&self->ring, &count);
+        }
+        COMMON_TRACE(GNSS_PPS, pin, (uint32_t) count);
     }
 
     self->edge ^= 1;
@@ -83,8 +123,7 @@ int Gnss_Pps_Init(void)
 {
     Gnss_Pps_t* self = GetGnssPpsInstance();
 
-    sem_init(&self->smph, 0, 0);
-    sem_setprotocol(&self->smph, SEM_PRIO_NONE);
+    Common_Ring_Init(&self->ring, self->times, sizeof(self->times[0]), PPS_RING_SIZE);
 
     // irq_attach(CXD56_IRQ_GPS_OR, pps_handler, NULL);
     // up_enable_irq(CXD56_IRQ_GPS_OR);
@@ -106,35 +145,181 @@ int Gnss_Pps_Init(void)
     // printf("GNSS PPS initialized %x %x %x\n", getreg32(0x04100818), getreg32(0x4102014), getreg32(0x041007C0));
     // board_gpio_config(PIN_HIF_IRQ_OUT, 0, true, false, PIN_PULLDOWN);
     // board_gpio_intconfig(PIN_HIF_IRQ_OUT, INT_HIGH_LEVEL, false, pps_handler);
+    return OK;
 }
 
-int Gnss_Pps_SetTime(time_t time)
+/**
+ * @brief 測位結果の GPS 時刻を同期スレッドに渡す
+ *
+ * @param rtc 測位結果を受け取った時の Common_RtcChannel_1 のカウント
+ *
+ * @note 測位できている (2D/3D) 結果についてのみ呼ぶ．同期スレッドが動いていない場合は何もしない．
+ */
+int Gnss_Pps_SetTime(const struct cxd56_gnss_date_s* date, const struct cxd56_gnss_time_s* time, uint64_t rtc)
 {
     Gnss_Pps_t* self = GetGnssPpsInstance();
-    irqstate_t flags;
 
-    self->count = Common_Rtc_GetCount(Common_RtcChannel_0);
-    self->time  = time;
-    return 0;
+    if (!self->isRunning) {
+        return ERROR;
+    }
+
+    pthread_mutex_lock(&self->mutex);
+    self->fixGpsSec    = Gnss_Sync_ToGpsSeconds(date->year, date->month, date->day, time->hour, time->minute,
+        time->sec);
+    self->fixUsec      = time->usec;
+    self->fixRtc       = rtc;
+    self->isFixPending = true;
+    pthread_mutex_unlock(&self->mutex);
+
+    Common_Ring_Wakeup(&self->ring);
+    return OK;
 }
 
-int Gnss_Pps_main(void)
+static void ReleaseBuffer(void* ptr)
 {
     Gnss_Pps_t* self = GetGnssPpsInstance();
-    int ret;
 
-    while (true) {
-        ret = sem_wait(&self->smph);
-        if (ret < 0) {
-            return ret;
+    Logging_Pool_Release(&self->pool, ptr);
+}
+
+static void SendBlock(Gnss_Pps_t* self)
+{
+    Logging_Buffer_Finalize(&self->logdesc);
+    LoggingDesc_t desc = { 0 };
+    desc.ptr      = self->logdesc.header;
+    desc.user     = LoggingUser_SYNCHRONIZE;
+    desc.type     = LoggingType_WRITE;
+    desc.size     = sizeof(GnssSyncLogBuffer_t);
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &self->overrun);
+    self->isOpen = false;
+    self->seqId++;
+}
+
+static void WriteRecord(Gnss_Pps_t* self, GnssSync_Record_t* record)
+{
+    if (!self->isOpen) {
+        GnssSyncLogBuffer_t* buffer = Logging_Pool_Acquire(&self->pool);
+        if (buffer == NULL) {
+            self->overrun += sizeof(*record);
+            return;
         }
+        Logging_Buffer_Init(&self->logdesc, LoggingUser_SYNCHRONIZE, self->seqId, self->overrun, buffer,
+            sizeof(GnssSyncLogBuffer_t));
+        self->overrun = 0;
+        self->isOpen  = true;
+    }
+    Logging_Buffer_Write(&self->logdesc, record, sizeof(*record));
+    if (Logging_Buffer_GetRemainingSize(&self->logdesc) < sizeof(*record)) {
+        SendBlock(self);
+    }
+}
+
+/**
+ * @brief 割り込みで捉えた PPS を取り出す
+ *
+ * @note 同期スレッドが PPS_RING_SIZE 秒以上遅れた場合は新しい PPS が捨てられ，Ring の overflowCount に残る．
+ */
+static void DrainEdges(Gnss_Pps_t* self)
+{
+    uint64_t count;
+
+    while (Common_Ring_Pop(&self->ring, &count)) {
+        Gnss_Sync_AddEdge(&self->sync, count);
+    }
+}
+
+static void* Gnss_Pps_Run(void* arg)
+{
+    Gnss_Pps_t* self = arg;
+    GnssSync_Record_t record;
 
-        if (self->edge == IntEdge_RISING) {
-            uint64_t count = self->times[self->tail];
-            self->tail++;
-            self->tail %= 32;
+    while (self->isRunning) {
+        Common_Ring_Wait(&self->ring, COMMON_RING_WAIT_FOREVER);
+        DrainEdges(self);
+
+        pthread_mutex_lock(&self->mutex);
+        bool isFixPending  = self->isFixPending;
+        int64_t gpsSec     = self->fixGpsSec;
+        uint32_t usec      = self->fixUsec;
+        uint64_t rtc       = self->fixRtc;
+        self->isFixPending = false;
+        pthread_mutex_unlock(&self->mutex);
+
+        if (isFixPending && Gnss_Sync_AddFix(&self->sync, gpsSec, usec, rtc, &record)) {
+            WriteRecord(self, &record);
         }
     }
 
+    /** @note 最後の状態を残してから Block を送る． */
+    if (self->sync.numUpdates >= 2) {
+        Gnss_Sync_GetRecord(&self->sync, &record);
+        WriteRecord(self, &record);
+    }
+    if (self->isOpen) {
+        SendBlock(self);
+    }
+    Common_Ring_Statistics_t stats;
+    Common_Ring_GetStatistics(&self->ring, &stats);
+    PRINT_INFO("PPS edges:%u lost:%u pairs:%u rejected:%u drift:%.3fppm rms:%uns\n", stats.pushCount,
+        stats.overflowCount, self->sync.pairCount, self->sync.rejectCount, self->sync.drift * 1e6,
+        (uint32_t) (sqrt(self->sync.meanSquare) * 1e9));
+    return NULL;
+}
+
+/**
+ * @brief 同期スレッドを起動する
+ *
+ * @param mq Gnss タスクの Queue．Record の Block はここへ送る
+ */
+int Gnss_Pps_Start(LoggingQueue_t mq)
+{
+    Gnss_Pps_t* self = GetGnssPpsInstance();
+
+    self->mq      = mq;
+    self->isOpen  = false;
+    self->seqId   = 0;
+    self->overrun = 0;
+    Gnss_Sync_Init(&self->sync);
+
+    /** @note 前回の Stop 後に割り込みが書き込んだ PPS は GPS 時刻と対応付けられないため読み捨てる． */
+    uint64_t count;
+    while (Common_Ring_Pop(&self->ring, &count)) {
+    }
+    Logging_Pool_Init(&self->pool, gnssPps_buffer, sizeof(GnssSyncLogBuffer_t), NUM_BUFFERS);
+    Logging_Buffer_SetOptions(&self->logdesc, Logging_BufferOption_DEFERRED_CRC);
+    Logging_Buffer_SetRecordSize(&self->logdesc, sizeof(GnssSync_Record_t));
+
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, PPS_STACK_SIZE);
+    param.sched_priority = PPS_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    self->isRunning = true;
+    int ret = pthread_create(&self->thread, &attr, Gnss_Pps_Run, self);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        PRINT_ERROR("Failed to create PPS thread: %d\n", ret);
+        self->isRunning = false;
+        return ERROR;
+    }
     return OK;
 }
+
+/**
+ * @brief 同期スレッドを止め，残りの Record を送る
+ */
+void Gnss_Pps_Stop(void)
+{
+    Gnss_Pps_t* self = GetGnssPpsInstance();
+
+    if (!self->isRunning) {
+        return;
+    }
+    self->isRunning = false;
+    Common_Ring_Wakeup(&self->ring);
+    pthread_join(self->thread, NULL);
+}
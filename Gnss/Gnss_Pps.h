@@ -1,6 +1,14 @@
 #ifndef GNSS_PPS_H
 #define GNSS_PPS_H
 
-int Gnss_Pps_Init(void);
+#include <arch/chip/gnss.h>
+#include <stdint.h>
+
+#include "Logging_public.h"
+
+int  Gnss_Pps_Init(void);
+int  Gnss_Pps_Start(LoggingQueue_t mq);
+void Gnss_Pps_Stop(void);
+int  Gnss_Pps_SetTime(const struct cxd56_gnss_date_s* date, const struct cxd56_gnss_time_s* time, uint64_t rtc);
 
 #endif /* GNSS_PPS_H */
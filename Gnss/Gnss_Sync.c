@@ -0,0 +1,169 @@
+#include "Gnss_Sync.h"
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * @note ホストで検証できるよう，NuttX 依存のヘッダを含めないこと．
+ *
+ * PPS の立ち上がりは GPS 時刻の整秒に一致する．秒 S の測位結果は秒 S の PPS の後，秒 S+1 の PPS の前に届くため，
+ * 測位結果が届いた時点で 1 秒以内に捉えた最新の PPS を秒 S と対応付ける．
+ * 対応付けた (RTC，GPS 秒) の組から，位相 (推定 GPS 時刻と整秒の差) と RTC の周波数のずれを
+ * 等速モデルの alpha-beta フィルタで推定する．利得は最小二乗と同じ重みの拡大記憶から始め，
+ * GNSS_SYNC_MEMORY 組に達した後は一定 (定常の Kalman フィルタ) にする．
+ */
+
+#define GNSS_SYNC_MEMORY          (64)    /* Pairs after which the gains stop shrinking */
+#define GNSS_SYNC_RECORD_INTERVAL (10)    /* Pairs between records */
+#define GNSS_SYNC_REJECT_SEC      (0.002) /* Residual beyond which a pair is an outlier */
+#define GNSS_SYNC_MAX_REJECTS     (5)     /* Consecutive outliers that restart the model */
+#define GNSS_SYNC_MAX_GAP_SEC     (600)   /* Longer gaps without a pair restart the model */
+#define GNSS_SYNC_GPS_EPOCH_DAYS  (3657)  /* 1980-01-06 in days since 1970-01-01 */
+
+void Gnss_Sync_Init(Gnss_Sync_t* sync)
+{
+    memset(sync, 0, sizeof(*sync));
+}
+
+/**
+ * @brief PPS の立ち上がりの RTC のカウントを追加する
+ */
+void Gnss_Sync_AddEdge(Gnss_Sync_t* sync, uint64_t rtc)
+{
+    if (sync->numEdges == GNSS_SYNC_MAX_EDGES) {
+        memmove(&sync->edges[0], &sync->edges[1], (GNSS_SYNC_MAX_EDGES - 1) * sizeof(sync->edges[0]));
+        sync->numEdges--;
+    }
+    sync->edges[sync->numEdges++] = rtc;
+}
+
+static void Restart(Gnss_Sync_t* sync, uint64_t rtc, int64_t gpsSec)
+{
+    sync->isLocked           = true;
+    sync->lastRtc            = rtc;
+    sync->lastGpsSec         = gpsSec;
+    sync->phase              = 0;
+    sync->drift              = 0;
+    sync->meanSquare         = 0;
+    sync->numUpdates         = 0;
+    sync->consecutiveRejects = 0;
+    sync->sinceRecord        = 0;
+    sync->flags             |= GNSS_SYNC_FLAG_RESET;
+}
+
+void Gnss_Sync_GetRecord(const Gnss_Sync_t* sync, GnssSync_Record_t* record)
+{
+    memset(record, 0, sizeof(*record));
+    record->rtc         = sync->lastRtc;
+    record->gpsTimeNs   = sync->lastGpsSec * 1000000000LL + llround(sync->phase * 1e9);
+    record->driftPpm    = (float) (sync->drift * 1e6);
+    record->rmsNs       = (uint32_t) (sqrt(sync->meanSquare) * 1e9);
+    record->pairCount   = sync->pairCount;
+    record->rejectCount = sync->rejectCount > UINT16_MAX ? UINT16_MAX : sync->rejectCount;
+    record->flags       = sync->flags;
+}
+
+/**
+ * @brief PPS と GPS 秒の組でモデルを更新する
+ *
+ * @return 更新した場合 true
+ */
+static bool Update(Gnss_Sync_t* sync, uint64_t rtc, int64_t gpsSec)
+{
+    double interval = (double) (int64_t) (rtc - sync->lastRtc) / GNSS_SYNC_RTC_HZ;
+
+    if (!sync->isLocked || interval <= 0 || interval > GNSS_SYNC_MAX_GAP_SEC) {
+        Restart(sync, rtc, gpsSec);
+        sync->pairCount++;
+        return true;
+    }
+
+    /** @note 予測した位相と，PPS が整秒であることから分かる位相 0 との差を残差とする． */
+    double predicted = (double) (sync->lastGpsSec - gpsSec) + sync->phase + interval * (1.0 + sync->drift);
+    double residual  = -predicted;
+
+    if (sync->numUpdates >= 2 && fabs(residual) > GNSS_SYNC_REJECT_SEC) {
+        sync->rejectCount++;
+        if (++sync->consecutiveRejects >= GNSS_SYNC_MAX_REJECTS) {
+            Restart(sync, rtc, gpsSec);
+            sync->pairCount++;
+            return true;
+        }
+        return false;
+    }
+    sync->consecutiveRejects = 0;
+
+    if (sync->numUpdates < GNSS_SYNC_MEMORY) {
+        sync->numUpdates++;
+    }
+    double n     = sync->numUpdates;
+    double alpha = 2.0 * (2.0 * n + 1.0) / ((n + 2.0) * (n + 1.0));
+    double beta  = 6.0 / ((n + 2.0) * (n + 1.0));
+
+    sync->phase       = predicted + alpha * residual;
+    sync->drift      += beta * residual / interval;
+    sync->meanSquare += (residual * residual - sync->meanSquare) / (n < 16 ? n : 16);
+    sync->lastRtc     = rtc;
+    sync->lastGpsSec  = gpsSec;
+    sync->pairCount++;
+    return true;
+} /* Update */
+
+/**
+ * @brief 測位結果の GPS 時刻を PPS と対応付けてモデルを更新する
+ *
+ * @param gpsSec 測位結果の GPS 時刻の秒 (Gnss_Sync_ToGpsSeconds())
+ * @param usec   測位結果の GPS 時刻の秒未満．0.5 秒以上は次の秒に丸める
+ * @param rtc    測位結果を受け取った時の RTC のカウント
+ * @param record 記録する Record
+ *
+ * @return record を記録する場合 true
+ */
+bool Gnss_Sync_AddFix(Gnss_Sync_t* sync, int64_t gpsSec, uint32_t usec, uint64_t rtc, GnssSync_Record_t* record)
+{
+    int32_t match = -1;
+
+    for (int32_t i = sync->numEdges - 1; i >= 0; --i) {
+        if (sync->edges[i] <= rtc) {
+            if (rtc - sync->edges[i] < GNSS_SYNC_RTC_HZ) {
+                match = i;
+            }
+            break;
+        }
+    }
+    if (match < 0) {
+        return false;
+    }
+
+    uint64_t edge = sync->edges[match];
+    memmove(&sync->edges[0], &sync->edges[match + 1], (sync->numEdges - match - 1) * sizeof(sync->edges[0]));
+    sync->numEdges -= match + 1;
+
+    if (!Update(sync, edge, gpsSec + (usec >= 500000 ? 1 : 0)) || sync->numUpdates < 2) {
+        return false;
+    }
+    if ((sync->flags & GNSS_SYNC_FLAG_RESET) == 0 && ++sync->sinceRecord < GNSS_SYNC_RECORD_INTERVAL) {
+        return false;
+    }
+    Gnss_Sync_GetRecord(sync, record);
+    sync->flags       = 0;
+    sync->sinceRecord = 0;
+    return true;
+} /* Gnss_Sync_AddFix */
+
+/**
+ * @brief GPS の日付と時刻を 1980-01-06 からの GPS 秒に変換する
+ *
+ * @note mktime() を使わず，日付から日数を直接求める．
+ */
+int64_t Gnss_Sync_ToGpsSeconds(int year, int month, int day, int hour, int minute, int sec)
+{
+    int y      = year - (month <= 2 ? 1 : 0);
+    int era    = (y >= 0 ? y : y - 399) / 400;
+    int yoe    = y - era * 400;
+    int doy    = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe    = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t) era * 146097 + doe - 719468 - GNSS_SYNC_GPS_EPOCH_DAYS;
+
+    return days * 86400 + hour * 3600 + minute * 60 + sec;
+}
@@ -0,0 +1,34 @@
+#ifndef GNSS_SYNC_H
+#define GNSS_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Gnss_Sync_public.h"
+
+#define GNSS_SYNC_MAX_EDGES (4)
+
+typedef struct tagGnss_Sync_t {
+    uint64_t edges[GNSS_SYNC_MAX_EDGES]; /* Recent PPS edges not paired yet, oldest first */
+    uint32_t numEdges;
+    bool     isLocked;
+    uint64_t lastRtc;            /* Last paired edge */
+    int64_t  lastGpsSec;         /* GPS second of the last paired edge */
+    double   phase;              /* Estimated GPS time at lastRtc minus lastGpsSec [s] */
+    double   drift;              /* GPS seconds per RTC second minus 1 */
+    double   meanSquare;         /* Running mean of the squared residuals [s^2] */
+    uint32_t numUpdates;
+    uint32_t consecutiveRejects;
+    uint32_t sinceRecord;
+    uint32_t pairCount;
+    uint32_t rejectCount;
+    uint16_t flags;
+} Gnss_Sync_t;
+
+void    Gnss_Sync_Init(Gnss_Sync_t* sync);
+void    Gnss_Sync_AddEdge(Gnss_Sync_t* sync, uint64_t rtc);
+bool    Gnss_Sync_AddFix(Gnss_Sync_t* sync, int64_t gpsSec, uint32_t usec, uint64_t rtc, GnssSync_Record_t* record);
+void    Gnss_Sync_GetRecord(const Gnss_Sync_t* sync, GnssSync_Record_t* record);
+int64_t Gnss_Sync_ToGpsSeconds(int year, int month, int day, int hour, int minute, int sec);
+
+#endif /* GNSS_SYNC_H */
@@ -4,21 +4,31 @@
 #include <fcntl.h>
 #include <nuttx/config.h>
 #include <poll.h>
+#include <stddef.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <unistd.h>
 
 #include "Common_Rtc.h"
+#include "Common_Sched.h"
+#include "Common_Trace.h"
 #include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
 #include "Logging_public.h"
+#include "PowerCtrl_public.h"
 
+#include "Gnss_Compact.h"
 #include "Gnss_Pps.h"
 
 /****************************************************************************
 * Pre-processor Definitions
 ****************************************************************************/
 
-#define MY_GNSS_SIG0          18
-#define MY_GNSS_SIG1          19
+#define MY_GNSS_SIG0          18 /* Batch mode: shutdown request */
+#define MY_GNSS_SIG1          19 /* Batch mode: PVTLOG threshold notification */
 #define TEST_LOOP_TIME        600
 #define TEST_RECORDING_CYCLE  1
 #define TEST_NOTIFY_THRESHOLD CXD56_GNSS_PVTLOG_THRESHOLD_HALF
@@ -236,12 +246,38 @@ typedef struct tagGnssLogBuffer_t {
     LogFooter_t        footer;
 } GnssLogBuffer_t;
 static_assert(sizeof(GnssLogBuffer_t) == BUFFER_SIZE, "GnssLogBuffer_t size mismatch");
-
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "GnssLogBuffer_t must be a whole number of clusters");
+
+typedef struct tagGnssLogging_Statistics_t {
+    uint32_t fixCount;
+    uint32_t wakeupCount;  /* Times the task woke up to read fixes */
+    uint64_t busyTicks;    /* RTC ticks spent reading and storing fixes */
+    uint64_t maxBusyTicks;
+} GnssLogging_Statistics_t;
+
+/**
+ * @note isBatch の場合は GNSS core の PVTLOG に測位結果を貯め，閾値の通知毎にまとめて読み出す．
+ *       Block の Body は struct cxd56_pvtlog_data_s の固定長 Record の列 (LoggingUser_GNSS_PVTLOG)．
+ *       通知と停止要求は Signal で受けるため，待ち合わせ中は一切起床しない．
+ *       isCompact の場合はどちらの方式の Record も直前の Record との差分で符号化する (LoggingUser_GNSS_COMPACT)．
+ */
 typedef struct tagGnssLogging_t {
-    int      shutdownHandlerId;
-    uint32_t seqId;
-    uint32_t logPos;
-    int      eventFd;
+    int                      shutdownHandlerId;
+    uint32_t                 seqId;
+    uint32_t                 logPos;
+    uint32_t                 overrun;
+    int                      eventFd;
+    pid_t                    pid;
+    bool                     isBatch;
+    bool                     isCompact;
+    bool                     isOpen;
+    LoggingQueue_t           mq;
+    Logging_Buffer_Desc_t    logdesc;
+    Logging_Pool_t           pool;
+    GnssLogging_Statistics_t stats;
+    Gnss_Compact_State_t     compact;
+    GnssCompact_Format_t*    compactFormat; /* Format at the start of the open block */
+    uint8_t                  encoded[GNSS_COMPACT_MAX_ENCODED_BYTES];
 } GnssLogging_t;
 
 static GnssLogging_t gnssLogging_instance;
@@ -252,7 +288,24 @@ static GnssLogging_t gnssLogging_instance;
 
 static struct cxd56_gnss_positiondata_s posdat;
 static struct cxd56_pvtlog_s pvtlogdat;
-static GnssLogBuffer_t gnssLogging_buffer[NUM_BUFFERS];
+static GnssLogBuffer_t gnssLogging_buffer[NUM_BUFFERS] LOGGING_BUFFER_ALIGNED;
+
+#define GNSS_COMPACT_FIELD(member, kind) \
+        { offsetof(GnssPositionData_t, member), sizeof(((GnssPositionData_t *) 0)->member), GnssCompact_Kind_##kind }
+
+/** @note 一定間隔で進む Field は LINEAR，double は 1 つの整数として HOLD で差分を取る．表に無い Field は全て HOLD． */
+static const GnssCompact_Field_t gnssCompact_fields[] = {
+    GNSS_COMPACT_FIELD(data_timestamp,        LINEAR),
+    GNSS_COMPACT_FIELD(receiver.latitude,     HOLD),
+    GNSS_COMPACT_FIELD(receiver.longitude,    HOLD),
+    GNSS_COMPACT_FIELD(receiver.altitude,     HOLD),
+    GNSS_COMPACT_FIELD(receiver.geoid,        HOLD),
+    GNSS_COMPACT_FIELD(receiver.time,         LINEAR),
+    GNSS_COMPACT_FIELD(receiver.gpstime,      LINEAR),
+    GNSS_COMPACT_FIELD(receiver.receivetime,  LINEAR),
+    GNSS_COMPACT_FIELD(receiver.time_ns,      LINEAR),
+    GNSS_COMPACT_FIELD(receiver.full_bias_ns, LINEAR),
+};
 
 static GnssLogging_t* GetInstance(void)
 {
@@ -298,17 +351,437 @@ static void ShutdownHandler(void)
     GnssLogging_t* self = GetInstance();
 
     eventfd_write(self->eventFd, 1);
+    if (self->isBatch) {
+        kill(self->pid, MY_GNSS_SIG0);
+    }
+}
+
+static void ReleaseBuffer(void* ptr)
+{
+    GnssLogging_t* self = GetInstance();
+
+    Logging_Pool_Release(&self->pool, ptr);
+}
+
+static void UpdateStatistics(uint32_t numFixes, uint64_t start)
+{
+    GnssLogging_t* self = GetInstance();
+    uint64_t busy = Common_Rtc_GetCount(Common_RtcChannel_1) - start;
+
+    self->stats.fixCount += numFixes;
+    self->stats.wakeupCount++;
+    self->stats.busyTicks += busy;
+    if (self->stats.maxBusyTicks < busy) {
+        self->stats.maxBusyTicks = busy;
+    }
+}
+
+/**
+ * @brief 起床回数と処理時間を表示する
+ *
+ * @note 測位 1 回毎に起床する方式と PVTLOG をまとめて読む方式の比較に使う．
+ */
+static void PrintStatistics(void)
+{
+    GnssLogging_t* self = GetInstance();
+    GnssLogging_Statistics_t* stats = &self->stats;
+
+    printf("GNSS %s fixes:%u wakeups:%u (%.1f fixes/wakeup) busy:%lluus/fix max:%lluus overrun:%u\n",
+        self->isBatch ? "batch" : "per-fix", stats->fixCount, stats->wakeupCount,
+        stats->wakeupCount ? (double) stats->fixCount / stats->wakeupCount : 0.0,
+        stats->fixCount ? stats->busyTicks * 1000000 / 32768 / stats->fixCount : 0,
+        stats->maxBusyTicks * 1000000 / 32768, self->overrun);
+    if (self->isBatch) {
+        printf("GNSS wakeups avoided vs per-fix polling: %u\n",
+            stats->fixCount > stats->wakeupCount ? stats->fixCount - stats->wakeupCount : 0);
+    }
+}
+
+/**
+ * @note 書式化は Logging タスクの Trace 出力スレッドで行う．
+ */
+static void TracePosition(uint32_t index, int size, const GnssPositionData_t* posData)
+{
+    COMMON_TRACE(GNSS_READ, index, size);
+    COMMON_TRACE(GNSS_POSITION,
+        posData->receiver.latitude,
+        posData->receiver.longitude,
+        posData->receiver.altitude);
+    COMMON_TRACE(GNSS_TIME,
+        posData->receiver.date.year,
+        posData->receiver.date.month,
+        posData->receiver.date.day,
+        posData->receiver.time.hour,
+        posData->receiver.time.minute,
+        posData->receiver.time.sec,
+        posData->receiver.time.usec);
+}
+
+/**
+ * @brief 測位結果を 1 件ずつ poll して読み出す
+ */
+static int Gnss_RunPerFix(int fd, LoggingQueue_t mq)
+{
+    GnssLogging_t* self = GetInstance();
+    Logging_Buffer_Desc_t logdesc = { 0 };
+    uint32_t seqId = 0;
+    bool isRunning = true;
+    int ret = 0;
+
+    while (isRunning) {
+        GnssLogBuffer_t* buffer = Logging_Pool_Acquire(&self->pool);
+        if (buffer == NULL) {
+            /** @note 空き Buffer が無い間も測位結果を読み捨て，落としたサイズを次の Block に記録する． */
+            static GnssPositionData_t discard;
+            struct pollfd fds[2];
+            fds[0].fd     = self->eventFd;
+            fds[0].events = POLLIN;
+            fds[1].fd     = fd;
+            fds[1].events = POLLIN;
+            ret = poll(fds, 2, -1);
+            if (ret > 0 && (fds[1].revents & POLLIN) && read(fd, &discard, sizeof(discard)) > 0) {
+                self->overrun += sizeof(GnssPositionData_t);
+            }
+            if (ret < 0 || (fds[0].revents & POLLIN)) {
+                break;
+            }
+            continue;
+        }
+        uint32_t i = 0;
+        while (isRunning && i < GNSS_RECORD_NUM) {
+            struct pollfd fds[2];
+            fds[0].fd     = self->eventFd;
+            fds[0].events = POLLIN;
+            fds[1].fd     = fd;
+            fds[1].events = POLLIN;
+            ret = poll(fds, 2, -1);
+            if (ret < 0) {
+                printf("Poll error: %d\n", errno);
+                isRunning = false;
+                break;
+            }
+            if (fds[1].revents & POLLIN) {
+                uint64_t start = Common_Rtc_GetCount(Common_RtcChannel_1);
+                if (i == 0) {
+                    Logging_Buffer_Init(&logdesc, LoggingUser_GNSS, seqId, self->overrun, buffer,
+                        sizeof(GnssLogBuffer_t));
+                    self->overrun = 0;
+                }
+
+                /* Read GNSS data */
+                GnssPositionData_t* posData = &buffer->body[i];
+                ret = read(fd, posData, sizeof(GnssPositionData_t));
+
+                if (ret < 0) {
+                    printf("Failed to read GNSS data: %d\n", errno);
+                    isRunning = false;
+                    break;
+                }
+                TracePosition(i, ret, posData);
+                if (posData->receiver.pos_fixmode >= 2) {
+                    Gnss_Pps_SetTime(&posData->receiver.gpsdate, &posData->receiver.gpstime, start);
+                }
+                Logging_Buffer_Update(&logdesc, sizeof(GnssPositionData_t));
+                i++;
+                UpdateStatistics(1, start);
+            }
+            if (fds[0].revents & POLLIN) {
+                uint64_t value;
+                if (eventfd_read(self->eventFd, &value) < 0) {
+                    printf("Failed to read eventfd: %d\n", errno);
+                }
+                printf("Shutdown signal received.\n");
+                isRunning = false;
+            }
+        }
+        if (i == 0) {
+            /** @note 1 件も書いていない Buffer は送らずに戻す． */
+            Logging_Pool_Release(&self->pool, buffer);
+            continue;
+        }
+        Logging_Buffer_Finalize(&logdesc);
+        LoggingDesc_t desc = { 0 };
+        desc.ptr      = buffer;
+        desc.user     = LoggingUser_GNSS;
+        desc.type     = LoggingType_WRITE;
+        desc.size     = sizeof(GnssLogBuffer_t);
+        desc.callback = ReleaseBuffer;
+        Logging_Buffer_Send(mq, &desc, &self->overrun);
+        seqId++;
+    }
+
+    return ret < 0 ? ret : 0;
+} /* Gnss_RunPerFix */
+
+static void SendBlock(GnssLogging_t* self)
+{
+    Logging_Buffer_Finalize(&self->logdesc);
+    LoggingDesc_t desc = { 0 };
+    desc.ptr      = self->logdesc.header;
+    desc.user     = self->logdesc.header->user; /* GNSS_PVTLOG or GNSS_COMPACT */
+    desc.type     = LoggingType_WRITE;
+    desc.size     = sizeof(GnssLogBuffer_t);
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &self->overrun);
+    self->isOpen = false;
+    self->seqId++;
+}
+
+static bool OpenCompactBlock(GnssLogging_t* self)
+{
+    GnssLogBuffer_t* buffer = Logging_Pool_Acquire(&self->pool);
+
+    if (buffer == NULL) {
+        return false;
+    }
+    Logging_Buffer_Init(&self->logdesc, LoggingUser_GNSS_COMPACT, self->seqId, self->overrun, buffer,
+        sizeof(GnssLogBuffer_t));
+    self->overrun       = 0;
+    self->isOpen        = true;
+    self->compactFormat = Logging_Buffer_GetNextPos(&self->logdesc);
+    Logging_Buffer_Update(&self->logdesc, Gnss_Compact_WriteFormat(&self->compact, self->compactFormat));
+    Gnss_Compact_Reset(&self->compact);
+    return true;
+}
+
+/**
+ * @brief Record を差分で符号化して Block に追加する
+ *
+ * @note Block の最初の Record は KEY になるよう，Block が一杯の場合は新しい Block で符号化し直す．
+ *       numRecords は Block の中で更新するため，CRC は Logging_Buffer_Finalize() でまとめて計算する．
+ */
+static void WriteCompactRecord(GnssLogging_t* self, const void* record)
+{
+    uint32_t length = 0;
+
+    if (self->isOpen) {
+        length = Gnss_Compact_EncodeRecord(&self->compact, record, self->encoded);
+        if (Logging_Buffer_GetRemainingSize(&self->logdesc) < length) {
+            SendBlock(self);
+        }
+    }
+    if (!self->isOpen) {
+        if (!OpenCompactBlock(self)) {
+            self->overrun += self->compact.recordSize;
+            return;
+        }
+        length = Gnss_Compact_EncodeRecord(&self->compact, record, self->encoded);
+    }
+    Logging_Buffer_Write(&self->logdesc, self->encoded, length);
+    self->compactFormat->numRecords++;
 }
 
+static void WriteBatchRecord(GnssLogging_t* self, cxd56_pvtlog_data_t* record)
+{
+    if (self->isCompact) {
+        WriteCompactRecord(self, record);
+        return;
+    }
+    if (self->isOpen && Logging_Buffer_GetRemainingSize(&self->logdesc) < sizeof(*record)) {
+        SendBlock(self);
+    }
+    if (!self->isOpen) {
+        GnssLogBuffer_t* buffer = Logging_Pool_Acquire(&self->pool);
+        if (buffer == NULL) {
+            self->overrun += sizeof(*record);
+            return;
+        }
+        Logging_Buffer_Init(&self->logdesc, LoggingUser_GNSS_PVTLOG, self->seqId, self->overrun, buffer,
+            sizeof(GnssLogBuffer_t));
+        self->overrun = 0;
+        self->isOpen  = true;
+    }
+    Logging_Buffer_Write(&self->logdesc, record, sizeof(*record));
+}
+
+/**
+ * @brief GNSS core に貯まった PVTLOG をまとめて読み出し，Block に追加する
+ */
+static int ReadPvtlog(int fd)
+{
+    GnssLogging_t* self = GetInstance();
+    uint64_t start = Common_Rtc_GetCount(Common_RtcChannel_1);
+
+    if (lseek(fd, CXD56_GNSS_READ_OFFSET_PVTLOG, SEEK_SET) < 0) {
+        printf("Failed to seek PVTLOG: %d\n", errno);
+        return -errno;
+    }
+    int ret = read(fd, &pvtlogdat, sizeof(pvtlogdat));
+    if (ret < 0) {
+        printf("Failed to read PVTLOG: %d\n", errno);
+        return -errno;
+    }
+
+    uint32_t num = pvtlogdat.status.log_count;
+    if (num > CXD56_GNSS_PVTLOG_MAXNUM) {
+        num = CXD56_GNSS_PVTLOG_MAXNUM;
+    }
+    for (uint32_t i = 0; i < num; ++i) {
+        WriteBatchRecord(self, &pvtlogdat.log_data[i]);
+    }
+    UpdateStatistics(num, start);
+    COMMON_TRACE(GNSS_PVTLOG, num, self->stats.fixCount);
+    return OK;
+}
+
+static int SetPvtlogSignal(int fd, bool isEnabled)
+{
+    struct cxd56_gnss_signal_setting_s setting = { 0 };
+
+    setting.fd      = fd;
+    setting.enable  = isEnabled ? 1 : 0;
+    setting.gnsssig = CXD56_GNSS_SIG_PVTLOG;
+    setting.signo   = MY_GNSS_SIG1;
+    setting.data    = NULL;
+    return ioctl(fd, CXD56_GNSS_IOCTL_SIGNAL_SET, (unsigned long) &setting);
+}
+
+/**
+ * @brief PVTLOG の閾値通知毎にまとめて読み出す
+ *
+ * @note 測位周期 TEST_RECORDING_CYCLE 秒で PVTLOG_UNITNUM 件貯まる毎に 1 回だけ起床する．
+ *       停止時は閾値に達していない分も読み出してから PVTLOG を消去する．
+ */
+static int Gnss_RunBatch(int fd, LoggingQueue_t mq)
+{
+    GnssLogging_t* self = GetInstance();
+    struct cxd56_pvtlog_setting_s pvtlogSetting;
+    sigset_t mask;
+    int ret;
+
+    self->mq     = mq;
+    self->isOpen = false;
+    if (self->isCompact) {
+        Gnss_Compact_Init(&self->compact, LoggingUser_GNSS_PVTLOG, sizeof(cxd56_pvtlog_data_t), NULL, 0);
+    } else {
+        Logging_Buffer_SetRecordSize(&self->logdesc, sizeof(cxd56_pvtlog_data_t));
+    }
+
+    sigemptyset(&mask);
+    sigaddset(&mask, MY_GNSS_SIG0);
+    sigaddset(&mask, MY_GNSS_SIG1);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+
+    ret = SetPvtlogSignal(fd, true);
+    if (ret < 0) {
+        printf("Failed to set PVTLOG signal: %d\n", errno);
+        return ret;
+    }
+    pvtlogSetting.cycle     = TEST_RECORDING_CYCLE;
+    pvtlogSetting.threshold = TEST_NOTIFY_THRESHOLD;
+    ret = ioctl(fd, CXD56_GNSS_IOCTL_PVTLOG_START, (unsigned long) &pvtlogSetting);
+    if (ret < 0) {
+        printf("Failed to start PVTLOG: %d\n", errno);
+        SetPvtlogSignal(fd, false);
+        return ret;
+    }
+    printf("GNSS PVTLOG started: %u fixes per wakeup\n", PVTLOG_UNITNUM);
+
+    for (;;) {
+        siginfo_t info;
+        int signo = sigwaitinfo(&mask, &info);
+
+        if (signo == MY_GNSS_SIG1) {
+            ret = ReadPvtlog(fd);
+            if (ret < 0) {
+                break;
+            }
+        } else if (signo == MY_GNSS_SIG0) {
+            printf("Shutdown signal received.\n");
+            break;
+        } else if (errno != EINTR) {
+            printf("sigwaitinfo error: %d\n", errno);
+            ret = -errno;
+            break;
+        }
+    }
+
+    ioctl(fd, CXD56_GNSS_IOCTL_PVTLOG_STOP, 0);
+    ReadPvtlog(fd);
+    ioctl(fd, CXD56_GNSS_IOCTL_PVTLOG_DELETE_LOG, 0);
+    SetPvtlogSignal(fd, false);
+    if (self->isOpen) {
+        SendBlock(self);
+    }
+
+    return ret < 0 ? ret : 0;
+} /* Gnss_RunBatch */
+
+/**
+ * @brief 測位結果を 1 件ずつ poll して読み出し，差分で符号化する
+ */
+static int Gnss_RunPerFixCompact(int fd, LoggingQueue_t mq)
+{
+    GnssLogging_t* self = GetInstance();
+    static GnssPositionData_t posData;
+    uint32_t index = 0;
+    int ret = 0;
+
+    self->mq     = mq;
+    self->isOpen = false;
+    Gnss_Compact_Init(&self->compact, LoggingUser_GNSS, sizeof(GnssPositionData_t), gnssCompact_fields,
+        sizeof(gnssCompact_fields) / sizeof(gnssCompact_fields[0]));
+
+    for (;;) {
+        struct pollfd fds[2];
+        fds[0].fd     = self->eventFd;
+        fds[0].events = POLLIN;
+        fds[1].fd     = fd;
+        fds[1].events = POLLIN;
+        ret = poll(fds, 2, -1);
+        if (ret < 0) {
+            printf("Poll error: %d\n", errno);
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t start = Common_Rtc_GetCount(Common_RtcChannel_1);
+
+            ret = read(fd, &posData, sizeof(posData));
+            if (ret < 0) {
+                printf("Failed to read GNSS data: %d\n", errno);
+                break;
+            }
+            TracePosition(index++, ret, &posData);
+            if (posData.receiver.pos_fixmode >= 2) {
+                Gnss_Pps_SetTime(&posData.receiver.gpsdate, &posData.receiver.gpstime, start);
+            }
+            WriteCompactRecord(self, &posData);
+            UpdateStatistics(1, start);
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            eventfd_read(self->eventFd, &value);
+            printf("Shutdown signal received.\n");
+            break;
+        }
+    }
+    if (self->isOpen) {
+        SendBlock(self);
+    }
+
+    return ret < 0 ? ret : 0;
+} /* Gnss_RunPerFixCompact */
+
 #define getreg32(a) (*(volatile uint32_t *) (a))
 
 int main(int argc, FAR char* argv[])
 {
     GnssLogging_t* self = GetInstance();
-    mqd_t mq = Logging_OpenQueue(true);
-    Logging_Buffer_Desc_t logdesc;
+
+    Common_Sched_Apply(Common_SchedTask_GNSS);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "batch") == 0) {
+            self->isBatch = true;
+        } else if (strcmp(argv[i], "compact") == 0) {
+            self->isCompact = true;
+        }
+    }
+
+    LoggingQueue_t mq = Logging_OpenQueue(true);
 
     /* Initialize GNSS logging instance */
+    self->pid = getpid();
     self->shutdownHandlerId = PowerCtrl_SetShutdownCallback(ShutdownHandler);
     if (self->shutdownHandlerId < 0) {
         printf("Failed to set shutdown callback: %d\n", self->shutdownHandlerId);
@@ -319,8 +792,11 @@ int main(int argc, FAR char* argv[])
         printf("Failed to create eventfd: %d\n", errno);
         return -errno;
     }
-    self->seqId  = 0;
-    self->logPos = 0;
+    self->seqId   = 0;
+    self->logPos  = 0;
+    self->overrun = 0;
+    Logging_Pool_Init(&self->pool, gnssLogging_buffer, sizeof(GnssLogBuffer_t), NUM_BUFFERS);
+    Logging_Buffer_SetOptions(&self->logdesc, Logging_BufferOption_DEFERRED_CRC);
     /* Open GNSS device */
     int fd = open("/dev/gps", O_RDONLY);
     if (fd < 0) {
@@ -353,101 +829,29 @@ int main(int argc, FAR char* argv[])
     printf("GNSS PPS initialized %x %x %x\n", getreg32(0x04100818), getreg32(0x4102014), getreg32(0x041007C0));
 
     printf("GNSS started successfully.\n");
-    /* Main loop to read GNSS data */
-    uint32_t seqId = 0;
-    bool isRunning = true;
-    while (isRunning) {
-        GnssLogBuffer_t* buffer = &gnssLogging_buffer[seqId % NUM_BUFFERS];
-        for (uint32_t i = 0; i < GNSS_RECORD_NUM; i++) {
-            struct pollfd fds[2];
-            fds[0].fd     = self->eventFd;
-            fds[0].events = POLLIN;
-            fds[1].fd     = fd;
-            fds[1].events = POLLIN;
-            ret = poll(&fds, 1, -1);
-            if (ret < 0) {
-                printf("Poll error: %d\n", errno);
-                close(fd);
-                return ret;
-            }
-            if (fds[1].revents & POLLIN) {
-                if (i == 0) {
-                    Logging_Buffer_Init(&logdesc, LoggingUser_GNSS, seqId, buffer, sizeof(GnssLogBuffer_t));
-                }
-
-                /* Read GNSS data */
-                GnssPositionData_t* posData = &buffer->body[i];
-                ret = read(fd, posData, sizeof(GnssPositionData_t));
-
-                if (ret < 0) {
-                    printf("Failed to read GNSS data: %d\n", errno);
-                    close(fd);
-                    return ret;
-                }
-                printf("idx:%d Read GNSS data: %d bytes\n", i, ret);
-                printf("Position: Lat: %f, Lon: %f, Alt: %f\n",
-                    buffer->body[i].receiver.latitude,
-                    buffer->body[i].receiver.longitude,
-                    buffer->body[i].receiver.altitude);
-                printf("Time: %d-%02d-%02d %02d:%02d:%02d.%06d\n",
-                    buffer->body[i].receiver.date.year,
-                    buffer->body[i].receiver.date.month,
-                    buffer->body[i].receiver.date.day,
-                    buffer->body[i].receiver.time.hour,
-                    buffer->body[i].receiver.time.minute,
-                    buffer->body[i].receiver.time.sec,
-                    buffer->body[i].receiver.time.usec);
-
-                struct tm tm = { 0 };
-                tm.tm_year = posData->receiver.date.year - 1900;
-                tm.tm_mon  = posData->receiver.date.month - 1;
-                tm.tm_mday = posData->receiver.date.day;
-                tm.tm_hour = posData->receiver.time.hour;
-                tm.tm_min  = posData->receiver.time.minute;
-                tm.tm_sec  = posData->receiver.time.sec;
-
-                time_t tt = mktime(&tm);
-
-                // printf("logdesc %x %x %x %x %x\n", logdesc.header,
-                //     logdesc.body, logdesc.footer, logdesc.header->size, logdesc.footer->size);
-                Logging_Buffer_Update(&logdesc, sizeof(GnssPositionData_t));
-            }
-            if (fds[0].revents & POLLIN) {
-                uint64_t value;
-                ret = eventfd_read(self->eventFd, &value);
-                if (ret < 0) {
-                    printf("Failed to read eventfd: %d\n", errno);
-                }
-                if (value > 0) {
-                    printf("Shutdown signal received.\n");
-                    return 0; // Exit gracefully
-                }
-                isRunning = false; // Exit the loop
-            }
-            if (!isRunning) {
-                break; // Exit the loop if shutdown signal received
-            }
+    if (self->isBatch) {
+        ret = Gnss_RunBatch(fd, mq);
+    } else {
+        /** @note PPS との対応付けは測位毎に時刻が分かるモードでのみ行う． */
+        Gnss_Pps_Start(mq);
+        if (self->isCompact) {
+            ret = Gnss_RunPerFixCompact(fd, mq);
+        } else {
+            ret = Gnss_RunPerFix(fd, mq);
         }
-        Logging_Buffer_Finalize(&logdesc);
-        LoggingDesc_t desc;
-        desc.ptr      = buffer;
-        desc.user     = LoggingUser_GNSS;
-        desc.type     = LoggingType_WRITE;
-        desc.size     = sizeof(GnssLogBuffer_t);
-        desc.callback = NULL; // No callback for this example
-        Logging_SendQueue(mq, &desc);
-
-        if (ret < 0) {
-            printf("Poll error: %d\n", errno);
-            break;
-        }
-        seqId++;
+        Gnss_Pps_Stop();
     }
+    PrintStatistics();
+
+    ioctl(fd, CXD56_GNSS_IOCTL_STOP, 0);
+    close(fd);
 
     LoggingDesc_t desc = { 0 };
     desc.user = LoggingUser_GNSS;
     desc.type = LoggingType_END;
     Logging_SendQueue(mq, &desc);
+    Logging_CloseQueue(mq);
 
-    /* Set up signal handlers, logging, etc. */
+    PowerCtrl_NotifyStop(self->shutdownHandlerId);
+    return ret;
 } /* main */
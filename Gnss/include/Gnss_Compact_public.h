@@ -0,0 +1,45 @@
+#ifndef GNSS_COMPACT_PUBLIC_H
+#define GNSS_COMPACT_PUBLIC_H
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * @note LoggingUser_GNSS_COMPACT の Block の Body は，GnssCompact_Format_t，GnssCompact_Field_t の列，Frame の列の順．
+ *       Field の表は元の Record を隙間無く分割しているため，ホストは元の構造体の定義無しに Record を復元できる．
+ *       各 Field は little endian の整数として扱い，予測値との差を符号化する．
+ *         HOLD   : 直前の Record の値を予測値とする
+ *         LINEAR : 直前の 2 Record から線形に予測する (タイムスタンプや時刻)
+ *       Frame は先頭 1 バイトの種類で始まる．
+ *         KEY   : 元の Record をそのまま置く．Block の最初の Frame は必ず KEY で，Block 毎に独立して復号できる．
+ *         DELTA : Group (8 Field) の bitmap，予測と異なる Field を含む Group 毎の Field の bitmap，
+ *                 予測と異なる Field 毎に差を ZigZag 変換した LEB128 の可変長整数が続く．
+ */
+#define GNSS_COMPACT_FRAME_KEY       (1)
+#define GNSS_COMPACT_FRAME_DELTA     (2)
+
+#define GNSS_COMPACT_MAX_FIELDS      (128)
+#define GNSS_COMPACT_MAX_RECORD_SIZE (512)
+
+typedef enum tagGnssCompact_Kind_e {
+    GnssCompact_Kind_HOLD   = 0,
+    GnssCompact_Kind_LINEAR = 1,
+} GnssCompact_Kind_e;
+
+typedef struct tagGnssCompact_Format_t {
+    uint16_t recordSize; /* Size of the original record in bytes */
+    uint16_t numFields;  /* GnssCompact_Field_t entries that follow */
+    uint32_t numRecords; /* Frames in the block */
+    uint32_t user;       /* LoggingUser_e of the original records */
+    uint32_t reserved;
+} GnssCompact_Format_t;
+
+typedef struct tagGnssCompact_Field_t {
+    uint16_t offset;
+    uint8_t  size;   /* 1 to 8 bytes */
+    uint8_t  kind;   /* GnssCompact_Kind_e */
+} GnssCompact_Field_t;
+
+static_assert(sizeof(GnssCompact_Format_t) % sizeof(uint64_t) == 0, "Keep the field table 8-byte aligned");
+
+#endif /* GNSS_COMPACT_PUBLIC_H */
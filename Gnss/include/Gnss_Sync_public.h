@@ -0,0 +1,38 @@
+#ifndef GNSS_SYNC_PUBLIC_H
+#define GNSS_SYNC_PUBLIC_H
+
+#include <assert.h>
+#include <stdint.h>
+
+#define GNSS_SYNC_RTC_HZ   (32768)
+#define GNSS_SYNC_FLAG_RESET (1U << 0) /* First record after the model was (re)started */
+
+/**
+ * @note LoggingUser_SYNCHRONIZE の Block の Body は GnssSync_Record_t の固定長 Record の列．
+ *       各 Record は PPS の立ち上がりで捉えた RTC (Common_RtcChannel_1) のカウントと，
+ *       その時点の GPS 時刻と RTC の周波数のずれの推定値を持つ．
+ *       RTC のカウント count は GnssSync_ToGpsNs() で，直前の Record だけから GPS 時刻に変換できる．
+ *       LogHeader_t.time，LogFooter_t.time 等，Common_RtcChannel_1 のカウントは全て同じ方法で変換できる．
+ */
+typedef struct tagGnssSync_Record_t {
+    uint64_t rtc;         /* RTC count of the PPS edge the record is anchored to */
+    int64_t  gpsTimeNs;   /* Estimated GPS time at rtc [ns since 1980-01-06 00:00:00 GPS] */
+    float    driftPpm;    /* RTC rate error, positive if the RTC runs slow */
+    uint32_t rmsNs;       /* RMS of the recent PPS residuals */
+    uint32_t pairCount;   /* PPS edges paired with a fix since start */
+    uint16_t rejectCount; /* Pairs rejected as outliers since start */
+    uint16_t flags;       /* GNSS_SYNC_FLAG_* */
+} GnssSync_Record_t;
+static_assert(sizeof(GnssSync_Record_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+/**
+ * @brief RTC のカウントを GPS 時刻 [ns] に変換する
+ */
+static inline int64_t GnssSync_ToGpsNs(const GnssSync_Record_t* record, uint64_t count)
+{
+    double ticks = (double) (int64_t) (count - record->rtc);
+
+    return record->gpsTimeNs + (int64_t) (ticks * (1e9 / GNSS_SYNC_RTC_HZ) * (1.0 + record->driftPpm * 1e-6));
+}
+
+#endif /* GNSS_SYNC_PUBLIC_H */
@@ -0,0 +1,245 @@
+#include "Imu_Decimate.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Imu_Fir.h"
+#include "Imu_Logging.h"
+#include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
+
+#define BUFFER_NUM         (2)
+#define BUFFER_SIZE        (32 * 1024)
+#define STREAM_RECORD_NUM  ((BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)) / sizeof(cxd5602pwbimu_data_t))
+#define STREAM_PADDING_SIZE                                      \
+        (BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t) \
+        - (STREAM_RECORD_NUM * sizeof(cxd5602pwbimu_data_t)))
+
+typedef struct tagImuStreamLogBuffer_t {
+    LogHeader_t          header;
+    cxd5602pwbimu_data_t body[STREAM_RECORD_NUM];
+    uint8_t              reserved[STREAM_PADDING_SIZE];
+    LogFooter_t          footer;
+} ImuStreamLogBuffer_t;
+static_assert(sizeof(ImuStreamLogBuffer_t) == BUFFER_SIZE, "ImuStreamLogBuffer_t size mismatch");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "ImuStreamLogBuffer_t must be a whole number of clusters");
+
+/**
+ * @brief 間引いた 1 ストリーム
+ *
+ * @note Record は元と同じ cxd5602pwbimu_data_t．timestamp は FIR の群遅延を差し引いた値，temp は最新の入力．
+ */
+typedef struct tagImuStream_t {
+    LoggingUser_e         user;
+    bool                  isOpen;
+    uint32_t              seqId;
+    uint32_t              overrun;
+    uint32_t              delay; /* FIR group delay in timestamp ticks */
+    uint32_t              outputCount;
+    Imu_Fir_t             fir;
+    Logging_Buffer_Desc_t logdesc;
+    Logging_Pool_t        pool;
+    ImuStreamLogBuffer_t  buffers[BUFFER_NUM] LOGGING_BUFFER_ALIGNED;
+} ImuStream_t;
+
+/**
+ * @brief 全レートのサンプルから低レートの IMU ストリームを作る
+ *
+ * @note 取得ループ (単一のスレッド) からのみ呼ぶ．
+ *       ストリームは Buffer と FIR の履歴で大きいため，初めて設定された時に確保する．
+ *       Logging タスクが Buffer を返す前に終了することがあるため解放せず，次回の実行で再利用する．
+ */
+typedef struct tagImuDecimate_t {
+    LoggingQueue_t mq;
+    uint32_t       numStreams;
+    ImuStream_t*   streams[IMU_DECIMATE_MAX_STREAMS];
+} ImuDecimate_t;
+
+static const LoggingUser_e imuDecimate_users[IMU_DECIMATE_MAX_STREAMS] = {
+    LoggingUser_IMU_DECIMATED_0,
+    LoggingUser_IMU_DECIMATED_1,
+};
+
+static ImuDecimate_t imuDecimate_instance;
+
+static ImuDecimate_t* GetInstance(void)
+{
+    return &imuDecimate_instance;
+}
+
+static void ReleaseBuffer(void* ptr)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    for (uint32_t i = 0; i < self->numStreams; ++i) {
+        ImuStream_t* stream = self->streams[i];
+        if ((uint8_t *) stream->buffers <= (uint8_t *) ptr && (uint8_t *) ptr < (uint8_t *) (stream->buffers + BUFFER_NUM)) {
+            Logging_Pool_Release(&stream->pool, ptr);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief i 番目のストリームを確保する
+ *
+ * @note Buffer をセクタ境界に置くため，余分に確保して先頭を揃える．
+ */
+static ImuStream_t* AllocateStream(uint32_t i)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    if (self->streams[i] == NULL) {
+        uint8_t* mem = malloc(sizeof(ImuStream_t) + LOGGING_BUFFER_ALIGNMENT);
+
+        if (mem == NULL) {
+            return NULL;
+        }
+        self->streams[i] = (ImuStream_t *) (((uintptr_t) mem + LOGGING_BUFFER_ALIGNMENT - 1)
+            & ~(uintptr_t) (LOGGING_BUFFER_ALIGNMENT - 1));
+    }
+    return self->streams[i];
+}
+
+/**
+ * @param factors    ストリーム毎の間引き率 (2〜IMU_FIR_MAX_FACTOR)
+ * @param numStreams 0 の場合は何もしない
+ */
+int Imu_Decimate_Init(LoggingQueue_t mq, int sampleRate, const uint32_t* factors, uint32_t numStreams)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    if (numStreams > IMU_DECIMATE_MAX_STREAMS) {
+        return ERROR;
+    }
+
+    self->mq         = mq;
+    self->numStreams = 0;
+    for (uint32_t i = 0; i < numStreams; ++i) {
+        ImuStream_t* stream = AllocateStream(i);
+
+        if (stream == NULL) {
+            printf("ERROR: Failed to allocate decimated stream %u.\n", i);
+            return ERROR;
+        }
+        if (!Imu_Fir_Init(&stream->fir, factors[i])) {
+            printf("ERROR: Invalid decimation factor. %u\n", factors[i]);
+            return ERROR;
+        }
+        stream->user        = imuDecimate_users[i];
+        stream->isOpen      = false;
+        stream->seqId       = 0;
+        stream->overrun     = 0;
+        stream->outputCount = 0;
+        stream->delay       = (stream->fir.taps - 1) / 2 * (IMU_TIMESTAMP_HZ / sampleRate);
+        Logging_Pool_Init(&stream->pool, stream->buffers, sizeof(ImuStreamLogBuffer_t), BUFFER_NUM);
+        Logging_Buffer_SetOptions(&stream->logdesc, Logging_BufferOption_DEFERRED_CRC);
+        Logging_Buffer_SetRecordSize(&stream->logdesc, sizeof(cxd5602pwbimu_data_t));
+        printf("Decimated stream %u: %dHz (factor %u, %u taps)\n",
+            i, sampleRate / (int) factors[i], factors[i], stream->fir.taps);
+    }
+    self->numStreams = numStreams;
+
+    return OK;
+}
+
+static void SendBlock(ImuStream_t* stream)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    Logging_Buffer_Finalize(&stream->logdesc);
+    LoggingDesc_t desc = { 0 };
+    desc.ptr      = stream->logdesc.header;
+    desc.user     = stream->user;
+    desc.type     = LoggingType_WRITE;
+    desc.size     = sizeof(ImuStreamLogBuffer_t);
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &stream->overrun);
+    stream->isOpen = false;
+    stream->seqId++;
+}
+
+static void WriteRecord(ImuStream_t* stream, const cxd5602pwbimu_data_t* record)
+{
+    if (!stream->isOpen) {
+        ImuStreamLogBuffer_t* buff = Logging_Pool_Acquire(&stream->pool);
+        if (buff == NULL) {
+            stream->overrun += sizeof(*record);
+            return;
+        }
+        Logging_Buffer_Init(&stream->logdesc, stream->user, stream->seqId, stream->overrun, buff,
+            sizeof(ImuStreamLogBuffer_t));
+        stream->overrun = 0;
+        stream->isOpen  = true;
+    }
+
+    Logging_Buffer_Write(&stream->logdesc, (void *) record, sizeof(*record));
+    if (Logging_Buffer_GetRemainingSize(&stream->logdesc) - STREAM_PADDING_SIZE < sizeof(*record)) {
+        SendBlock(stream);
+    }
+}
+
+/**
+ * @brief 読み込んだ全レートのサンプルを各ストリームのフィルタに通す
+ */
+void Imu_Decimate_Process(const cxd5602pwbimu_data_t* samples, uint32_t num)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    for (uint32_t n = 0; n < num; ++n) {
+        const cxd5602pwbimu_data_t* sample = &samples[n];
+        const float in[IMU_FIR_CHANNELS]   = { sample->gx, sample->gy, sample->gz, sample->ax, sample->ay, sample->az };
+        float out[IMU_FIR_CHANNELS];
+
+        for (uint32_t i = 0; i < self->numStreams; ++i) {
+            ImuStream_t* stream = self->streams[i];
+
+            if (!Imu_Fir_Process(&stream->fir, in, out)) {
+                continue;
+            }
+            cxd5602pwbimu_data_t record;
+            record.timestamp = sample->timestamp - stream->delay;
+            record.temp      = sample->temp;
+            record.gx        = out[0];
+            record.gy        = out[1];
+            record.gz        = out[2];
+            record.ax        = out[3];
+            record.ay        = out[4];
+            record.az        = out[5];
+            stream->outputCount++;
+            WriteRecord(stream, &record);
+        }
+    }
+}
+
+/**
+ * @brief 書きかけの Block を送る
+ */
+void Imu_Decimate_Flush(void)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    for (uint32_t i = 0; i < self->numStreams; ++i) {
+        if (self->streams[i]->isOpen) {
+            SendBlock(self->streams[i]);
+        }
+    }
+}
+
+void Imu_Decimate_PrintStatistics(void)
+{
+    ImuDecimate_t* self = GetInstance();
+
+    for (uint32_t i = 0; i < self->numStreams; ++i) {
+        ImuStream_t* stream = self->streams[i];
+        Logging_Pool_Statistics_t pool;
+
+        Logging_Pool_GetStatistics(&stream->pool, &pool);
+        printf("Decimated stream %u: samples:%u blocks:%u overrun:%u\n",
+            i, stream->outputCount, stream->seqId, pool.overrunCount);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef IMU_DECIMATE_H
+#define IMU_DECIMATE_H
+
+#include <nuttx/sensors/cxd5602pwbimu.h>
+#include <stdint.h>
+
+#include "Imu_Logging.h"
+#include "Logging_public.h"
+
+int  Imu_Decimate_Init(LoggingQueue_t mq, int sampleRate, const uint32_t* factors, uint32_t numStreams);
+void Imu_Decimate_Process(const cxd5602pwbimu_data_t* samples, uint32_t num);
+void Imu_Decimate_Flush(void);
+void Imu_Decimate_PrintStatistics(void);
+
+#endif /* IMU_DECIMATE_H */
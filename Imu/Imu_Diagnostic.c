@@ -0,0 +1,123 @@
+#include "Imu_Diagnostic.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
+
+#define BUFFER_NUM  (2)
+#define BUFFER_SIZE (32 * 1024)
+
+typedef struct tagImuDiagnosticLogBuffer_t {
+    LogHeader_t header;
+    uint8_t     body[BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)];
+    LogFooter_t footer;
+} ImuDiagnosticLogBuffer_t;
+static_assert(sizeof(ImuDiagnosticLogBuffer_t) == BUFFER_SIZE, "ImuDiagnosticLogBuffer_t size mismatch");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "ImuDiagnosticLogBuffer_t must be a whole number of clusters");
+
+/**
+ * @brief IMU の診断 Record を貯めて Block として送る
+ *
+ * @note 複数の IMU の取得スレッドから呼ばれるため，mutex で Record の追加と送信を排他する．
+ */
+typedef struct tagImuDiagnostic_t {
+    pthread_mutex_t       mutex;
+    LoggingQueue_t        mq;
+    bool                  isOpen;
+    uint32_t              seqId;
+    uint32_t              overrun;
+    Logging_Buffer_Desc_t logdesc;
+    Logging_Pool_t        pool;
+} ImuDiagnostic_t;
+
+static ImuDiagnosticLogBuffer_t imuDiagnostic_buffer[BUFFER_NUM] LOGGING_BUFFER_ALIGNED;
+static ImuDiagnostic_t imuDiagnostic_instance;
+
+static ImuDiagnostic_t* GetInstance(void)
+{
+    return &imuDiagnostic_instance;
+}
+
+static void ReleaseBuffer(void* ptr)
+{
+    ImuDiagnostic_t* self = GetInstance();
+
+    Logging_Pool_Release(&self->pool, ptr);
+}
+
+void Imu_Diagnostic_Init(LoggingQueue_t mq)
+{
+    ImuDiagnostic_t* self = GetInstance();
+
+    pthread_mutex_init(&self->mutex, NULL);
+    self->mq      = mq;
+    self->isOpen  = false;
+    self->seqId   = 0;
+    self->overrun = 0;
+    Logging_Pool_Init(&self->pool, imuDiagnostic_buffer, sizeof(ImuDiagnosticLogBuffer_t), BUFFER_NUM);
+    Logging_Buffer_SetOptions(&self->logdesc, Logging_BufferOption_DEFERRED_CRC);
+}
+
+static void SendBlock(ImuDiagnostic_t* self)
+{
+    Logging_Buffer_Finalize(&self->logdesc);
+    LoggingDesc_t desc = { 0 };
+    desc.ptr      = self->logdesc.header;
+    desc.user     = LoggingUser_IMU_DIAGNOSTIC;
+    desc.type     = LoggingType_WRITE;
+    desc.size     = sizeof(ImuDiagnosticLogBuffer_t);
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &self->overrun);
+    self->isOpen = false;
+    self->seqId++;
+}
+
+/**
+ * @brief 書きかけの Block を送る
+ */
+void Imu_Diagnostic_Flush(void)
+{
+    ImuDiagnostic_t* self = GetInstance();
+
+    pthread_mutex_lock(&self->mutex);
+    if (self->isOpen) {
+        SendBlock(self);
+    }
+    pthread_mutex_unlock(&self->mutex);
+}
+
+/**
+ * @brief Record を追加する
+ *
+ * @param record ImuDiagnostic_Header_t で始まる Record．size は Header を含む．
+ *
+ * @note 空き Buffer が無い場合は捨て，捨てたサイズを次の Block の overrun に記録する．
+ */
+void Imu_Diagnostic_Write(const void* record)
+{
+    ImuDiagnostic_t* self = GetInstance();
+    const ImuDiagnostic_Header_t* header = record;
+
+    pthread_mutex_lock(&self->mutex);
+    if (self->isOpen && Logging_Buffer_GetRemainingSize(&self->logdesc) < header->size) {
+        SendBlock(self);
+    }
+    if (!self->isOpen) {
+        ImuDiagnosticLogBuffer_t* buff = Logging_Pool_Acquire(&self->pool);
+        if (buff == NULL) {
+            self->overrun += header->size;
+            pthread_mutex_unlock(&self->mutex);
+            return;
+        }
+        Logging_Buffer_Init(&self->logdesc, LoggingUser_IMU_DIAGNOSTIC, self->seqId, self->overrun, buff,
+            sizeof(ImuDiagnosticLogBuffer_t));
+        self->overrun = 0;
+        self->isOpen  = true;
+    }
+    Logging_Buffer_Write(&self->logdesc, (void *) record, header->size);
+    pthread_mutex_unlock(&self->mutex);
+}
@@ -0,0 +1,13 @@
+#ifndef IMU_DIAGNOSTIC_H
+#define IMU_DIAGNOSTIC_H
+
+#include <stdint.h>
+
+#include "Imu_Diagnostic_public.h"
+#include "Logging_public.h"
+
+void Imu_Diagnostic_Init(LoggingQueue_t mq);
+void Imu_Diagnostic_Write(const void* record);
+void Imu_Diagnostic_Flush(void);
+
+#endif /* IMU_DIAGNOSTIC_H */
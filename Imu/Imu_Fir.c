@@ -0,0 +1,76 @@
+#include "Imu_Fir.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PI (3.14159265358979323846)
+
+/**
+ * @brief 間引き率に合わせて係数を設計し，履歴を消去する
+ *
+ * @note ホストでも動作し，Tools/FirBench で周波数特性と速度を確認できる．
+ *
+ * @retval false factor が範囲外
+ */
+bool Imu_Fir_Init(Imu_Fir_t* fir, uint32_t factor)
+{
+    if (factor < 2 || IMU_FIR_MAX_FACTOR < factor) {
+        return false;
+    }
+
+    memset(fir, 0, sizeof(*fir));
+    fir->factor = factor;
+    fir->taps   = IMU_FIR_TAPS_PER_FACTOR * factor + 1;
+
+    /** @note 遷移域の中央 (出力レートの 0.5 倍) を Cutoff とする．入力レートで正規化した周波数． */
+    double cutoff = 0.5 / factor;
+    double center = (fir->taps - 1) / 2.0;
+    double sum    = 0;
+
+    for (uint32_t i = 0; i < fir->taps; ++i) {
+        double x      = i - center;
+        double sinc   = x == 0 ? 2 * cutoff : sin(2 * PI * cutoff * x) / (PI * x);
+        double window = 0.42 - 0.5 * cos(2 * PI * i / (fir->taps - 1)) + 0.08 * cos(4 * PI * i / (fir->taps - 1));
+        fir->coeffs[i] = sinc * window;
+        sum += fir->coeffs[i];
+    }
+    for (uint32_t i = 0; i < fir->taps; ++i) {
+        fir->coeffs[i] /= sum;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 1 入力サンプルを与える
+ *
+ * @return factor 回に 1 回，out に出力した場合 true
+ */
+bool Imu_Fir_Process(Imu_Fir_t* fir, const float in[IMU_FIR_CHANNELS], float out[IMU_FIR_CHANNELS])
+{
+    uint32_t taps = fir->taps;
+
+    for (int ch = 0; ch < IMU_FIR_CHANNELS; ++ch) {
+        fir->history[ch][fir->pos]        = in[ch];
+        fir->history[ch][fir->pos + taps] = in[ch];
+    }
+    fir->pos = fir->pos + 1 < taps ? fir->pos + 1 : 0;
+
+    if (++fir->phase < fir->factor) {
+        return false;
+    }
+    fir->phase = 0;
+
+    /** @note history[pos .. pos + taps) が古い順に並ぶ． */
+    for (int ch = 0; ch < IMU_FIR_CHANNELS; ++ch) {
+        const float* x = &fir->history[ch][fir->pos];
+        float acc      = 0;
+
+        for (uint32_t i = 0; i < taps; ++i) {
+            acc += fir->coeffs[i] * x[i];
+        }
+        out[ch] = acc;
+    }
+
+    return true;
+}
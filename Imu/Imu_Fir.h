@@ -0,0 +1,32 @@
+#ifndef IMU_FIR_H
+#define IMU_FIR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IMU_FIR_CHANNELS        (6)  /* gx, gy, gz, ax, ay, az */
+#define IMU_FIR_TAPS_PER_FACTOR (28)
+#define IMU_FIR_MAX_FACTOR      (20)
+#define IMU_FIR_MAX_TAPS        (IMU_FIR_TAPS_PER_FACTOR * IMU_FIR_MAX_FACTOR + 1)
+
+/**
+ * @brief 間引き用の FIR (ポリフェーズ)
+ *
+ * @note 出力する入力位相でのみ畳み込みを計算するため，計算量は出力 1 サンプルあたり taps 回の積和．
+ *       係数は Blackman 窓の sinc で，通過域は出力レートの 0.4 倍まで，出力レートの 0.6 倍以上を約 75dB 減衰させる．
+ *       0.4〜0.5 倍の帯域に折り返しが残るため，解析には出力レートの 0.4 倍までを使う．
+ *       係数は対称なので群遅延は (taps - 1) / 2 入力サンプル．
+ */
+typedef struct tagImu_Fir_t {
+    uint32_t factor;
+    uint32_t taps;
+    uint32_t phase; /* Inputs since the last output */
+    uint32_t pos;   /* Next write position in history */
+    float    coeffs[IMU_FIR_MAX_TAPS];
+    float    history[IMU_FIR_CHANNELS][IMU_FIR_MAX_TAPS * 2]; /* Each sample stored twice to avoid wrapping */
+} Imu_Fir_t;
+
+bool Imu_Fir_Init(Imu_Fir_t* fir, uint32_t factor);
+bool Imu_Fir_Process(Imu_Fir_t* fir, const float in[IMU_FIR_CHANNELS], float out[IMU_FIR_CHANNELS]);
+
+#endif /* IMU_FIR_H */
@@ -4,55 +4,187 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
+#include <nuttx/config.h>
 #include <nuttx/sensors/cxd5602pwbimu.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
+#include "Common_Rtc.h"
+#include "Common_Sched.h"
+#include "Common_Trace.h"
+#include "Imu_Decimate.h"
+#include "Imu_Diagnostic.h"
+#include "Imu_Trigger.h"
+#include "Imu_Packed_public.h"
 #include "Logging_Buffer_public.h"
+#include "Logging_Offload_public.h"
+#include "Logging_Pool_public.h"
 #include "Logging_public.h"
 #include "PowerCtrl_public.h"
 
-#define CXD5602PWBIMU_DEVPATH "/dev/imu0"
+#define IMU_DEVPATH_FORMAT    "/dev/imu%d"
+#define IMU_EVENT_PATH_FORMAT "/var/fifo/imu_event%d"
+#define IMU_PATH_LENGTH       (32)
+#define RTC_CLOCK_HZ          (32768)
 
-#define NUM_BUFFERS           (4)
-#define BUFFER_SIZE           (128 * 1024)
-#define IMU_RECORD_NUM        ((BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)) / sizeof(cxd5602pwbimu_data_t))
+#define IMU_DEG_TO_RAD        (3.14159265f / 180.0f)
+
+#define POLL_TIMEOUT_PERIODS  (50)  // Watermark periods without data before poll() gives up
+#define POLL_TIMEOUT_MIN_MS   (100)
+
+#define ACQUISITION_PRIORITY   (Common_Sched_GetPlan(Common_SchedTask_IMU_ACQUISITION)->priority)
+#define ACQUISITION_STACK_SIZE (Common_Sched_GetPlan(Common_SchedTask_IMU_ACQUISITION)->stackSize)
 
+#define NUM_BUFFERS           (4)            /* Per device */
+#define BUFFER_SIZE           (128 * 1024)   /* Block size with a single device */
+#define IMU_RECORD_NUM        ((BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)) / sizeof(cxd5602pwbimu_data_t))
+#define IMU_LOG_PADDING_SIZE                                     \
+        (BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t) \
+        - (IMU_RECORD_NUM * sizeof(cxd5602pwbimu_data_t)))
+
+/**
+ * @note 複数の IMU では NUM_BUFFERS * BUFFER_SIZE の領域を台数で分け，Block を LOGGING_CLUSTER_SIZE の倍数に縮める．
+ *       Header からの配置と padding は Block のサイズによらず同じで，Record 数だけが変わる．
+ */
 typedef struct tagImuLogbuffer_t {
     LogHeader_t          header;
     cxd5602pwbimu_data_t body[IMU_RECORD_NUM];
+    uint8_t              reserved[IMU_LOG_PADDING_SIZE];
     LogFooter_t          footer;
 } ImuLogBuffer_t;
 static_assert(sizeof(ImuLogBuffer_t) == BUFFER_SIZE, "ImuLogBuffer_t size mismatch");
-
+static_assert(IMU_TRIGGER_PRE_BLOCKS_MAX <= NUM_BUFFERS - 2, "Pre-trigger history must leave a block to fill and one to write");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "ImuLogBuffer_t must be a whole number of clusters");
+static_assert(BUFFER_SIZE / IMU_MAX_DEVICES >= LOGGING_CLUSTER_SIZE, "Each device needs at least a cluster per block");
+static_assert(LOGGING_CLUSTER_SIZE % sizeof(cxd5602pwbimu_data_t) == 0, "Padding must not depend on the block size");
+
+#define IMU_PACKED_RECORD_NUM                                                                       \
+        ((BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(ImuPackedFormat_t) - sizeof(LogFooter_t)) \
+        / sizeof(ImuPackedRecord_t))
+#define IMU_STAGE_RECORD_NUM (64)
+
+/** @note ImuLogBuffer_t と同じサイズとし，同じ Pool の Buffer をどちらの形式でも使う． */
+typedef struct tagImuPackedLogBuffer_t {
+    LogHeader_t       header;
+    ImuPackedFormat_t format;
+    ImuPackedRecord_t body[IMU_PACKED_RECORD_NUM];
+    LogFooter_t       footer;
+} ImuPackedLogBuffer_t;
+static_assert(sizeof(ImuPackedLogBuffer_t) == BUFFER_SIZE, "ImuPackedLogBuffer_t size mismatch");
+
+typedef enum tagImuEvent_e {
+    ImuEvent_NONE,
+    ImuEvent_SAMPLE,
+    ImuEvent_SHUTDOWN,
+    ImuEvent_ERROR,
+} ImuEvent_e;
+
+typedef struct tagImuLogging_Statistics_t {
+    uint32_t wakeupCount; /* poll() returns with an event */
+    uint32_t readCount;   /* read() calls on the IMU device */
+    uint32_t sampleCount;
+    uint64_t startTicks;
+    uint64_t busyTicks;          /* RTC ticks spent between poll() wakeup and read() completion */
+    uint32_t overflowCount;      /* Gaps in the sensor timestamp sequence */
+    uint32_t missedSamples;      /* Samples missing from the sensor timestamp sequence */
+    uint32_t timeoutCount;
+    uint32_t discardedSamples;   /* Samples read while no buffer was free */
+    uint32_t lastTimestamp;
+    uint64_t lastWakeupTicks;
+    uint32_t intervalCount;
+    uint64_t totalIntervalError; /* RTC ticks between wakeup interval and the interval the samples cover */
+    uint64_t maxIntervalError;
+    uint64_t sumSquaredIntervalError;
+    uint64_t stopTicks;
+} ImuLogging_Statistics_t;
+
+/**
+ * @brief IMU 1 台分の取得 (Producer)
+ *
+ * @note Buffer，Pool，seqId は IMU 毎に持ち，Block は LogHeader_t.stream に device を入れて共通の Logging タスクへ送る．
+ */
 typedef struct tagImuLogging_t {
-    int                   eventFd;
-    int                   shutdownHandlerId;
-    uint32_t              seqId;
-    Logging_Buffer_Desc_t logdesc;
+    int                     device;
+    int                     eventFd;
+    int                     fifoThreshold;
+    int                     sampleRate;
+    int                     pollTimeoutMs;
+    int                     cpu; /* CPU dedicated to acquisition, or -1 to share the CPUs */
+    uint32_t                blockSize;
+    uint32_t                recordNum; /* Driver records per full-rate block */
+    pthread_t               thread;
+    bool                    isPacked;
+    bool                    isFullRateEnabled;
+    bool                    isTriggered;
+    bool                    isBlockCaptured; /* The block being filled is inside a capture window */
+    uint32_t                preBlocks;
+    uint32_t                numHeld;
+    void*                   held[IMU_TRIGGER_PRE_BLOCKS_MAX]; /* Finalized blocks kept as pre-trigger history, oldest first */
+    uint32_t                capturedBlocks;
+    uint32_t                skippedBlocks;
+    ImuPackedFormat_t       format;
+    float                   accelInvScale;
+    float                   gyroInvScale;
+    cxd5602pwbimu_data_t    stage[IMU_STAGE_RECORD_NUM]; /* Read buffer for packed blocks and "nofull" */
+    struct pollfd           fds[2];
+    LoggingQueue_t          mq;
+    uint32_t                seqId;
+    uint32_t                overrun;
+    ImuDiagnostic_Discard_t discard; /* Samples read without a buffer, written when a buffer is free again */
+    Logging_Buffer_Desc_t   logdesc;
+    Logging_Pool_t          pool;
+    ImuLogging_Statistics_t stats;
 } ImuLogging_t;
 
-static ImuLogBuffer_t imuLogging_buffer[NUM_BUFFERS];
-static ImuLogging_t imuLogging_instance;
+typedef struct tagImuLogging_Group_t {
+    LoggingQueue_t mq;
+    int            shutdownHandlerId;
+    uint32_t       numDevices;
+    uint32_t       blockSize; /* Same for every device */
+    ImuLogging_t   devices[IMU_MAX_DEVICES];
+} ImuLogging_Group_t;
+
+/** @note 共有メモリ，確保できない場合はヒープに置く．Logging タスクが返す前に終了することがあるため解放しない． */
+static uint8_t* imuLogging_buffer;
+static bool imuLogging_isShared;
+static ImuLogging_Group_t imuLogging_instance;
 
-static ImuLogging_t* GetInstance(void)
+static ImuLogging_Group_t* GetInstance(void)
 {
     return &imuLogging_instance;
 }
 
+/** @note 共有の領域の中の位置から Buffer を持つ IMU を求める． */
+static void ReleaseBuffer(void* ptr)
+{
+    ImuLogging_Group_t* group = GetInstance();
+    uint32_t device = ((uint8_t *) ptr - imuLogging_buffer) / (group->blockSize * NUM_BUFFERS);
+
+    Logging_Pool_Release(&group->devices[device].pool, ptr);
+}
+
 static void ShutdownHandler(void)
 {
-    ImuLogging_t* self = GetInstance();
+    ImuLogging_Group_t* group = GetInstance();
+
+    for (uint32_t i = 0; i < group->numDevices; ++i) {
+        char path[IMU_PATH_LENGTH];
 
-    int fd  = open("/var/fifo/imu_event", O_WRONLY);
-    int ret = write(fd, &(uint64_t){ 1 }, sizeof(uint64_t));
+        snprintf(path, sizeof(path), IMU_EVENT_PATH_FORMAT, (int) i);
+        int fd  = open(path, O_WRONLY);
+        int ret = write(fd, &(uint64_t){ 1 }, sizeof(uint64_t));
 
-    close(fd);
+        close(fd);
 
-    printf("ShutdownHandler: write eventfd returned %d\n", ret);
+        printf("ShutdownHandler: write eventfd %u returned %d\n", i, ret);
+    }
 }
 
 static int SetupSensor(int fd, int rate, int adrange, int gdrange, int nfifos)
@@ -113,152 +245,756 @@ static int SetupSensor(int fd, int rate, int adrange, int gdrange, int nfifos)
     return 0;
 } /* SetupSensor */
 
-uint32_t Imu_Logging_Run(void)
+/**
+ * @brief サンプル取得のタイミングを集計する
+ *
+ * @note 欠落はセンサのタイムスタンプの間隔から求める．
+ *       Jitter は起床の間隔と，その間に読めたサンプル数が表す時間との差とする．
+ */
+static void UpdateTiming(ImuLogging_t* self, const cxd5602pwbimu_data_t* samples, uint32_t num, uint64_t now)
 {
-    // int pipefd[2];
+    ImuLogging_Statistics_t* stats = &self->stats;
+    uint32_t period = IMU_TIMESTAMP_HZ / self->sampleRate;
+
+    for (uint32_t i = 0; i < num; ++i) {
+        uint32_t delta = samples[i].timestamp - stats->lastTimestamp;
+        if (stats->sampleCount + i > 0 && delta > period + period / 2) {
+            ImuDiagnostic_Gap_t gap = { 0 };
+
+            gap.header.type   = ImuDiagnostic_Type_GAP;
+            gap.header.device = self->device;
+            gap.header.size   = sizeof(gap);
+            gap.seqId         = self->seqId;
+            gap.time          = now;
+            gap.sampleIndex   = stats->sampleCount + i;
+            gap.prevTimestamp = stats->lastTimestamp;
+            gap.nextTimestamp = samples[i].timestamp;
+            gap.missedSamples = (delta + period / 2) / period - 1;
+            Imu_Diagnostic_Write(&gap);
+
+            stats->overflowCount++;
+            stats->missedSamples += gap.missedSamples;
+        }
+        stats->lastTimestamp = samples[i].timestamp;
+    }
 
-    // pipe(pipefd);
-    // printf("pipefd[0]: %d, pipefd[1]: %d\n", pipefd[0], pipefd[1]);
-    mqd_t mq = Logging_OpenQueue(true);
-    ImuLogging_t* self = GetInstance();
+    if (stats->lastWakeupTicks != 0) {
+        int64_t interval = now - stats->lastWakeupTicks;
+        int64_t expected = (int64_t) num * RTC_CLOCK_HZ / self->sampleRate;
+        uint64_t error   = interval > expected ? interval - expected : expected - interval;
 
-    // int efd = pipefd[1];
+        stats->intervalCount++;
+        stats->totalIntervalError      += error;
+        stats->sumSquaredIntervalError += error * error;
+        if (stats->maxIntervalError < error) {
+            stats->maxIntervalError = error;
+        }
+    }
+    stats->lastWakeupTicks = now;
+}
 
-    // if (efd == -1) {
-    //     perror("eventfd");
-    //     return 1;
-    // }
-    // self->eventFd = efd;
-    int ret = PowerCtrl_SetShutdownCallback(ShutdownHandler);
+/**
+ * @brief FIFO に溜まったサンプルをまとめて読み込む，またはシャットダウン通知を待つ
+ *
+ * @note self->fds は [0]: shutdown event FIFO, [1]: IMU device．
+ *       先頭の IMU のサンプルだけを間引きと Trigger の判定に渡す．
+ *
+ * @param buff   読み込み先
+ * @param size   読み込み先の空きサイズ．サンプルサイズの整数倍に切り捨てて読む．
+ * @param nbytes 読み込んだサイズ
+ */
+static ImuEvent_e WaitSamples(ImuLogging_t* self, void* buff, uint32_t size, uint32_t* nbytes)
+{
+    struct pollfd* fds = self->fds;
+    int ret = poll(fds, 2, self->pollTimeoutMs);
+
+    *nbytes = 0;
+    if (ret < 0) {
+        if (errno != EINTR) {
+            printf("ERROR: poll failed. %d\n", errno);
+            return ImuEvent_ERROR;
+        }
+        return ImuEvent_NONE;
+    }
+    if (ret == 0) {
+        ImuDiagnostic_Timeout_t timeout = { 0 };
+
+        timeout.header.type   = ImuDiagnostic_Type_TIMEOUT;
+        timeout.header.device = self->device;
+        timeout.header.size   = sizeof(timeout);
+        timeout.seqId         = self->seqId;
+        timeout.time          = Common_Rtc_GetCount(Common_RtcChannel_1);
+        timeout.lastTimestamp = self->stats.lastTimestamp;
+        timeout.timeoutMs     = self->pollTimeoutMs;
+        Imu_Diagnostic_Write(&timeout);
+
+        self->stats.timeoutCount++;
+        COMMON_TRACE(IMU_TIMEOUT, self->device, self->pollTimeoutMs, self->stats.lastTimestamp);
+        return ImuEvent_NONE;
+    }
 
-    if (ret == ERROR) {
-        printf("ERROR: Failed to set shutdown callback. %d\n", ret);
-        // close(efd);
-        return 1;
+    uint64_t start = Common_Rtc_GetCount(Common_RtcChannel_1);
+    self->stats.wakeupCount++;
+
+    if (fds[0].revents & POLLIN) {
+        uint64_t value;
+        ret = read(fds[0].fd, &value, sizeof(value));
+        if (ret < 0) {
+            printf("ERROR: eventfd read failed. %d\n", errno);
+            return ImuEvent_ERROR;
+        }
+        printf("Shutdown signal received.\n");
+        return ImuEvent_SHUTDOWN;
+    }
+    if (fds[1].revents & POLLIN) {
+        size -= size % sizeof(cxd5602pwbimu_data_t);
+        ret   = read(fds[1].fd, buff, size);
+        self->stats.readCount++;
+        if (ret <= 0 || ret % sizeof(cxd5602pwbimu_data_t) != 0) {
+            printf("ERROR: read size mismatch! %d\n", ret);
+            return ImuEvent_NONE;
+        }
+        *nbytes = ret;
+        UpdateTiming(self, buff, ret / sizeof(cxd5602pwbimu_data_t), start);
+        if (self->device == 0) {
+            Imu_Decimate_Process(buff, ret / sizeof(cxd5602pwbimu_data_t));
+        }
+        if (self->isTriggered && Imu_Trigger_Process(buff, ret / sizeof(cxd5602pwbimu_data_t), self->seqId)) {
+            self->isBlockCaptured = true;
+        }
+        self->stats.sampleCount += ret / sizeof(cxd5602pwbimu_data_t);
+        self->stats.busyTicks   += Common_Rtc_GetCount(Common_RtcChannel_1) - start;
+        return ImuEvent_SAMPLE;
     }
-    self->shutdownHandlerId = ret;
-    self->seqId = 0;
 
-    int fd;
-    struct pollfd fds[2];
+    return ImuEvent_NONE;
+} /* WaitSamples */
 
-    ret = mkfifo("/var/fifo/imu_event", 0666);
-    printf("mkfifo ret: %d, errno: %d\n", ret, errno);
-    fds[0].fd = open("/var/fifo/imu_event", O_RDWR);
-    if (fds[0].fd < 0) {
-        printf("ERROR: Failed to create event FIFO. %d\n", errno);
-        return 1;
+/**
+ * @brief 起床間隔の誤差の標準偏差 [us]
+ *
+ * @note 取得スレッドの CPU と優先度の割り当ての良し悪しはこの値と最大値に現れる．
+ */
+static uint32_t GetJitterStdUs(const ImuLogging_Statistics_t* stats)
+{
+    if (stats->intervalCount == 0) {
+        return 0;
     }
-    fds[0].events = POLLIN;
-    printf("Event FIFO created and opened: %d\n", fds[0].fd);
-    // struct timespec start, now, delta;
-    // cxd5602pwbimu_data_t *outbuf = NULL;
+    float mean     = (float) stats->totalIntervalError / stats->intervalCount;
+    float variance = (float) stats->sumSquaredIntervalError / stats->intervalCount - mean * mean;
 
-    /* Sensing parameters, see start sensing function. */
+    return variance > 0 ? (uint32_t) (sqrtf(variance) * 1000000 / RTC_CLOCK_HZ) : 0;
+}
 
-    const int samplerate = 1920;
-    const int adrange    = 16;
-    const int gdrange    = 1000;
-    const int nfifos     = 4;
+/**
+ * @brief 取得ループの統計を診断 Record としてログに残す
+ */
+static void WriteStatistics(ImuLogging_t* self)
+{
+    ImuDiagnostic_Statistics_t record = { 0 };
+
+    record.header.type   = ImuDiagnostic_Type_STATISTICS;
+    record.header.device = self->device;
+    record.header.size   = sizeof(record);
+    record.seqId         = self->seqId;
+    record.time          = Common_Rtc_GetCount(Common_RtcChannel_1);
+    record.sampleRate    = self->sampleRate;
+    record.fifoThreshold = self->fifoThreshold;
+    record.wakeupCount   = self->stats.wakeupCount;
+    record.sampleCount   = self->stats.sampleCount;
+    record.overflowCount = self->stats.overflowCount;
+    record.missedSamples = self->stats.missedSamples;
+    record.timeoutCount  = self->stats.timeoutCount;
+    record.jitterStdUs   = GetJitterStdUs(&self->stats);
+    record.jitterMaxUs   = self->stats.maxIntervalError * 1000000 / RTC_CLOCK_HZ;
+    Imu_Diagnostic_Write(&record);
+}
 
-    fd = open(CXD5602PWBIMU_DEVPATH, O_RDONLY);
-    if (fd < 0) {
-        printf("ERROR: Device %s open failure. fd: %d error:%d\n", CXD5602PWBIMU_DEVPATH, fd, errno);
-        return 1;
+/**
+ * @brief FIFO の Watermark を決める
+ *
+ * @note maxLatencyUs を超えない範囲で最も多くのサンプルをまとめて起床回数を減らす．
+ *       ハードウェアの上限 IMU_FIFO_THRESHOLD_MAX を超える分は起床の間隔を延ばせない．
+ */
+static int ChooseFifoThreshold(int sampleRate, int maxLatencyUs)
+{
+    int threshold = (int64_t) sampleRate * maxLatencyUs / 1000000;
+
+    if (threshold < IMU_FIFO_THRESHOLD_MIN) {
+        threshold = IMU_FIFO_THRESHOLD_MIN;
+    } else if (threshold > IMU_FIFO_THRESHOLD_MAX) {
+        threshold = IMU_FIFO_THRESHOLD_MAX;
     }
-    printf("Opened device %s successfully. fd: %d\n", CXD5602PWBIMU_DEVPATH, fd);
+    return threshold;
+}
 
-    // outbuf = (cxd5602pwbimu_data_t *)malloc(sizeof(cxd5602pwbimu_data_t) * samplerate * 10);
-    // if (outbuf == NULL)
-    // {
-    //     printf("ERROR: Output buffer allocation failed.\n");
-    //     return 1;
-    // }
+static void PrintStatistics(ImuLogging_t* self)
+{
+    uint64_t elapsed = self->stats.stopTicks - self->stats.startTicks;
+    Logging_Pool_Statistics_t pool;
 
-    fds[1].fd     = fd;
-    fds[1].events = POLLIN;
+    Logging_Pool_GetStatistics(&self->pool, &pool);
+    printf("imu%d: %uKiB blocks\n", self->device, self->blockSize / 1024);
+    printf("Buffers acquired:%u overrun:%u max in use:%u/%u\n",
+        pool.acquireCount, pool.overrunCount, pool.maxInUse, NUM_BUFFERS);
 
-    ret = SetupSensor(fd, samplerate, adrange, gdrange, nfifos);
-    if (ret) {
-        close(fd);
-        return ret;
+    if (elapsed == 0 || self->stats.wakeupCount == 0) {
+        return;
+    }
+    printf("FIFO threshold:%d wakeups:%u (%u/s) reads:%u samples:%u (%u/wakeup) read load:%u.%02u%%\n",
+        self->fifoThreshold,
+        self->stats.wakeupCount,
+        (uint32_t) ((uint64_t) self->stats.wakeupCount * RTC_CLOCK_HZ / elapsed),
+        self->stats.readCount,
+        self->stats.sampleCount,
+        self->stats.sampleCount / self->stats.wakeupCount,
+        (uint32_t) (self->stats.busyTicks * 100 / elapsed),
+        (uint32_t) (self->stats.busyTicks * 10000 / elapsed % 100));
+    printf("Watermark:%d samples at %dHz, overflows:%u timeouts:%u\n",
+        self->fifoThreshold, self->sampleRate, self->stats.overflowCount, self->stats.timeoutCount);
+    printf("Acquisition on %s: missed samples:%u wakeup jitter avg:%uus std:%uus max:%uus\n",
+        self->cpu < 0 ? "shared CPUs" : "dedicated CPU",
+        self->stats.missedSamples,
+        (uint32_t) (self->stats.intervalCount
+        ? self->stats.totalIntervalError * 1000000 / RTC_CLOCK_HZ / self->stats.intervalCount : 0),
+        GetJitterStdUs(&self->stats),
+        (uint32_t) (self->stats.maxIntervalError * 1000000 / RTC_CLOCK_HZ));
+}
+
+/**
+ * @brief Driver の出力形式のまま Block を埋める
+ *
+ * @return 取得を続ける場合 true
+ */
+static bool FillBlock(ImuLogging_t* self, ImuLogBuffer_t* buff)
+{
+    Logging_Buffer_Init(&self->logdesc, LoggingUser_IMU, self->seqId, self->overrun, buff, self->blockSize);
+    self->overrun = 0;
+
+    /** @note Buffer の残り全てを読み込み先として渡し，溜まっているサンプルを 1 回の read で取り込む． */
+    while (Logging_Buffer_GetRemainingSize(&self->logdesc) - IMU_LOG_PADDING_SIZE >= sizeof(cxd5602pwbimu_data_t)) {
+        uint32_t nbytes;
+        ImuEvent_e event = WaitSamples(self, Logging_Buffer_GetNextPos(&self->logdesc),
+                Logging_Buffer_GetRemainingSize(&self->logdesc) - IMU_LOG_PADDING_SIZE, &nbytes);
+        if (event == ImuEvent_SAMPLE) {
+            Logging_Buffer_Update(&self->logdesc, nbytes);
+        } else if (event != ImuEvent_NONE) {
+            return false;
+        }
     }
+    return true;
+}
 
-    uint32_t seqId = 0;
-    int errval     = 0;
+static int16_t Quantize(float value, float invScale)
+{
+    float lsb = value * invScale;
 
-    bool isRunning = true;
-    while (isRunning) {
-        ImuLogBuffer_t* buff = &imuLogging_buffer[seqId % NUM_BUFFERS];
-        for (uint32_t i = 0; i < IMU_RECORD_NUM; ++i) {
-            ssize_t ret = poll(fds, 2, 1000);
-
-            if (ret < 0) {
-                errval = errno;
-                if (errval != EINTR) {
-                    printf("ERROR: poll failed. %d\n", errval);
-                }
-                break;
-            }
-            if (ret == 0) {
-                printf("Timeout!\n");
+    if (lsb >= INT16_MAX) {
+        return INT16_MAX;
+    } else if (lsb <= -INT16_MAX) {
+        return -INT16_MAX;
+    }
+    return (int16_t) (lsb < 0 ? lsb - 0.5f : lsb + 0.5f);
+}
+
+/**
+ * @brief サンプルを固定小数点に変換して Block を埋める
+ *
+ * @note 一旦 stage に読み込み，変換しながら Buffer に書き込む．
+ *
+ * @return 取得を続ける場合 true
+ */
+static bool FillPackedBlock(ImuLogging_t* self, ImuPackedLogBuffer_t* buff)
+{
+    bool isFirst = true;
+
+    Logging_Buffer_Init(&self->logdesc, LoggingUser_IMU_PACKED, self->seqId, self->overrun, buff, self->blockSize);
+    Logging_Buffer_Write(&self->logdesc, &self->format, sizeof(self->format));
+    self->overrun = 0;
+
+    while (Logging_Buffer_GetRemainingSize(&self->logdesc) >= sizeof(ImuPackedRecord_t)) {
+        uint32_t num = Logging_Buffer_GetRemainingSize(&self->logdesc) / sizeof(ImuPackedRecord_t);
+        uint32_t nbytes;
+
+        if (num > IMU_STAGE_RECORD_NUM) {
+            num = IMU_STAGE_RECORD_NUM;
+        }
+        ImuEvent_e event = WaitSamples(self, self->stage, num * sizeof(cxd5602pwbimu_data_t), &nbytes);
+        if (event == ImuEvent_SAMPLE) {
+            ImuPackedRecord_t* dst = Logging_Buffer_GetNextPos(&self->logdesc);
+
+            num = nbytes / sizeof(cxd5602pwbimu_data_t);
+            for (uint32_t i = 0; i < num; ++i) {
+                const cxd5602pwbimu_data_t* src = &self->stage[i];
+
+                dst[i].timestamp = src->timestamp;
+                dst[i].gyro[0]   = Quantize(src->gx, self->gyroInvScale);
+                dst[i].gyro[1]   = Quantize(src->gy, self->gyroInvScale);
+                dst[i].gyro[2]   = Quantize(src->gz, self->gyroInvScale);
+                dst[i].accel[0]  = Quantize(src->ax, self->accelInvScale);
+                dst[i].accel[1]  = Quantize(src->ay, self->accelInvScale);
+                dst[i].accel[2]  = Quantize(src->az, self->accelInvScale);
             }
-            if (i == 0) {
-                Logging_Buffer_Init(&self->logdesc, LoggingUser_IMU, seqId, buff, sizeof(ImuLogBuffer_t));
+            if (isFirst) {
+                buff->format.temp = self->stage[0].temp;
+                isFirst = false;
             }
+            Logging_Buffer_Update(&self->logdesc, num * sizeof(ImuPackedRecord_t));
+        } else if (event != ImuEvent_NONE) {
+            return false;
+        }
+    }
+    return true;
+} /* FillPackedBlock */
 
-            if (fds[1].revents & POLLIN) {
-                ret = read(fd, &buff->body[i], sizeof(cxd5602pwbimu_data_t));
-                if (ret != sizeof(cxd5602pwbimu_data_t)) {
-                    printf("ERROR: read size mismatch! %d\n", ret);
-                }
-                Logging_Buffer_Update(&self->logdesc, sizeof(cxd5602pwbimu_data_t));
-            }
-            if (fds[0].revents & POLLIN) {
-                printf("Received shutdown signal.\n");
-                uint64_t value;
-                ret = read(fds[0].fd, &value, sizeof(value));
-                printf("Eventfd read value: %llu\n", value);
-                if (ret < 0) {
-                    errval = errno;
-                    printf("ERROR: eventfd read failed. %d\n", errval);
-                    break;
-                }
-                if (value > 0) {
-                    printf("Shutdown signal received.\n");
-                    errval = -1; // Set to 0 to indicate graceful shutdown
-                    break;
+static void SendBlock(ImuLogging_t* self, void* buff)
+{
+    LoggingDesc_t desc = { 0 };
+
+    desc.ptr      = buff;
+    desc.user     = ((LogHeader_t *) buff)->user; /* IMU or IMU_PACKED */
+    desc.type     = LoggingType_WRITE;
+    desc.size     = self->blockSize;
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &self->overrun);
+}
+
+/**
+ * @brief Finalize した Block を送る，または Trigger 待ちの履歴として残す
+ *
+ * @note Trigger 方式では，取得窓に掛かった Block の前に履歴の Block をまとめて送る．
+ *       窓に掛からなかった Block は，履歴から押し出された時点で書き込まずに Pool に返す．
+ *       Block の seqId は送らなかった分も進むため，ログ上の seqId の飛びが保存しなかった区間を示す．
+ */
+static void SubmitBlock(ImuLogging_t* self, void* buff)
+{
+    if (!self->isTriggered || self->isBlockCaptured) {
+        for (uint32_t i = 0; i < self->numHeld; ++i) {
+            SendBlock(self, self->held[i]);
+        }
+        self->capturedBlocks += self->numHeld + 1;
+        self->numHeld = 0;
+        SendBlock(self, buff);
+    } else if (self->preBlocks == 0) {
+        Logging_Pool_Release(&self->pool, buff);
+        self->skippedBlocks++;
+    } else {
+        if (self->numHeld == self->preBlocks) {
+            Logging_Pool_Release(&self->pool, self->held[0]);
+            memmove(&self->held[0], &self->held[1], sizeof(self->held[0]) * (self->numHeld - 1));
+            self->numHeld--;
+            self->skippedBlocks++;
+        }
+        self->held[self->numHeld++] = buff;
+    }
+    self->isBlockCaptured = false;
+}
+
+/**
+ * @brief サンプルを Buffer に詰め，Finalize した Block を Logging タスクへ渡す
+ */
+static void* AcquisitionLoop(void* arg)
+{
+    ImuLogging_t* self = arg;
+
+    bool isRunning = true;
+    while (isRunning && !self->isFullRateEnabled) {
+        /** @note 全レートを残さない場合は stage に読み，間引いたストリームだけを送る． */
+        uint32_t nbytes;
+        uint32_t prevCount = self->stats.sampleCount;
+        ImuEvent_e event   = WaitSamples(self, self->stage, sizeof(self->stage), &nbytes);
+
+        isRunning = event != ImuEvent_SHUTDOWN && event != ImuEvent_ERROR;
+        if (prevCount / self->recordNum != self->stats.sampleCount / self->recordNum) {
+            WriteStatistics(self);
+        }
+    }
+    while (isRunning) {
+        ImuLogBuffer_t* buff = Logging_Pool_Acquire(&self->pool);
+        if (buff == NULL) {
+            /** @note 空き Buffer が無い間もデバイスを読み捨て，落としたサイズを次の Block に記録する． */
+            cxd5602pwbimu_data_t discard[IMU_FIFO_THRESHOLD_MAX];
+            uint32_t nbytes;
+            ImuEvent_e event = WaitSamples(self, discard, sizeof(discard), &nbytes);
+            if (nbytes > 0) {
+                if (self->discard.discardedSamples == 0) {
+                    self->discard.firstTimestamp = discard[0].timestamp;
                 }
-                isRunning = false; // Exit the loop if shutdown signal is received
-            }
-            if (!isRunning) {
-                break;
+                self->discard.lastTimestamp     = discard[nbytes / sizeof(discard[0]) - 1].timestamp;
+                self->discard.discardedSamples += nbytes / sizeof(discard[0]);
+                self->stats.discardedSamples   += nbytes / sizeof(discard[0]);
             }
+            self->overrun += nbytes;
+            isRunning = event != ImuEvent_SHUTDOWN && event != ImuEvent_ERROR;
+            continue;
+        }
+
+        if (self->discard.discardedSamples > 0) {
+            self->discard.header.type   = ImuDiagnostic_Type_DISCARD;
+            self->discard.header.device = self->device;
+            self->discard.header.size   = sizeof(self->discard);
+            self->discard.seqId         = self->seqId;
+            self->discard.time          = Common_Rtc_GetCount(Common_RtcChannel_1);
+            Imu_Diagnostic_Write(&self->discard);
+            memset(&self->discard, 0, sizeof(self->discard));
+        }
+
+        if (self->isPacked) {
+            isRunning = FillPackedBlock(self, (ImuPackedLogBuffer_t *) buff);
+        } else {
+            isRunning = FillBlock(self, buff);
         }
         Logging_Buffer_Finalize(&self->logdesc);
-        LoggingDesc_t desc = { 0 };
-        desc.ptr  = buff;
-        desc.user = LoggingUser_IMU;
-        desc.type = LoggingType_WRITE;
-        desc.size = sizeof(ImuLogBuffer_t);
-        Logging_SendQueue(mq, &desc);
-        if (errval != 0) {
-            break;
+        SubmitBlock(self, buff);
+        self->seqId++;
+        WriteStatistics(self);
+    }
+    self->stats.stopTicks = Common_Rtc_GetCount(Common_RtcChannel_1);
+
+    /** @note 終了時に残った履歴は窓に掛かっていないため書き込まない． */
+    for (uint32_t i = 0; i < self->numHeld; ++i) {
+        Logging_Pool_Release(&self->pool, self->held[i]);
+    }
+    self->numHeld = 0;
+
+    return NULL;
+} /* AcquisitionLoop */
+
+/**
+ * @brief IMU 1 台の取得スレッドを起動する
+ *
+ * @note cpu を指定した場合は取得ループをその CPU に固定した高優先度のスレッドで動かし，
+ *       SD への書き込みや GNSS と CPU を取り合わないようにする．
+ */
+static int AcquisitionStart(ImuLogging_t* self)
+{
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t cpuset;
+    int ret;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, ACQUISITION_STACK_SIZE);
+    param.sched_priority = ACQUISITION_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+    if (self->cpu >= 0) {
+        CPU_ZERO(&cpuset);
+        CPU_SET(self->cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+
+    ret = pthread_create(&self->thread, &attr, AcquisitionLoop, self);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        printf("ERROR: Failed to create acquisition thread for imu%d. %d\n", self->device, ret);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+/**
+ * @brief 全ての IMU の取得ループを実行し，終了まで待ち合わせる
+ *
+ * @note 1 台で CPU を固定しない場合は呼び出したタスクでそのまま実行する．
+ */
+static int AcquisitionRun(ImuLogging_Group_t* group)
+{
+    uint32_t started = 0;
+
+    if (group->numDevices == 1 && group->devices[0].cpu < 0) {
+        AcquisitionLoop(&group->devices[0]);
+        return OK;
+    }
+
+    while (started < group->numDevices && AcquisitionStart(&group->devices[started]) == OK) {
+        started++;
+    }
+    if (started < group->numDevices) {
+        ShutdownHandler();
+    }
+    for (uint32_t i = 0; i < started; ++i) {
+        pthread_join(group->devices[i].thread, NULL);
+    }
+
+    return started == group->numDevices ? OK : ERROR;
+}
+
+/**
+ * @brief IMU 毎と合計の取得・書き込みの速度を表示する
+ *
+ * @note 台数を変えて実行し，合計の値から Logging タスクまでを含めた台数に対するスケーリングを見る．
+ */
+static void PrintThroughput(ImuLogging_Group_t* group)
+{
+    uint32_t totalSamples = 0;
+    uint32_t totalBytes   = 0;
+    uint32_t totalDropped = 0;
+
+    for (uint32_t i = 0; i < group->numDevices; ++i) {
+        ImuLogging_t* self = &group->devices[i];
+        uint64_t elapsed   = self->stats.stopTicks - self->stats.startTicks;
+        uint32_t dropped   = self->stats.missedSamples + self->stats.discardedSamples;
+        uint32_t samples;
+        uint32_t bytes;
+
+        if (elapsed == 0) {
+            continue;
+        }
+        samples = (uint64_t) self->stats.sampleCount * RTC_CLOCK_HZ / elapsed;
+        bytes   = (uint64_t) self->capturedBlocks * self->blockSize * RTC_CLOCK_HZ / elapsed;
+        printf("Throughput imu%d on %s: %u samples/s, %uKiB/s written, dropped samples:%u\n",
+            self->device, self->cpu < 0 ? "shared CPUs" : "dedicated CPU", samples, bytes / 1024, dropped);
+        totalSamples += samples;
+        totalBytes   += bytes;
+        totalDropped += dropped;
+    }
+    printf("Throughput total (%u devices): %u samples/s, %uKiB/s written, dropped samples:%u\n",
+        group->numDevices, totalSamples, totalBytes / 1024, totalDropped);
+}
+
+static void CloseDevices(ImuLogging_Group_t* group, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; ++i) {
+        close(group->devices[i].fds[0].fd);
+        close(group->devices[i].fds[1].fd);
+    }
+}
+
+/**
+ * @brief 全 IMU の Buffer 領域を確保する
+ *
+ * @note ASMP Worker が CRC と圧縮を行えるよう共有メモリに置き，CRC は Logging タスク側に任せる．
+ *       共有メモリを確保できない場合はヒープに置き，CRC は従来通り Finalize で計算する．
+ *       静的に持つと共有メモリと二重に RAM を使うため，必要になった時だけ確保する．
+ */
+static int AllocateBuffers(void)
+{
+    const uint32_t size = NUM_BUFFERS * BUFFER_SIZE;
+
+    imuLogging_buffer = Logging_Offload_AllocateBuffers(size);
+    if (imuLogging_buffer != NULL) {
+        imuLogging_isShared = true;
+        return OK;
+    }
+#ifdef CONFIG_ASMP
+    printf("WARNING: Failed to allocate shared buffers, computing CRC locally.\n");
+#endif
+
+    uint8_t* mem = malloc(size + LOGGING_BUFFER_ALIGNMENT);
+    if (mem == NULL) {
+        return ERROR;
+    }
+    imuLogging_buffer = (uint8_t *) (((uintptr_t) mem + LOGGING_BUFFER_ALIGNMENT - 1)
+        & ~(uintptr_t) (LOGGING_BUFFER_ALIGNMENT - 1));
+    return OK;
+}
+
+/**
+ * @brief IMU 1 台を開いて設定し，Buffer を割り当てる
+ *
+ * @param buffers この IMU に割り当てる NUM_BUFFERS 個の Block の領域
+ */
+static int SetupDevice(ImuLogging_t* self, const ImuLogging_Config_t* config, int nfifos, uint8_t* buffers,
+    uint32_t options)
+{
+    ImuLogging_Group_t* group = GetInstance();
+    struct pollfd* fds = self->fds;
+    const int adrange  = 16;
+    const int gdrange  = 1000;
+    char path[IMU_PATH_LENGTH];
+    int ret;
+
+    snprintf(path, sizeof(path), IMU_EVENT_PATH_FORMAT, self->device);
+    ret = mkfifo(path, 0666);
+    printf("mkfifo %s ret: %d, errno: %d\n", path, ret, errno);
+    fds[0].fd = open(path, O_RDWR);
+    if (fds[0].fd < 0) {
+        printf("ERROR: Failed to create event FIFO. %d\n", errno);
+        return ERROR;
+    }
+    fds[0].events = POLLIN;
+
+    snprintf(path, sizeof(path), IMU_DEVPATH_FORMAT, self->device);
+    fds[1].fd = open(path, O_RDONLY);
+    if (fds[1].fd < 0) {
+        printf("ERROR: Device %s open failure. fd: %d error:%d\n", path, fds[1].fd, errno);
+        close(fds[0].fd);
+        return ERROR;
+    }
+    fds[1].events = POLLIN;
+    printf("Opened device %s successfully. fd: %d\n", path, fds[1].fd);
+
+    ret = SetupSensor(fds[1].fd, config->sampleRate, adrange, gdrange, nfifos);
+    if (ret) {
+        close(fds[0].fd);
+        close(fds[1].fd);
+        return ERROR;
+    }
+
+    self->mq            = group->mq;
+    self->seqId         = 0;
+    self->fifoThreshold = nfifos;
+    self->sampleRate    = config->sampleRate;
+    self->pollTimeoutMs = nfifos * 1000 * POLL_TIMEOUT_PERIODS / config->sampleRate;
+    if (self->pollTimeoutMs < POLL_TIMEOUT_MIN_MS) {
+        self->pollTimeoutMs = POLL_TIMEOUT_MIN_MS;
+    }
+    self->cpu       = config->cpus[self->device];
+    self->blockSize = group->blockSize;
+    self->recordNum = (group->blockSize - sizeof(LogHeader_t) - sizeof(LogFooter_t)) / sizeof(cxd5602pwbimu_data_t);
+
+    Logging_Pool_Init(&self->pool, buffers, self->blockSize, NUM_BUFFERS);
+    self->overrun = 0;
+    memset(&self->discard, 0, sizeof(self->discard));
+    memset(&self->stats, 0, sizeof(self->stats));
+    self->stats.startTicks = Common_Rtc_GetCount(Common_RtcChannel_1);
+
+    Logging_Buffer_SetOptions(&self->logdesc, options);
+    Logging_Buffer_SetRecordSize(&self->logdesc, sizeof(cxd5602pwbimu_data_t));
+    Logging_Buffer_SetStream(&self->logdesc, self->device);
+
+    /** @note 間引きと Trigger は先頭の IMU のみ． */
+    self->isFullRateEnabled = config->isFullRateEnabled;
+    self->isTriggered       = config->isTriggered && self->device == 0;
+    self->isBlockCaptured   = false;
+    self->preBlocks         = config->triggerPreBlocks;
+    self->numHeld           = 0;
+    self->capturedBlocks    = 0;
+    self->skippedBlocks     = 0;
+
+    self->isPacked = config->isPacked;
+    if (self->isPacked) {
+        /** @note Full scale を INT16_MAX に合わせる．16g で約 0.5mg，1000dps で約 0.03dps の分解能． */
+        self->format.accelRange = adrange;
+        self->format.gyroRange  = gdrange;
+        self->format.accelScale = adrange * IMU_GRAVITY / INT16_MAX;
+        self->format.gyroScale  = gdrange * IMU_DEG_TO_RAD / INT16_MAX;
+        self->format.temp       = 0;
+        self->accelInvScale     = 1.0f / self->format.accelScale;
+        self->gyroInvScale      = 1.0f / self->format.gyroScale;
+        Logging_Buffer_SetRecordSize(&self->logdesc, sizeof(ImuPackedRecord_t));
+    }
+
+    return OK;
+} /* SetupDevice */
+
+uint32_t Imu_Logging_Run(const ImuLogging_Config_t* config)
+{
+    ImuLogging_Group_t* group = GetInstance();
+
+    if (config->numDevices == 0 || IMU_MAX_DEVICES < config->numDevices) {
+        printf("ERROR: Number of devices out of range. %u\n", config->numDevices);
+        return 1;
+    }
+    group->numDevices = config->numDevices;
+    /** @note 台数に関わらず同じ領域を分け合い，書き込みの単位を Cluster の倍数に保つ． */
+    group->blockSize  = BUFFER_SIZE / group->numDevices / LOGGING_CLUSTER_SIZE * LOGGING_CLUSTER_SIZE;
+
+    group->mq = Logging_OpenQueue(true);
+    Imu_Diagnostic_Init(group->mq);
+
+    int ret = PowerCtrl_SetShutdownCallback(ShutdownHandler);
+
+    if (ret == ERROR) {
+        printf("ERROR: Failed to set shutdown callback. %d\n", ret);
+        return 1;
+    }
+    group->shutdownHandlerId = ret;
+
+    /* Sensing parameters, see start sensing function. */
+
+    const int samplerate = config->sampleRate;
+    int nfifos = config->fifoThreshold;
+
+    if (samplerate <= 0) {
+        printf("ERROR: Invalid sample rate. %d\n", samplerate);
+        return 1;
+    }
+    if (nfifos == IMU_FIFO_THRESHOLD_AUTO) {
+        nfifos = ChooseFifoThreshold(samplerate, config->maxLatencyUs);
+    }
+    if (nfifos < IMU_FIFO_THRESHOLD_MIN || IMU_FIFO_THRESHOLD_MAX < nfifos) {
+        printf("ERROR: FIFO threshold out of range. %d\n", nfifos);
+        return 1;
+    }
+    printf("FIFO watermark %d samples (%dus at %dHz), %u devices with %uKiB blocks\n",
+        nfifos, nfifos * 1000000 / samplerate, samplerate, group->numDevices, group->blockSize / 1024);
+
+    if (config->isTriggered && (!config->isFullRateEnabled || config->triggerPreBlocks > IMU_TRIGGER_PRE_BLOCKS_MAX)) {
+        /** @note 履歴に加えて，埋めている Block と書き込み中の Block の分の空きを残す． */
+        printf("ERROR: Trigger needs the full-rate stream and at most %d pre blocks.\n",
+            IMU_TRIGGER_PRE_BLOCKS_MAX);
+        return 1;
+    }
+
+    /** @note サンプル毎の CRC 更新を避け，Finalize でまとめて計算する． */
+    uint32_t options = Logging_BufferOption_DEFERRED_CRC;
+
+    if (imuLogging_buffer == NULL && AllocateBuffers() != OK) {
+        printf("ERROR: Failed to allocate buffers.\n");
+        return 1;
+    }
+    if (imuLogging_isShared) {
+        options = Logging_BufferOption_OFFLOAD_CRC;
+    }
+
+    for (uint32_t i = 0; i < group->numDevices; ++i) {
+        ImuLogging_t* self = &group->devices[i];
+
+        self->device = i;
+        if (SetupDevice(self, config, nfifos, imuLogging_buffer + i * NUM_BUFFERS * group->blockSize, options) != OK) {
+            CloseDevices(group, i);
+            return 1;
         }
-        seqId++;
     }
 
-    LoggingDesc_t endDesc;
+    if (config->isTriggered) {
+        Imu_Trigger_Init(samplerate, config->triggerAccel, config->triggerGyro, config->triggerPostMs);
+    }
+    if (Imu_Decimate_Init(group->mq, samplerate, config->decimateFactors, config->numDecimated) != OK) {
+        CloseDevices(group, group->numDevices);
+        return 1;
+    }
+
+    if (AcquisitionRun(group) != OK) {
+        CloseDevices(group, group->numDevices);
+        return 1;
+    }
+
+    Imu_Decimate_Flush();
+    if (group->devices[0].isTriggered) {
+        Imu_Trigger_Flush(group->devices[0].seqId);
+    }
+    for (uint32_t i = 0; i < group->numDevices; ++i) {
+        WriteStatistics(&group->devices[i]);
+    }
+    Imu_Diagnostic_Flush();
+
+    LoggingDesc_t endDesc = { 0 };
     endDesc.ptr  = NULL;
     endDesc.user = LoggingUser_IMU;
     endDesc.type = LoggingType_END;
     endDesc.size = 0;
-    Logging_SendQueue(mq, &endDesc);
-    PowerCtrl_NotifyStop(self->shutdownHandlerId);
+    Logging_SendQueue(group->mq, &endDesc);
+    PowerCtrl_NotifyStop(group->shutdownHandlerId);
 
-    /* Save the latest written position */
+    CloseDevices(group, group->numDevices);
 
-    close(fd);
+    for (uint32_t i = 0; i < group->numDevices; ++i) {
+        PrintStatistics(&group->devices[i]);
+    }
+    PrintThroughput(group);
+    Imu_Decimate_PrintStatistics();
+    if (group->devices[0].isTriggered) {
+        ImuLogging_t* self = &group->devices[0];
+        ImuTrigger_Statistics_t trigger;
+
+        Imu_Trigger_GetStatistics(&trigger);
+        printf("Trigger: windows:%u triggers:%u blocks captured:%u skipped:%u summaries:%u\n",
+            trigger.windowCount, trigger.triggerCount, self->capturedBlocks, self->skippedBlocks,
+            trigger.summaryCount);
+    }
 
     printf("Finished.\n");
 
@@ -1,8 +1,47 @@
 #ifndef IMU_LOGGING_H
 #define IMU_LOGGING_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-uint32_t Imu_Logging_Run(void);
+#define IMU_FIFO_THRESHOLD_AUTO    (0) /* Derive from the sample rate and maxLatencyUs */
+#define IMU_FIFO_THRESHOLD_MIN     (1)
+#define IMU_FIFO_THRESHOLD_MAX     (4)
+
+#define IMU_TIMESTAMP_HZ           (19200000) /* cxd5602pwbimu_data_t.timestamp counts at 19.2MHz */
+#define IMU_GRAVITY                (9.80665f) /* [m/s^2] */
+#define IMU_SAMPLE_RATE_DEFAULT    (1920)
+#define IMU_MAX_LATENCY_US_DEFAULT (5000)
+
+#define IMU_DECIMATE_MAX_STREAMS   (2)
+
+#define IMU_TRIGGER_ACCEL_DEFAULT    (2.0f) /* Deviation from 1G [m/s^2] */
+#define IMU_TRIGGER_GYRO_DEFAULT     (1.0f) /* [rad/s] */
+#define IMU_TRIGGER_PRE_BLOCKS_MAX   (2)    /* Blocks of history kept before a trigger */
+#define IMU_TRIGGER_POST_MS_DEFAULT  (2000)
+
+#define IMU_ACQUISITION_CPU_SHARED    (-1) /* Run acquisition on the CPU of the calling task */
+#define IMU_ACQUISITION_CPU_DEDICATED (1)  /* SMP CPU given to acquisition with "dedicated" */
+
+#define IMU_MAX_DEVICES            (4) /* /dev/imu0 .. /dev/imu3 */
+
+typedef struct tagImuLogging_Config_t {
+    int      sampleRate;        /* 15, 30, 60, 120, 240, 480, 960 or 1920 [Hz] */
+    int      fifoThreshold;     /* IMU_FIFO_THRESHOLD_AUTO or a fixed watermark */
+    int      maxLatencyUs;      /* Longest time a sample may wait in the FIFO */
+    uint32_t numDevices;        /* IMUs to log, opened as /dev/imu0 .. */
+    int      cpus[IMU_MAX_DEVICES]; /* Per device, IMU_ACQUISITION_CPU_* or a CPU number */
+    bool     isPacked;          /* Store samples as ImuPackedRecord_t */
+    bool     isFullRateEnabled; /* Store the full-rate stream, false to keep only decimated streams */
+    uint32_t numDecimated;      /* Low-rate streams to add */
+    uint32_t decimateFactors[IMU_DECIMATE_MAX_STREAMS]; /* Input samples per output sample */
+    bool     isTriggered;       /* Store only blocks around trigger events */
+    float    triggerAccel;      /* Deviation of |accel| from 1G that triggers [m/s^2] */
+    float    triggerGyro;       /* |gyro| that triggers [rad/s] */
+    uint32_t triggerPreBlocks;  /* Blocks of history stored before the triggering block */
+    uint32_t triggerPostMs;     /* Capture continues this long after the last trigger */
+} ImuLogging_Config_t;
+
+uint32_t Imu_Logging_Run(const ImuLogging_Config_t* config);
 
 #endif /* IMU_LOGGING_H */
\ No newline at end of file
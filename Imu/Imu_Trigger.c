@@ -0,0 +1,147 @@
+#include "Imu_Trigger.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Common_Rtc.h"
+#include "Imu_Diagnostic.h"
+#include "Imu_Logging.h"
+
+/**
+ * @brief 衝撃・動きの検出と低レートの要約
+ *
+ * @note 判定はサンプル毎にベクトルの大きさの二乗と閾値の二乗を比べるだけで，平方根は要約にのみ使う．
+ *       加速度は大きさが 1G から accelThreshold 以上ずれた場合，角速度は大きさが gyroThreshold を超えた場合に検出する．
+ *       検出したバッチから postSamples の間を取得窓とし，窓の中で再び検出すると延長する．
+ */
+typedef struct tagImuTrigger_t {
+    float                   accelLow2;  /* Squared magnitude bounds that do not trigger */
+    float                   accelHigh2;
+    float                   gyro2;
+    uint32_t                postSamples;
+    uint32_t                remaining;  /* Samples left in the current capture window */
+    uint32_t                summarySamples;
+    ImuDiagnostic_Summary_t summary;
+    float                   accelSum;
+    float                   gyroMax2;
+    ImuTrigger_Statistics_t stats;
+} ImuTrigger_t;
+
+static ImuTrigger_t imuTrigger_instance;
+
+static ImuTrigger_t* GetInstance(void)
+{
+    return &imuTrigger_instance;
+}
+
+static void ResetSummary(void)
+{
+    ImuTrigger_t* self = GetInstance();
+
+    memset(&self->summary, 0, sizeof(self->summary));
+    self->summary.accelMin = INFINITY;
+    self->accelSum = 0;
+    self->gyroMax2 = 0;
+}
+
+/**
+ * @param accelThreshold 1G からのずれ [m/s^2]
+ * @param gyroThreshold  [rad/s]
+ * @param postMs         最後の検出から窓を閉じるまでの時間
+ */
+void Imu_Trigger_Init(int sampleRate, float accelThreshold, float gyroThreshold, uint32_t postMs)
+{
+    ImuTrigger_t* self = GetInstance();
+    float low = IMU_GRAVITY - accelThreshold;
+
+    memset(self, 0, sizeof(*self));
+    self->accelLow2      = low > 0 ? low * low : 0;
+    self->accelHigh2     = (IMU_GRAVITY + accelThreshold) * (IMU_GRAVITY + accelThreshold);
+    self->gyro2          = gyroThreshold * gyroThreshold;
+    self->postSamples    = (uint64_t) postMs * sampleRate / 1000;
+    self->summarySamples = sampleRate;
+    ResetSummary();
+}
+
+static void WriteSummary(uint32_t seqId)
+{
+    ImuTrigger_t* self = GetInstance();
+    ImuDiagnostic_Summary_t* summary = &self->summary;
+
+    if (summary->sampleCount == 0) {
+        return;
+    }
+    summary->header.type = ImuDiagnostic_Type_SUMMARY;
+    summary->header.size = sizeof(*summary);
+    summary->seqId       = seqId;
+    summary->time        = Common_Rtc_GetCount(Common_RtcChannel_1);
+    summary->accelMean   = self->accelSum / summary->sampleCount;
+    summary->gyroMax     = sqrtf(self->gyroMax2);
+    summary->isCapturing = self->remaining > 0;
+    Imu_Diagnostic_Write(summary);
+    self->stats.summaryCount++;
+    ResetSummary();
+}
+
+/**
+ * @brief 読み込んだバッチを判定し，要約を更新する
+ *
+ * @return バッチが取得窓に含まれる場合 true
+ */
+bool Imu_Trigger_Process(const cxd5602pwbimu_data_t* samples, uint32_t num, uint32_t seqId)
+{
+    ImuTrigger_t* self = GetInstance();
+    ImuDiagnostic_Summary_t* summary = &self->summary;
+    bool isTriggered = false;
+
+    for (uint32_t i = 0; i < num; ++i) {
+        const cxd5602pwbimu_data_t* sample = &samples[i];
+        float accel2 = sample->ax * sample->ax + sample->ay * sample->ay + sample->az * sample->az;
+        float gyro2  = sample->gx * sample->gx + sample->gy * sample->gy + sample->gz * sample->gz;
+
+        if (!isTriggered && (accel2 < self->accelLow2 || self->accelHigh2 < accel2 || self->gyro2 < gyro2)) {
+            isTriggered = true;
+            summary->triggerCount++;
+        }
+
+        float accel = sqrtf(accel2);
+        if (summary->sampleCount == 0) {
+            summary->firstTimestamp = sample->timestamp;
+        }
+        summary->sampleCount++;
+        summary->accelMin = accel < summary->accelMin ? accel : summary->accelMin;
+        summary->accelMax = accel > summary->accelMax ? accel : summary->accelMax;
+        self->accelSum   += accel;
+        self->gyroMax2    = gyro2 > self->gyroMax2 ? gyro2 : self->gyroMax2;
+        if (summary->sampleCount >= self->summarySamples) {
+            WriteSummary(seqId);
+        }
+    }
+
+    if (isTriggered) {
+        if (self->remaining == 0) {
+            self->stats.windowCount++;
+        }
+        self->stats.triggerCount++;
+        self->remaining = self->postSamples > 0 ? self->postSamples : 1;
+        return true;
+    }
+    if (self->remaining > 0) {
+        self->remaining = self->remaining > num ? self->remaining - num : 0;
+        return true;
+    }
+    return false;
+} /* Imu_Trigger_Process */
+
+/**
+ * @brief 途中の要約を書き出す
+ */
+void Imu_Trigger_Flush(uint32_t seqId)
+{
+    WriteSummary(seqId);
+}
+
+void Imu_Trigger_GetStatistics(ImuTrigger_Statistics_t* stats)
+{
+    *stats = GetInstance()->stats;
+}
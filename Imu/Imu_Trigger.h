@@ -0,0 +1,19 @@
+#ifndef IMU_TRIGGER_H
+#define IMU_TRIGGER_H
+
+#include <nuttx/sensors/cxd5602pwbimu.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct tagImuTrigger_Statistics_t {
+    uint32_t triggerCount;  /* Batches that exceeded a threshold */
+    uint32_t windowCount;   /* Capture windows opened */
+    uint32_t summaryCount;  /* Summary records written */
+} ImuTrigger_Statistics_t;
+
+void Imu_Trigger_Init(int sampleRate, float accelThreshold, float gyroThreshold, uint32_t postMs);
+bool Imu_Trigger_Process(const cxd5602pwbimu_data_t* samples, uint32_t num, uint32_t seqId);
+void Imu_Trigger_Flush(uint32_t seqId);
+void Imu_Trigger_GetStatistics(ImuTrigger_Statistics_t* stats);
+
+#endif /* IMU_TRIGGER_H */
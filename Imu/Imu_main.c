@@ -39,6 +39,7 @@
 
 #include <nuttx/config.h>
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -59,6 +60,7 @@
 
 #include <nuttx/sensors/cxd5602pwbimu.h>
 
+#include "Common_Sched.h"
 #include "Imu_Logging.h"
 #include "Logging_public.h"
 
@@ -66,28 +68,8 @@
 * Pre-processor Definitions
 ****************************************************************************/
 
-#define CXD5602PWBIMU_DEVPATH "/dev/imu0"
-#define IMU_LOG_BUFFER_SIZE   (128 * 1024) // 128 KiB
-#define IMU_RECORD_NUM                                                    \
-        (IMU_LOG_BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)) \
-        / sizeof(cxd5602pwbimu_data_t)
-
 #define itemsof(a) (sizeof(a) / sizeof(a[0]))
 
-typedef struct tagImuRecordHeader_t {
-    struct timespec startTime;
-    uint32_t        reserved[6];
-} ImuRecordHeader_t;
-
-typedef struct tagImuRecord_t {
-    LogHeader_t          header;
-    cxd5602pwbimu_data_t body[IMU_RECORD_NUM];
-    LogFooter_t          footer;
-} ImuRecord_t;
-static_assert(sizeof(ImuRecord_t) == IMU_LOG_BUFFER_SIZE, "ImuRecord_t size mismatch");
-
-static ImuRecord_t buffer[4];
-
 /****************************************************************************
 * Private values
 ****************************************************************************/
@@ -162,8 +144,97 @@ static int start_sensing(int fd, int rate, int adrange, int gdrange, int nfifos)
 * sensor_main
 ****************************************************************************/
 
+static void PrintUsage(const char* name)
+{
+    printf("Usage: %s [fifo threshold] [rate=Hz] [latency=us] [dedicated [cpu]] [packed] [decimate=factor]... "
+        "[nofull] [trigger[=accel m/s^2,gyro dps]] [pre=blocks] [post=ms] [devices=N] [cpus=cpu,...] [shared]\n",
+        name);
+}
+
 int main(int argc, FAR char* argv[])
 {
-    Imu_Logging_Run();
+    ImuLogging_Config_t config = {
+        .sampleRate        = IMU_SAMPLE_RATE_DEFAULT,
+        .fifoThreshold     = IMU_FIFO_THRESHOLD_AUTO,
+        .maxLatencyUs      = IMU_MAX_LATENCY_US_DEFAULT,
+        .numDevices        = 1,
+        .isPacked          = false,
+        .isFullRateEnabled = true,
+        .numDecimated      = 0,
+        .isTriggered       = false,
+        .triggerAccel      = IMU_TRIGGER_ACCEL_DEFAULT,
+        .triggerGyro       = IMU_TRIGGER_GYRO_DEFAULT,
+        .triggerPreBlocks  = 1,
+        .triggerPostMs     = IMU_TRIGGER_POST_MS_DEFAULT,
+    };
+
+    /** @note 既定では全ての IMU の取得スレッドを計画の CPU に置く． */
+    Common_Sched_Apply(Common_SchedTask_IMU);
+    for (int device = 0; device < IMU_MAX_DEVICES; ++device) {
+        config.cpus[device] = Common_Sched_GetPlan(Common_SchedTask_IMU_ACQUISITION)->cpu;
+    }
+
+    /** @note Imu [fifo threshold] [rate=Hz] [latency=us] [dedicated [cpu]] [packed] [decimate=factor]... [nofull]
+     *        [trigger[=accel m/s^2,gyro dps]] [pre=blocks] [post=ms] [devices=N] [cpus=cpu,...] [shared]
+     *        cpus は IMU 毎の CPU．-1 と shared は取得を Imu タスクと同じ CPU で動かす (計画との比較用)． */
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "devices=", 8) == 0) {
+            config.numDevices = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "cpus=", 5) == 0) {
+            char* pos = argv[i] + 5;
+            for (int device = 0; device < IMU_MAX_DEVICES && *pos != '\0'; ++device) {
+                config.cpus[device] = strtol(pos, &pos, 10);
+                if (*pos == ',') {
+                    pos++;
+                }
+            }
+        } else if (strncmp(argv[i], "trigger", 7) == 0) {
+            float gyroDps;
+            config.isTriggered = true;
+            if (sscanf(argv[i], "trigger=%f,%f", &config.triggerAccel, &gyroDps) == 2) {
+                config.triggerGyro = gyroDps * 3.14159265f / 180.0f;
+            }
+        } else if (strncmp(argv[i], "pre=", 4) == 0) {
+            config.triggerPreBlocks = atoi(argv[i] + 4);
+        } else if (strncmp(argv[i], "post=", 5) == 0) {
+            config.triggerPostMs = atoi(argv[i] + 5);
+        } else if (strncmp(argv[i], "decimate=", 9) == 0) {
+            if (config.numDecimated < IMU_DECIMATE_MAX_STREAMS) {
+                config.decimateFactors[config.numDecimated++] = atoi(argv[i] + 9);
+            }
+        } else if (strcmp(argv[i], "nofull") == 0) {
+            config.isFullRateEnabled = false;
+        } else if (strncmp(argv[i], "rate=", 5) == 0) {
+            config.sampleRate = atoi(argv[i] + 5);
+        } else if (strncmp(argv[i], "latency=", 8) == 0) {
+            config.maxLatencyUs = atoi(argv[i] + 8);
+        } else if (strcmp(argv[i], "dedicated") == 0) {
+            config.cpus[0] = IMU_ACQUISITION_CPU_DEDICATED;
+            if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0])) {
+                config.cpus[0] = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "shared") == 0) {
+            for (int device = 0; device < IMU_MAX_DEVICES; ++device) {
+                config.cpus[device] = IMU_ACQUISITION_CPU_SHARED;
+            }
+        } else if (strcmp(argv[i], "packed") == 0) {
+            config.isPacked = true;
+        } else {
+            char* end;
+            long threshold = strtol(argv[i], &end, 10);
+            if (end == argv[i] || *end != '\0') {
+                printf("ERROR: Unknown argument. %s\n", argv[i]);
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            config.fifoThreshold = (int) threshold;
+        }
+    }
+    /** @note 間引きは IMU 0 だけに掛けるため，全レートを残さないと IMU 1 以降のサンプルが全て失われる． */
+    if (!config.isFullRateEnabled && config.numDevices > 1) {
+        printf("ERROR: nofull only supports a single device (devices=%u).\n", config.numDevices);
+        return 1;
+    }
+    Imu_Logging_Run(&config);
     return 0;
 }
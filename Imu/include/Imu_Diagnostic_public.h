@@ -0,0 +1,102 @@
+#ifndef IMU_DIAGNOSTIC_PUBLIC_H
+#define IMU_DIAGNOSTIC_PUBLIC_H
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * @note LoggingUser_IMU_DIAGNOSTIC の Block の Body は可変長 Record の列．
+ *       各 Record は ImuDiagnostic_Header_t で始まり，size は Header を含む Record 全体のバイト数．
+ *       size が 0 の位置で Body の終わりとする．未知の type は size で読み飛ばせる．
+ *       複数の IMU を使う場合も診断 Block は 1 本で，device が Record を出した IMU (LogHeader_t.stream) を示す．
+ */
+typedef enum tagImuDiagnostic_Type_e {
+    ImuDiagnostic_Type_STATISTICS = 1,
+    ImuDiagnostic_Type_GAP        = 2,
+    ImuDiagnostic_Type_DISCARD    = 3,
+    ImuDiagnostic_Type_TIMEOUT    = 4,
+    ImuDiagnostic_Type_SUMMARY    = 5,
+} ImuDiagnostic_Type_e;
+
+typedef struct tagImuDiagnostic_Header_t {
+    uint8_t  type;   /* ImuDiagnostic_Type_e */
+    uint8_t  device; /* IMU device index */
+    uint16_t size;
+} ImuDiagnostic_Header_t;
+
+/** @note 取得ループの累積値．IMU の Block を送る毎と終了時に記録する． */
+typedef struct tagImuDiagnostic_Statistics_t {
+    ImuDiagnostic_Header_t header;
+    uint32_t               seqId;         /* seqId of the next IMU block */
+    uint64_t               time;          /* RTC count */
+    uint16_t               sampleRate;    /* [Hz] */
+    uint16_t               fifoThreshold; /* Samples per wakeup the FIFO watermark was set to */
+    uint32_t               wakeupCount;
+    uint32_t               sampleCount;
+    uint32_t               overflowCount; /* Timestamp gaps, i.e. the driver overwrote unread samples */
+    uint32_t               missedSamples; /* Samples lost in those gaps */
+    uint32_t               timeoutCount;  /* poll() timeouts */
+    uint32_t               jitterStdUs;   /* Standard deviation of the wakeup interval error */
+    uint32_t               jitterMaxUs;   /* Largest wakeup interval error */
+} ImuDiagnostic_Statistics_t;
+static_assert(sizeof(ImuDiagnostic_Statistics_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+/**
+ * @note センサのタイムスタンプが飛んだ箇所．Driver が読まれていないサンプルを上書きした (読み出しの遅れ)．
+ *       (prevTimestamp, nextTimestamp) の間の missedSamples 個が失われた．
+ */
+typedef struct tagImuDiagnostic_Gap_t {
+    ImuDiagnostic_Header_t header;
+    uint32_t               seqId;         /* IMU block being filled */
+    uint64_t               time;          /* RTC count when the gap was read */
+    uint32_t               sampleIndex;   /* Samples read before the gap since start */
+    uint32_t               prevTimestamp; /* Last sample before the gap */
+    uint32_t               nextTimestamp; /* First sample after the gap */
+    uint32_t               missedSamples;
+} ImuDiagnostic_Gap_t;
+static_assert(sizeof(ImuDiagnostic_Gap_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+/**
+ * @note 空き Buffer が無く，読み込んで捨てたサンプルの範囲．Logging タスクの書き込みの遅れを示す．
+ *       捨てたバイト数は次の Block の LogHeader_t.overrun にも残る．
+ */
+typedef struct tagImuDiagnostic_Discard_t {
+    ImuDiagnostic_Header_t header;
+    uint32_t               seqId;          /* IMU block that follows the discarded samples */
+    uint64_t               time;           /* RTC count when a buffer became free again */
+    uint32_t               firstTimestamp;
+    uint32_t               lastTimestamp;
+    uint32_t               discardedSamples;
+    uint32_t               reserved;
+} ImuDiagnostic_Discard_t;
+static_assert(sizeof(ImuDiagnostic_Discard_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+typedef struct tagImuDiagnostic_Timeout_t {
+    ImuDiagnostic_Header_t header;
+    uint32_t               seqId;
+    uint64_t               time;          /* RTC count when poll() timed out */
+    uint32_t               lastTimestamp; /* Last sample read before the timeout */
+    uint32_t               timeoutMs;
+} ImuDiagnostic_Timeout_t;
+static_assert(sizeof(ImuDiagnostic_Timeout_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+/**
+ * @note Trigger 方式の取得で，保存しない区間も含めて一定間隔 (1 秒) 毎に残す要約．
+ *       加速度と角速度はベクトルの大きさ [m/s^2]，[rad/s]．
+ */
+typedef struct tagImuDiagnostic_Summary_t {
+    ImuDiagnostic_Header_t header;
+    uint32_t               seqId;          /* IMU block being filled */
+    uint64_t               time;           /* RTC count at the end of the interval */
+    uint32_t               firstTimestamp; /* First sample of the interval */
+    uint32_t               sampleCount;
+    float                  accelMin;
+    float                  accelMax;
+    float                  accelMean;
+    float                  gyroMax;
+    uint32_t               triggerCount; /* Batches in the interval that exceeded a threshold */
+    uint32_t               isCapturing;  /* 1 if the interval ended inside a capture window */
+} ImuDiagnostic_Summary_t;
+static_assert(sizeof(ImuDiagnostic_Summary_t) % sizeof(uint64_t) == 0, "Keep records 8-byte aligned");
+
+#endif /* IMU_DIAGNOSTIC_PUBLIC_H */
@@ -0,0 +1,29 @@
+#ifndef IMU_PACKED_PUBLIC_H
+#define IMU_PACKED_PUBLIC_H
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * @note LoggingUser_IMU_PACKED の Block の Body は，ImuPackedFormat_t に ImuPackedRecord_t の列が続く．
+ *       各軸は設定したレンジの Full scale を INT16_MAX に対応させた 16 bit 固定小数点で，
+ *       物理量は 値 × Scale で求める．Scale の単位は Driver の出力と同じ [m/s^2]，[rad/s]．
+ *       Format は Record と同じサイズとし，Body 全体を固定長 Record として Codec にかけられるようにする．
+ */
+typedef struct tagImuPackedFormat_t {
+    uint16_t accelRange; /* Configured accelerometer range [g] */
+    uint16_t gyroRange;  /* Configured gyroscope range [dps] */
+    float    accelScale; /* [m/s^2] per LSB */
+    float    gyroScale;  /* [rad/s] per LSB */
+    float    temp;       /* Temperature of the first sample in the block [degC] */
+} ImuPackedFormat_t;
+
+typedef struct tagImuPackedRecord_t {
+    uint32_t timestamp; /* Same as cxd5602pwbimu_data_t.timestamp */
+    int16_t  gyro[3];   /* x, y, z */
+    int16_t  accel[3];  /* x, y, z */
+} ImuPackedRecord_t;
+
+static_assert(sizeof(ImuPackedFormat_t) == sizeof(ImuPackedRecord_t), "ImuPackedFormat_t must be one record");
+
+#endif /* IMU_PACKED_PUBLIC_H */
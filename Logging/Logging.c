@@ -2,59 +2,152 @@
 
 #include "Logging.h"
 
-#include <fcntl.h>
-#include <nuttx/config.h>
+#include <assert.h>
+#include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
 
 #include "Common_DebugPrint.h"
+#include "Common_Rtc.h"
 
-#define MESSAGE_QUEUE_MAX (32)
+#define QUEUE_SIZE       (32) // Must be a power of 2
+#define QUEUE_MASK       (QUEUE_SIZE - 1)
+#define SEND_TIMEOUT_MS  (500) /* How long a WRITE waits for a free slot before the producer gets it back */
+
+#define MSEC2RTC(ms)     ((uint64_t) (ms) * 32768 / 1000)
+
+static_assert((QUEUE_SIZE & QUEUE_MASK) == 0, "QUEUE_SIZE must be a power of two");
+
+typedef struct tagLogging_Slot_t {
+    atomic_uint   seq;  /* Sequence minus the slot index, so that zero-initialized slots are empty */
+    uint64_t      time; /* RTC count at send, for deadlines and latency */
+    LoggingDesc_t desc;
+} Logging_Slot_t;
+
+/**
+ * @note 状態は Slot 毎の seq で表す (空: pos，書き込み済み: pos + 1，読み出し済み: pos + QUEUE_SIZE)．
+ *       Producer は tail を CAS で進めて Slot を確保し，埋めた後に seq を release で公開する．
+ *       Consumer は head の Slot の seq を acquire で読み，取り出した後に seq を release で返す．
+ */
+typedef struct tagLogging_Ring_t {
+    Logging_Slot_t slots[QUEUE_SIZE];
+    atomic_uint    tail; /* Next slot to send, shared by the producers */
+    atomic_uint    head; /* Next slot to receive, written by the consumer only */
+} Logging_Ring_t;
+
+/** @note Producer が更新する統計．Consumer 側の統計は Logging_QueueClassStatistics_t に直接持つ． */
+typedef struct tagLogging_SendStatistics_t {
+    atomic_uint sendCount;
+    atomic_uint fullCount;
+    atomic_uint timeoutCount;
+    atomic_uint maxDepth;
+} Logging_SendStatistics_t;
+
+/**
+ * @brief Producer 複数，Consumer (Logging タスク) 1 つの Descriptor ring を優先度クラス毎に持つ
+ *
+ * @note Lock は取らない (Common_Trace と同じ方式)．Syscall もカーネルへのコピーも行わない．
+ *       Consumer は空の場合に限り smph で待ち，Producer は満杯の場合に限り space で待つ．
+ *       待機の通知は「待機フラグ (数) を書いてから seq_cst fence の後に状態を再確認する」対で取りこぼしを防ぐ．
+ */
+struct tagLogging_Queue_t {
+    Logging_Ring_t            rings[LoggingPriority_NUM];
+    Logging_SendStatistics_t  sendStats[LoggingPriority_NUM];
+    atomic_bool               isWaiting;     /* Consumer is (about to be) blocked on smph */
+    atomic_uint               numSendersWaiting;
+    sem_t                     smph;
+    sem_t                     space;
+    Logging_QueueStatistics_t stats;         /* Consumer side only */
+};
 
 typedef struct tagLogging_t {
-    pthread_mutex_t mutex;
-    pthread_cond_t  cond;
-    bool            isQueueCreated;
-    int32_t         openCount;
+    pthread_mutex_t           mutex;
+    pthread_cond_t            cond;
+    bool                      isQueueCreated;
+    int32_t                   openCount;
+    struct tagLogging_Queue_t queue;
 } Logging_t;
 
-const static char* queue = "logging_queue";
-
 static Logging_t logging_instance = {
     .mutex = PTHREAD_MUTEX_INITIALIZER,
     .cond  = PTHREAD_COND_INITIALIZER,
     .isQueueCreated = false,
 };
 
+/**
+ * @note IMU の全レートの Block は Buffer の余裕が最も少ないため最優先とする．
+ *       User を追加したら必ずここにも追加する (static_assert で検出する)．
+ */
+static const LoggingPriority_e userPriority[] = {
+    [LoggingUser_IMU]             = LoggingPriority_HIGH,
+    [LoggingUser_GNSS]            = LoggingPriority_NORMAL,
+    [LoggingUser_SYNCHRONIZE]     = LoggingPriority_NORMAL,
+    [LoggingUser_POWER]           = LoggingPriority_LOW,
+    [LoggingUser_COMPRESSED]      = LoggingPriority_LOW,    /* Written by the Logging task, never queued */
+    [LoggingUser_IMU_PACKED]      = LoggingPriority_HIGH,
+    [LoggingUser_IMU_DIAGNOSTIC]  = LoggingPriority_NORMAL,
+    [LoggingUser_IMU_DECIMATED_0] = LoggingPriority_NORMAL,
+    [LoggingUser_IMU_DECIMATED_1] = LoggingPriority_NORMAL,
+    [LoggingUser_TRACE]           = LoggingPriority_LOW,
+    [LoggingUser_GNSS_PVTLOG]     = LoggingPriority_NORMAL,
+    [LoggingUser_GNSS_COMPACT]    = LoggingPriority_NORMAL,
+};
+static_assert(sizeof(userPriority) / sizeof(userPriority[0]) == LoggingUser_NUM, "Map every LoggingUser_e");
+
+/** @note 上位クラスが詰まっていても，この時間を超えて待たされた Descriptor は先に取り出す． */
+static const uint32_t priorityDeadlineMs[LoggingPriority_NUM] = {
+    [LoggingPriority_HIGH]   = 0,
+    [LoggingPriority_NORMAL] = 1000,
+    [LoggingPriority_LOW]    = 2000,
+};
+
 static Logging_t* GetInstance(void)
 {
     return &logging_instance;
 }
 
-mqd_t Logging_CreateQueue(void)
+/**
+ * @brief Descriptor の優先度クラスを決める
+ *
+ * @note END/SHUTDOWN は最低優先度とし，同じ Producer が先に送った WRITE を追い越さないようにする．
+ */
+static LoggingPriority_e GetPriority(LoggingDesc_t* desc)
 {
-    Logging_t* self = GetInstance();
-    mqd_t mq;
-    struct mq_attr attr;
+    if (desc->type != LoggingType_WRITE || desc->user >= LoggingUser_NUM) {
+        return LoggingPriority_LOW;
+    }
+    return userPriority[desc->user];
+}
 
-    attr.mq_maxmsg  = MESSAGE_QUEUE_MAX;
-    attr.mq_msgsize = sizeof(LoggingDesc_t);
-    attr.mq_flags   = 0;
+static void InitSemaphore(sem_t* smph)
+{
+    sem_init(smph, 0, 0);
+#ifdef SEM_PRIO_NONE
+    sem_setprotocol(smph, SEM_PRIO_NONE);
+#endif
+}
 
-    mq = mq_open(queue, O_CREAT | O_RDWR, 0666, &attr);
-    if (mq == (mqd_t) ERROR) {
-        PRINT_ERROR("Message queue open error:%d", errno);
-        return ERROR;
-    }
+LoggingQueue_t Logging_CreateQueue(void)
+{
+    Logging_t* self = GetInstance();
+    LoggingQueue_t queue = &self->queue;
+
+    memset(queue, 0, sizeof(*queue));
+    InitSemaphore(&queue->smph);
+    InitSemaphore(&queue->space);
 
     pthread_mutex_lock(&self->mutex);
     self->isQueueCreated = true;
     pthread_cond_broadcast(&self->cond);
     pthread_mutex_unlock(&self->mutex);
 
-    return mq;
+    return queue;
 }
 
-mqd_t Logging_OpenQueue(bool isIncrementOpenCount)
+LoggingQueue_t Logging_OpenQueue(bool isIncrementOpenCount)
 {
     Logging_t* self = GetInstance();
 
@@ -69,50 +162,270 @@ mqd_t Logging_OpenQueue(bool isIncrementOpenCount)
     pthread_mutex_unlock(&self->mutex);
     PRINT_DEBUG("Open count incremented: %d", self->openCount);
 
-    mqd_t mq;
+    return &self->queue;
+}
 
-    mq = mq_open(queue, O_RDWR);
-    if (mq == (mqd_t) ERROR) {
-        PRINT_ERROR("Message queue open error:%d", errno);
-        return ERROR;
+void Logging_CloseQueue(LoggingQueue_t queue)
+{
+    /** @note Ring はプロセス内の静的領域にあるため解放するものは無い． */
+}
+
+static uint32_t LoadSeq(Logging_Slot_t* slot, uint32_t index)
+{
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) + index;
+}
+
+static void StoreSeq(Logging_Slot_t* slot, uint32_t index, uint32_t seq)
+{
+    atomic_store_explicit(&slot->seq, seq - index, memory_order_release);
+}
+
+/**
+ * @brief Slot を 1 つ確保し，その位置を reserved に返す
+ *
+ * @return 満杯の場合 false
+ */
+static bool Reserve(Logging_Ring_t* ring, uint32_t* reserved)
+{
+    uint32_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    for (;;) {
+        Logging_Slot_t* slot = &ring->slots[pos & QUEUE_MASK];
+        int32_t diff         = (int32_t) (LoadSeq(slot, pos & QUEUE_MASK) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed,
+                memory_order_relaxed)) {
+                *reserved = pos;
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static bool IsFull(Logging_Ring_t* ring)
+{
+    uint32_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    return (int32_t) (LoadSeq(&ring->slots[pos & QUEUE_MASK], pos & QUEUE_MASK) - pos) < 0;
+}
+
+/**
+ * @brief Consumer が Slot を返すまで待つ
+ *
+ * @param deadline NULL なら無期限
+ *
+ * @return 期限を過ぎた場合 false
+ */
+static bool WaitForSpace(LoggingQueue_t queue, Logging_Ring_t* ring, const struct timespec* deadline)
+{
+    bool isOk = true;
+
+    atomic_fetch_add_explicit(&queue->numSendersWaiting, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (IsFull(ring)) {
+        int ret = deadline == NULL ? sem_wait(&queue->space)
+                : sem_clockwait(&queue->space, CLOCK_MONOTONIC, deadline);
+        isOk = ret == 0 || errno == EINTR;
     }
+    atomic_fetch_sub_explicit(&queue->numSendersWaiting, 1, memory_order_relaxed);
+    return isOk;
+}
+
+static void UpdateMaxDepth(atomic_uint* maxDepth, uint32_t depth)
+{
+    uint32_t current = atomic_load_explicit(maxDepth, memory_order_relaxed);
 
-    return mq;
+    while (current < depth
+        && !atomic_compare_exchange_weak_explicit(maxDepth, &current, depth, memory_order_relaxed,
+            memory_order_relaxed)) {
+    }
 }
 
-void Logging_CloseQueue(mqd_t mq)
+/**
+ * @brief Descriptor を送る
+ *
+ * @note Queue が満杯の場合は空くまで待つ．END/SHUTDOWN は無期限に待ち，捨てない．
+ *       WRITE は SEND_TIMEOUT_MS 待っても空かなければ ERROR を返す．この場合 callback は呼ばれないため，
+ *       Producer は Buffer を自分で回収し，overrun として数える．
+ */
+int Logging_SendQueue(LoggingQueue_t queue, LoggingDesc_t* desc)
 {
-    if (mq != (mqd_t) ERROR) {
-        mq_close(mq);
+    LoggingPriority_e priority = GetPriority(desc);
+    Logging_Ring_t* ring       = &queue->rings[priority];
+    Logging_SendStatistics_t* stats = &queue->sendStats[priority];
+    struct timespec deadline;
+    bool isFull = false;
+    uint32_t pos;
+
+    if (desc->type == LoggingType_WRITE) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec  += SEND_TIMEOUT_MS / 1000;
+        deadline.tv_nsec += (SEND_TIMEOUT_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
     }
+    while (!Reserve(ring, &pos)) {
+        if (!isFull) {
+            isFull = true;
+            atomic_fetch_add_explicit(&stats->fullCount, 1, memory_order_relaxed);
+        }
+        if (!WaitForSpace(queue, ring, desc->type == LoggingType_WRITE ? &deadline : NULL)) {
+            atomic_fetch_add_explicit(&stats->timeoutCount, 1, memory_order_relaxed);
+            PRINT_ERROR("Logging queue full: priority=%d user=%d", priority, desc->user);
+            return ERROR;
+        }
+    }
+
+    Logging_Slot_t* slot = &ring->slots[pos & QUEUE_MASK];
+    slot->desc = *desc;
+    slot->time = Common_Rtc_GetCount(Common_RtcChannel_1);
+    StoreSeq(slot, pos & QUEUE_MASK, pos + 1);
+
+    atomic_fetch_add_explicit(&stats->sendCount, 1, memory_order_relaxed);
+    UpdateMaxDepth(&stats->maxDepth, pos + 1 - atomic_load_explicit(&ring->head, memory_order_relaxed));
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange_explicit(&queue->isWaiting, false, memory_order_relaxed)) {
+        sem_post(&queue->smph);
+    }
+
+    return OK;
 }
 
-int Logging_SendQueue(mqd_t mq, LoggingDesc_t* desc)
+/**
+ * @note 他の CPU の Producer が now より後に Slot の時刻を書いている場合があるため，負の経過時間は 0 とする．
+ */
+static uint64_t GetElapsed(uint64_t now, uint64_t time)
 {
-    int ret;
+    return now > time ? now - time : 0;
+}
 
-    ret = mq_send(mq, (FAR const char *) desc, sizeof(LoggingDesc_t), 0);
-    if (ret < 0) {
-        PRINT_ERROR("mq_send err(errno:%d)", errno);
+/**
+ * @return head の Slot が公開済みなら true
+ */
+static bool IsReady(Logging_Ring_t* ring, uint32_t head)
+{
+    return LoadSeq(&ring->slots[head & QUEUE_MASK], head & QUEUE_MASK) == head + 1;
+}
+
+/**
+ * @brief 最も優先度の高い Descriptor を待たずに取り出す
+ *
+ * @note 期限を過ぎた Descriptor があれば，優先度よりもそちらを先に取り出す．
+ *
+ * @retval OK    Descriptor を取り出した
+ * @retval ERROR Queue が空
+ */
+int Logging_TryReceiveQueue(LoggingQueue_t queue, LoggingDesc_t* desc)
+{
+    int selected   = -1;
+    bool isOverdue = false;
+    uint64_t now   = Common_Rtc_GetCount(Common_RtcChannel_1);
+
+    for (int priority = 0; priority < LoggingPriority_NUM; ++priority) {
+        Logging_Ring_t* ring = &queue->rings[priority];
+        uint32_t head        = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        if (!IsReady(ring, head)) {
+            continue;
+        }
+        if (selected < 0) {
+            selected = priority;
+            continue;
+        }
+        /** @note END/SHUTDOWN は繰り上げない．先行する WRITE より先に停止処理が走るのを防ぐ． */
+        Logging_Slot_t* slot = &ring->slots[head & QUEUE_MASK];
+        uint64_t waited      = GetElapsed(now, slot->time);
+        if (slot->desc.type == LoggingType_WRITE && waited >= MSEC2RTC(priorityDeadlineMs[priority])) {
+            selected  = priority;
+            isOverdue = true;
+            break;
+        }
+    }
+    if (selected < 0) {
         return ERROR;
     }
 
+    Logging_Ring_t* ring = &queue->rings[selected];
+    Logging_QueueClassStatistics_t* stats = &queue->stats.classes[selected];
+    uint32_t head        = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    Logging_Slot_t* slot = &ring->slots[head & QUEUE_MASK];
+    uint64_t latency     = GetElapsed(now, slot->time);
+
+    *desc = slot->desc;
+    StoreSeq(slot, head & QUEUE_MASK, head + QUEUE_SIZE);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->numSendersWaiting, memory_order_relaxed) > 0) {
+        sem_post(&queue->space);
+    }
+
+    stats->receiveCount++;
+    stats->totalLatency += latency;
+    if (stats->maxLatency < latency) {
+        stats->maxLatency = latency;
+    }
+    if (isOverdue) {
+        stats->overdueCount++;
+    }
     return OK;
 }
 
-int Logging_ReceiveQueue(mqd_t mq, LoggingDesc_t* desc)
+static bool IsEmpty(LoggingQueue_t queue)
 {
-    int ret;
+    for (int priority = 0; priority < LoggingPriority_NUM; ++priority) {
+        Logging_Ring_t* ring = &queue->rings[priority];
+        if (IsReady(ring, atomic_load_explicit(&ring->head, memory_order_relaxed))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    ret = mq_receive(mq, (FAR char *) desc, sizeof(LoggingDesc_t), 0);
-    if (ret < 0) {
-        PRINT_ERROR("mq_receive err(errno:%d)", errno);
-        return ERROR;
+int Logging_ReceiveQueue(LoggingQueue_t queue, LoggingDesc_t* desc)
+{
+    while (Logging_TryReceiveQueue(queue, desc) != OK) {
+        /** @note 待機フラグを立ててから空であることを再確認し，通知の取りこぼしを防ぐ． */
+        atomic_store_explicit(&queue->isWaiting, true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!IsEmpty(queue)) {
+            /** @note Producer が先にフラグを下ろしていた場合，余分な post が残るが次の待機が空振りするだけ． */
+            atomic_store_explicit(&queue->isWaiting, false, memory_order_relaxed);
+            continue;
+        }
+        queue->stats.waitCount++;
+        if (sem_wait(&queue->smph) < 0 && errno != EINTR) {
+            PRINT_ERROR("sem_wait err(errno:%d)", errno);
+            return ERROR;
+        }
     }
 
     return OK;
 }
 
+/**
+ * @note Consumer (Logging タスク) から呼ぶ．
+ */
+void Logging_GetQueueStatistics(LoggingQueue_t queue, Logging_QueueStatistics_t* stats)
+{
+    *stats = queue->stats;
+    for (int priority = 0; priority < LoggingPriority_NUM; ++priority) {
+        Logging_SendStatistics_t* send      = &queue->sendStats[priority];
+        Logging_QueueClassStatistics_t* cls = &stats->classes[priority];
+
+        cls->sendCount    = atomic_load_explicit(&send->sendCount, memory_order_relaxed);
+        cls->fullCount    = atomic_load_explicit(&send->fullCount, memory_order_relaxed);
+        cls->timeoutCount = atomic_load_explicit(&send->timeoutCount, memory_order_relaxed);
+        cls->maxDepth     = atomic_load_explicit(&send->maxDepth, memory_order_relaxed);
+    }
+}
+
 int32_t Logging_DecrementOpenCount(void)
 {
     Logging_t* self = GetInstance();
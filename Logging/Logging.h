@@ -1,9 +1,35 @@
 #ifndef LOGGING_H
 #define LOGGING_H
-#include <mqueue.h>
 #include <stdint.h>
 
-mqd_t   Logging_CreateQueue(void);
-int32_t Logging_DecrementOpenCount(void);
+#include "Logging_public.h"
+
+typedef enum tagLoggingPriority_e {
+    LoggingPriority_HIGH,   /* Full-rate IMU (raw and packed) */
+    LoggingPriority_NORMAL, /* GNSS, SYNCHRONIZE, IMU diagnostics and decimated streams */
+    LoggingPriority_LOW,    /* POWER, TRACE, END, SHUTDOWN */
+    LoggingPriority_NUM,
+} LoggingPriority_e;
+
+typedef struct tagLogging_QueueClassStatistics_t {
+    uint32_t sendCount;
+    uint32_t receiveCount;
+    uint32_t fullCount;    /* Sends that found the ring full and had to wait */
+    uint32_t timeoutCount; /* WRITEs returned to the producer after waiting SEND_TIMEOUT_MS */
+    uint32_t maxDepth;
+    uint32_t overdueCount; /* Receives taken ahead of a higher class because the deadline passed */
+    uint64_t totalLatency; /* Send-to-receive time in RTC ticks (32768Hz) */
+    uint64_t maxLatency;
+} Logging_QueueClassStatistics_t;
+
+typedef struct tagLogging_QueueStatistics_t {
+    Logging_QueueClassStatistics_t classes[LoggingPriority_NUM];
+    uint32_t                       waitCount; /* Times the consumer blocked on an empty queue */
+} Logging_QueueStatistics_t;
+
+LoggingQueue_t Logging_CreateQueue(void);
+int            Logging_TryReceiveQueue(LoggingQueue_t queue, LoggingDesc_t* desc);
+void           Logging_GetQueueStatistics(LoggingQueue_t queue, Logging_QueueStatistics_t* stats);
+int32_t        Logging_DecrementOpenCount(void);
 
 #endif /* LOGGING_H */
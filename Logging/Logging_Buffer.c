@@ -1,18 +1,53 @@
 #include "Logging_Buffer_public.h"
 
-#include <nuttx/crc32.h>
 #include <string.h>
 
 #include "Common_Rtc.h"
+#include "Logging_Crc.h"
+
+#define IS_CRC_DEFERRED(options) ((options) & (Logging_BufferOption_DEFERRED_CRC | Logging_BufferOption_OFFLOAD_CRC))
 
 static void updateCrc(Logging_Buffer_Desc_t* desc, void* data, uint32_t size);
 
 static void updateCrc(Logging_Buffer_Desc_t* desc, void* data, uint32_t size)
 {
-    desc->footer->crc = crc32part(data, size, desc->footer->crc);
+    Logging_Crc_e type = (desc->options & Logging_BufferOption_CRC32C) ? Logging_Crc_CRC32C : Logging_Crc_CRC32;
+
+    desc->footer->crc = Logging_Crc_Update(type, desc->footer->crc, data, size);
+}
+
+/**
+ * @brief Buffer のオプションを設定する
+ *
+ * @note 次の Logging_Buffer_Init() から有効になる．
+ */
+void Logging_Buffer_SetOptions(Logging_Buffer_Desc_t* desc, uint32_t options)
+{
+    desc->options = options;
 }
 
-void Logging_Buffer_Init(Logging_Buffer_Desc_t* desc, LoggingUser_e user, uint32_t seqId, void* buff, uint32_t size)
+/**
+ * @brief Body が固定長 Record の配列である場合に Record のサイズを設定する
+ *
+ * @note 次の Logging_Buffer_Init() から有効になる．0 以外の Block は Codec による圧縮の対象となる．
+ */
+void Logging_Buffer_SetRecordSize(Logging_Buffer_Desc_t* desc, uint32_t recordSize)
+{
+    desc->recordSize = recordSize;
+}
+
+/**
+ * @brief 同じ user の Block を出す Producer が複数ある場合に，Block を区別する番号を設定する
+ *
+ * @note 次の Logging_Buffer_Init() から有効になる．既定は 0．
+ */
+void Logging_Buffer_SetStream(Logging_Buffer_Desc_t* desc, uint32_t stream)
+{
+    desc->stream = stream;
+}
+
+void Logging_Buffer_Init(Logging_Buffer_Desc_t* desc, LoggingUser_e user, uint32_t seqId, uint32_t overrun,
+    void* buff, uint32_t size)
 {
     desc->header = (LogHeader_t *) buff;
     desc->body   = (uint8_t *) buff + sizeof(LogHeader_t);
@@ -23,9 +58,17 @@ void Logging_Buffer_Init(Logging_Buffer_Desc_t* desc, LoggingUser_e user, uint32
     desc->header->size  = size;
     desc->header->time  = Common_Rtc_GetCount(Common_RtcChannel_1);
 
+    desc->header->overrun = overrun;
+    desc->header->flags   = desc->options & LOG_HEADER_FLAG_MASK;
+    desc->header->recordSize = desc->recordSize;
+    desc->header->stream     = desc->stream;
+
+    Logging_Crc_Init();
     desc->footer->size = 0;
     desc->footer->crc  = 0xFFFFFFFF;
-    updateCrc(desc, desc->header, sizeof(LogHeader_t));
+    if (!IS_CRC_DEFERRED(desc->options)) {
+        updateCrc(desc, desc->header, sizeof(LogHeader_t));
+    }
 }
 
 bool Logging_Buffer_Write(Logging_Buffer_Desc_t* desc, void* data, uint32_t size)
@@ -33,7 +76,9 @@ bool Logging_Buffer_Write(Logging_Buffer_Desc_t* desc, void* data, uint32_t size
     void* ptr = desc->body + desc->footer->size;
 
     memcpy(ptr, data, size);
-    updateCrc(desc, ptr, size);
+    if (!IS_CRC_DEFERRED(desc->options)) {
+        updateCrc(desc, ptr, size);
+    }
     desc->footer->size += size;
     return true;
 }
@@ -42,7 +87,9 @@ void Logging_Buffer_Update(Logging_Buffer_Desc_t* desc, uint32_t size)
 {
     void* ptr = desc->body + desc->footer->size;
 
-    updateCrc(desc, ptr, size);
+    if (!IS_CRC_DEFERRED(desc->options)) {
+        updateCrc(desc, ptr, size);
+    }
     desc->footer->size += size;
 }
 
@@ -56,11 +103,53 @@ void* Logging_Buffer_GetNextPos(Logging_Buffer_Desc_t* desc)
     return desc->body + desc->footer->size;
 }
 
+/**
+ * @brief Block の Body に書き込んだバイト数を返す
+ *
+ * @note 送れなかった Block を捨てる時に overrun に加える量．Descriptor を再利用した後も Block から求められる．
+ */
+uint32_t Logging_Buffer_GetPayloadSize(const void* block)
+{
+    const LogHeader_t* header = block;
+    const LogFooter_t* footer = (const LogFooter_t *) ((const uint8_t *) block + header->size - sizeof(LogFooter_t));
+
+    return footer->size;
+}
+
+/**
+ * @brief Finalize した Block を Logging タスクへ送る
+ *
+ * @note Queue が詰まって送れなかった Block は Callback で Producer に返して捨て，
+ *       Payload を overrun に加えて次の Block に残す．
+ *
+ * @param overrun 次の Block の Logging_Buffer_Init() に渡す overrun
+ */
+int Logging_Buffer_Send(LoggingQueue_t mq, LoggingDesc_t* desc, uint32_t* overrun)
+{
+    if (Logging_SendQueue(mq, desc) == OK) {
+        return OK;
+    }
+    *overrun += Logging_Buffer_GetPayloadSize(desc->ptr);
+    if (desc->callback != NULL) {
+        desc->callback(desc->ptr);
+    }
+    return ERROR;
+}
+
 void Logging_Buffer_Finalize(Logging_Buffer_Desc_t* desc)
 {
     memset(desc->body + desc->footer->size, 0,
         Logging_Buffer_GetRemainingSize(desc));
     desc->footer->time = Common_Rtc_GetCount(Common_RtcChannel_1);
+    if (desc->options & Logging_BufferOption_OFFLOAD_CRC) {
+        /** @note Logging タスク (または ASMP Worker) が書き込み前に Logging_Crc_ComputeBlock() で求める． */
+        desc->footer->crc = 0;
+        return;
+    }
+    if (desc->options & Logging_BufferOption_DEFERRED_CRC) {
+        desc->footer->crc = Logging_Crc_ComputeBlock(desc->header);
+        return;
+    }
     updateCrc(desc, desc->footer, sizeof(LogFooter_t) - sizeof(desc->footer->crc));
     desc->footer->crc = ~desc->footer->crc; // Finalize CRC by inverting it
 }
@@ -0,0 +1,261 @@
+#include "Logging_Codec.h"
+
+#include <string.h>
+
+/**
+ * @note ホストのデコーダからもそのままビルドするため，NuttX 依存のヘッダを含めないこと．
+ *
+ * Record は uint32_t の列として扱い，前の Record から予測した残差を符号化する．
+ *   - 先頭の word (タイムスタンプ) : 差分の差分を ZigZag 変換した値
+ *   - それ以外 (温度，各軸の float)  : 前の値との XOR
+ * 残差は下位から必要なバイト数 (0〜4) だけを出力し，バイト数は 1 word あたり 4 bit の
+ * 制御ニブルとして Record の先頭にまとめる．
+ */
+
+static uint32_t ZigZag(uint32_t value)
+{
+    return (value << 1) ^ (uint32_t) ((int32_t) value >> 31);
+}
+
+static uint32_t UnZigZag(uint32_t value)
+{
+    return (value >> 1) ^ (uint32_t) -(int32_t) (value & 1);
+}
+
+static uint32_t GetByteLength(uint32_t value)
+{
+    if (value == 0) {
+        return 0;
+    } else if (value < 0x100) {
+        return 1;
+    } else if (value < 0x10000) {
+        return 2;
+    } else if (value < 0x1000000) {
+        return 3;
+    }
+    return 4;
+}
+
+/**
+ * @brief 予測の状態を初期化する
+ *
+ * @note Frame (元の Block) 毎に初期化し，Frame 単位で独立して復号できるようにする．
+ *
+ * @retval false recordSize が 4 の倍数でない，または大きすぎる
+ */
+bool Logging_Codec_Reset(Logging_Codec_State_t* state, uint32_t recordSize)
+{
+    if (recordSize == 0 || recordSize % sizeof(uint32_t) != 0
+        || recordSize / sizeof(uint32_t) > LOGGING_CODEC_MAX_WORDS) {
+        return false;
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->numWords = recordSize / sizeof(uint32_t);
+    return true;
+}
+
+/**
+ * @brief 1 Record を符号化する
+ *
+ * @param dst LOGGING_CODEC_MAX_ENCODED_BYTES 以上の領域
+ * @return 符号化後のバイト数
+ */
+uint32_t Logging_Codec_EncodeRecord(Logging_Codec_State_t* state, const void* record, uint8_t* dst)
+{
+    uint32_t words[LOGGING_CODEC_MAX_WORDS];
+    uint32_t numControls = (state->numWords + 1) / 2;
+    uint8_t* ptr         = dst + numControls;
+
+    memcpy(words, record, state->numWords * sizeof(uint32_t));
+    memset(dst, 0, numControls);
+
+    for (uint32_t i = 0; i < state->numWords; ++i) {
+        uint32_t residual;
+
+        if (i == 0) {
+            uint32_t delta = words[0] - state->prev[0];
+            residual         = ZigZag(delta - state->prevDelta);
+            state->prevDelta = delta;
+        } else {
+            residual = words[i] ^ state->prev[i];
+        }
+        state->prev[i] = words[i];
+
+        uint32_t length = GetByteLength(residual);
+        dst[i / 2] |= length << ((i & 1) * 4);
+        for (uint32_t n = 0; n < length; ++n) {
+            *ptr++     = (uint8_t) residual;
+            residual >>= 8;
+        }
+    }
+
+    return ptr - dst;
+}
+
+/**
+ * @brief 1 Record を復号する
+ *
+ * @param size src の残りバイト数
+ * @return 消費したバイト数，src が足りないか不正な場合は -1
+ */
+int32_t Logging_Codec_DecodeRecord(Logging_Codec_State_t* state, const uint8_t* src, uint32_t size, void* record)
+{
+    uint32_t words[LOGGING_CODEC_MAX_WORDS];
+    uint32_t numControls = (state->numWords + 1) / 2;
+    const uint8_t* ptr   = src + numControls;
+
+    if (size < numControls) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < state->numWords; ++i) {
+        uint32_t length   = (src[i / 2] >> ((i & 1) * 4)) & 0xF;
+        uint32_t residual = 0;
+
+        if (length > 4 || ptr + length > src + size) {
+            return -1;
+        }
+        for (uint32_t n = 0; n < length; ++n) {
+            residual |= (uint32_t) *ptr++ << (n * 8);
+        }
+
+        if (i == 0) {
+            uint32_t delta = UnZigZag(residual) + state->prevDelta;
+            words[0]         = state->prev[0] + delta;
+            state->prevDelta = delta;
+        } else {
+            words[i] = residual ^ state->prev[i];
+        }
+    }
+
+    memcpy(state->prev, words, state->numWords * sizeof(uint32_t));
+    memcpy(record, words, state->numWords * sizeof(uint32_t));
+    return ptr - src;
+}
+
+/**
+ * @brief Record の配列をまとめて符号化する
+ *
+ * @note Record に満たない末尾のバイトはそのまま付加する．
+ *
+ * @return 符号化後のバイト数，dst に収まらない場合は 0
+ */
+uint32_t Logging_Codec_Encode(uint32_t recordSize, const void* src, uint32_t size, void* dst, uint32_t dstSize)
+{
+    Logging_Codec_State_t state;
+    const uint8_t* in = src;
+    uint8_t* out      = dst;
+    uint32_t written  = 0;
+    uint8_t encoded[LOGGING_CODEC_MAX_ENCODED_BYTES];
+
+    if (!Logging_Codec_Reset(&state, recordSize)) {
+        return 0;
+    }
+
+    for (uint32_t pos = 0; pos + recordSize <= size; pos += recordSize) {
+        uint32_t length = Logging_Codec_EncodeRecord(&state, in + pos, encoded);
+        if (written + length > dstSize) {
+            return 0;
+        }
+        memcpy(out + written, encoded, length);
+        written += length;
+    }
+
+    uint32_t tail = size % recordSize;
+    if (written + tail > dstSize) {
+        return 0;
+    }
+    memcpy(out + written, in + size - tail, tail);
+
+    return written + tail;
+}
+
+/**
+ * @brief Logging_Codec_Encode() の出力を復号する
+ *
+ * @param size 復号後のバイト数 (元の Footer の size)
+ * @return 消費したバイト数，不正な場合は -1
+ */
+int32_t Logging_Codec_Decode(uint32_t recordSize, const void* src, uint32_t srcSize, void* dst, uint32_t size)
+{
+    Logging_Codec_State_t state;
+    const uint8_t* in = src;
+    uint8_t* out      = dst;
+    uint32_t consumed = 0;
+
+    if (!Logging_Codec_Reset(&state, recordSize)) {
+        return -1;
+    }
+
+    for (uint32_t pos = 0; pos + recordSize <= size; pos += recordSize) {
+        int32_t length = Logging_Codec_DecodeRecord(&state, in + consumed, srcSize - consumed, out + pos);
+        if (length < 0) {
+            return -1;
+        }
+        consumed += length;
+    }
+
+    uint32_t tail = size % recordSize;
+    if (consumed + tail > srcSize) {
+        return -1;
+    }
+    memcpy(out + size - tail, in + consumed, tail);
+
+    return consumed + tail;
+}
+
+/**
+ * @brief Record の配列を同じ領域に上書きして符号化する
+ *
+ * @note 符号は一旦 stage に置き，読み終えた入力の範囲までを書き戻す．先頭の Record のように
+ *       符号が元より長くなる分は stage に溜まり，後続の Record が縮むと書き戻される．
+ *       先に長さだけを求めて stage が溢れないことを確認するため，符号化できない場合でも元のデータは壊さない．
+ *
+ * @return 符号化後のバイト数，上書きできない，または小さくならない場合は 0
+ */
+uint32_t Logging_Codec_EncodeInPlace(uint32_t recordSize, void* data, uint32_t size)
+{
+    Logging_Codec_State_t state;
+    uint8_t* ptr     = data;
+    uint32_t written = 0;
+    uint8_t stage[LOGGING_CODEC_INPLACE_STAGE_SIZE];
+    uint8_t tail[LOGGING_CODEC_MAX_WORDS * sizeof(uint32_t)];
+
+    if (!Logging_Codec_Reset(&state, recordSize)) {
+        return 0;
+    }
+    for (uint32_t pos = 0; pos + recordSize <= size; pos += recordSize) {
+        written += Logging_Codec_EncodeRecord(&state, ptr + pos, stage);
+        if (written > pos + recordSize + sizeof(stage) - LOGGING_CODEC_MAX_ENCODED_BYTES) {
+            return 0;
+        }
+    }
+
+    uint32_t tailSize = size % recordSize;
+    if (written + tailSize >= size) {
+        return 0;
+    }
+    memcpy(tail, ptr + size - tailSize, tailSize);
+
+    uint32_t staged = 0;
+    Logging_Codec_Reset(&state, recordSize);
+    written = 0;
+    for (uint32_t pos = 0; pos + recordSize <= size; pos += recordSize) {
+        staged += Logging_Codec_EncodeRecord(&state, ptr + pos, stage + staged);
+
+        uint32_t length = pos + recordSize - written;
+        if (length > staged) {
+            length = staged;
+        }
+        memcpy(ptr + written, stage, length);
+        memmove(stage, stage + length, staged - length);
+        written += length;
+        staged  -= length;
+    }
+    memcpy(ptr + written, stage, staged);
+    written += staged;
+    memcpy(ptr + written, tail, tailSize);
+
+    return written + tailSize;
+}
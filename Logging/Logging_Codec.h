@@ -0,0 +1,24 @@
+#ifndef LOGGING_CODEC_H
+#define LOGGING_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOGGING_CODEC_MAX_WORDS          (16)
+#define LOGGING_CODEC_MAX_ENCODED_BYTES  ((LOGGING_CODEC_MAX_WORDS + 1) / 2 + LOGGING_CODEC_MAX_WORDS * 4)
+#define LOGGING_CODEC_INPLACE_STAGE_SIZE (256)
+
+typedef struct tagLogging_Codec_State_t {
+    uint32_t numWords;
+    uint32_t prevDelta;                     /* Previous delta of word 0 (timestamp) */
+    uint32_t prev[LOGGING_CODEC_MAX_WORDS]; /* Previous record */
+} Logging_Codec_State_t;
+
+bool     Logging_Codec_Reset(Logging_Codec_State_t* state, uint32_t recordSize);
+uint32_t Logging_Codec_EncodeRecord(Logging_Codec_State_t* state, const void* record, uint8_t* dst);
+int32_t  Logging_Codec_DecodeRecord(Logging_Codec_State_t* state, const uint8_t* src, uint32_t size, void* record);
+uint32_t Logging_Codec_Encode(uint32_t recordSize, const void* src, uint32_t size, void* dst, uint32_t dstSize);
+int32_t  Logging_Codec_Decode(uint32_t recordSize, const void* src, uint32_t srcSize, void* dst, uint32_t size);
+uint32_t Logging_Codec_EncodeInPlace(uint32_t recordSize, void* data, uint32_t size);
+
+#endif /* LOGGING_CODEC_H */
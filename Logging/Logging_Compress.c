@@ -0,0 +1,224 @@
+#include "Logging_Compress.h"
+
+#include <nuttx/config.h>
+#include <string.h>
+
+#include "Common_DebugPrint.h"
+#include "Common_Rtc.h"
+#include "Logging_Buffer_public.h"
+#include "Logging_Codec.h"
+#include "Logging_Writer.h"
+
+#define CONTAINER_SIZE (64 * 1024)
+
+typedef struct tagLogging_Compress_t {
+    bool                          isOpen;
+    uint32_t                      seqId;
+    uint32_t*                     frameOffset; /* First word of the container body */
+    Logging_Buffer_Desc_t         logdesc;
+    Logging_Codec_State_t         codec;
+    Logging_Compress_Statistics_t stats;
+} Logging_Compress_t;
+
+static uint8_t logging_compress_buffer[CONTAINER_SIZE] LOGGING_BUFFER_ALIGNED;
+static Logging_Compress_t logging_compress_instance;
+
+static Logging_Compress_t* GetInstance(void)
+{
+    return &logging_compress_instance;
+}
+
+static void OpenContainer(void)
+{
+    Logging_Compress_t* self = GetInstance();
+    uint32_t noFrame         = LOG_CODEC_NO_FRAME;
+
+    Logging_Buffer_SetOptions(&self->logdesc, Logging_BufferOption_COMPRESSED | Logging_BufferOption_DEFERRED_CRC);
+    Logging_Buffer_Init(&self->logdesc, LoggingUser_COMPRESSED, self->seqId, 0, logging_compress_buffer,
+        CONTAINER_SIZE);
+    self->frameOffset = Logging_Buffer_GetNextPos(&self->logdesc);
+    Logging_Buffer_Write(&self->logdesc, &noFrame, sizeof(noFrame));
+    self->isOpen = true;
+    self->seqId++;
+}
+
+/**
+ * @brief Container を書き込む
+ *
+ * @note 書き込みは同期で行い，戻った時点で Container を再利用できる．
+ *       バッチの他の Block との順序は入れ替わり得るが，Container の seqId で順序を復元できる．
+ */
+static int WriteContainer(void)
+{
+    Logging_Compress_t* self = GetInstance();
+
+    Logging_Buffer_Finalize(&self->logdesc);
+    self->isOpen = false;
+    self->stats.containerCount++;
+
+    return Logging_Writer_Write(logging_compress_buffer, CONTAINER_SIZE);
+}
+
+static int Append(const void* data, uint32_t size)
+{
+    Logging_Compress_t* self = GetInstance();
+    const uint8_t* ptr       = data;
+
+    while (size > 0) {
+        if (!self->isOpen) {
+            OpenContainer();
+        }
+
+        uint32_t remain = Logging_Buffer_GetRemainingSize(&self->logdesc);
+        uint32_t length = size < remain ? size : remain;
+
+        Logging_Buffer_Write(&self->logdesc, (void *) ptr, length);
+        self->stats.encodedBytes += length;
+        ptr  += length;
+        size -= length;
+
+        if (length == remain && WriteContainer() != OK) {
+            return ERROR;
+        }
+    }
+
+    return OK;
+}
+
+/**
+ * @brief Block が対象か確認し，Frame の Header と Footer を取り出す
+ *
+ * @retval ERROR 対象外
+ */
+static int CheckFrame(const LoggingDesc_t* desc, LogCodecFrame_t* frame)
+{
+    Logging_Compress_t* self = GetInstance();
+
+    if (desc->size < sizeof(LogHeader_t) + sizeof(LogFooter_t)) {
+        return ERROR;
+    }
+    memcpy(&frame->header, desc->ptr, sizeof(LogHeader_t));
+    memcpy(&frame->footer, (uint8_t *) desc->ptr + desc->size - sizeof(LogFooter_t), sizeof(LogFooter_t));
+    if ((frame->header.flags & LOG_HEADER_FLAG_COMPRESSED) || frame->header.size != desc->size
+        || frame->footer.size > desc->size - sizeof(LogHeader_t) - sizeof(LogFooter_t)
+        || !Logging_Codec_Reset(&self->codec, frame->header.recordSize)) {
+        return ERROR;
+    }
+    return OK;
+}
+
+/**
+ * @brief Codec stream に Frame の開始を追加する
+ */
+static int BeginFrame(const LogCodecFrame_t* frame)
+{
+    Logging_Compress_t* self = GetInstance();
+
+    if (!self->isOpen) {
+        OpenContainer();
+    }
+    if (*self->frameOffset == LOG_CODEC_NO_FRAME) {
+        *self->frameOffset = self->logdesc.footer->size - sizeof(uint32_t);
+    }
+    return Append(frame, sizeof(*frame));
+}
+
+/**
+ * @brief Frame の途中で Container の書き込みに失敗した Block を数える
+ *
+ * @note Stream には途切れた Frame が残るため，同じ Block をそのまま書き込み直すことはしない．
+ */
+static int DropFrame(const LoggingDesc_t* desc)
+{
+    Logging_Compress_t* self = GetInstance();
+
+    PRINT_ERROR("Container write failed, frame dropped: user=%d\n", desc->user);
+    self->stats.errorCount++;
+    self->stats.lostBytes += Logging_Buffer_GetPayloadSize(desc->ptr);
+    return OK;
+}
+
+/**
+ * @brief Block を符号化して Codec stream に追加する
+ *
+ * @note 対象は Record のサイズが設定された Block のみ．戻り値が OK であれば内容は取り込み済みか，
+ *       書き込みに失敗して捨てたため，呼び出し側はすぐに Buffer を Producer に返してよい．
+ *
+ * @retval OK    取り込んだ，または Frame の途中で失敗して捨てた
+ * @retval ERROR 対象外．呼び出し側でそのまま書き込む
+ */
+int Logging_Compress_Add(const LoggingDesc_t* desc)
+{
+    Logging_Compress_t* self = GetInstance();
+    uint64_t start           = Common_Rtc_GetCount(Common_RtcChannel_1);
+    LogCodecFrame_t frame;
+
+    if (CheckFrame(desc, &frame) != OK) {
+        return ERROR;
+    }
+    if (BeginFrame(&frame) != OK) {
+        return DropFrame(desc);
+    }
+
+    const uint8_t* body = (const uint8_t *) desc->ptr + sizeof(LogHeader_t);
+    uint32_t recordSize = frame.header.recordSize;
+    uint32_t tail       = frame.footer.size % recordSize;
+    uint8_t encoded[LOGGING_CODEC_MAX_ENCODED_BYTES];
+
+    for (uint32_t pos = 0; pos + recordSize <= frame.footer.size; pos += recordSize) {
+        uint32_t length = Logging_Codec_EncodeRecord(&self->codec, body + pos, encoded);
+        if (Append(encoded, length) != OK) {
+            return DropFrame(desc);
+        }
+    }
+    if (Append(body + frame.footer.size - tail, tail) != OK) {
+        return DropFrame(desc);
+    }
+
+    self->stats.frameCount++;
+    self->stats.rawBytes    += desc->size;
+    self->stats.encodeTicks += Common_Rtc_GetCount(Common_RtcChannel_1) - start;
+
+    return OK;
+}
+
+/**
+ * @brief Body の先頭が既に符号化されている Block (ASMP Worker で符号化済み) を Codec stream に追加する
+ *
+ * @param encodedSize Body の先頭にある符号のバイト数
+ */
+int Logging_Compress_AddEncoded(const LoggingDesc_t* desc, uint32_t encodedSize)
+{
+    Logging_Compress_t* self = GetInstance();
+    LogCodecFrame_t frame;
+
+    if (CheckFrame(desc, &frame) != OK || BeginFrame(&frame) != OK
+        || Append((const uint8_t *) desc->ptr + sizeof(LogHeader_t), encodedSize) != OK) {
+        return ERROR;
+    }
+
+    self->stats.frameCount++;
+    self->stats.rawBytes += desc->size;
+
+    return OK;
+}
+
+/**
+ * @brief 書きかけの Container を書き込む
+ *
+ * @note 残りは 0 で埋め，Container のサイズは変えない．
+ */
+int Logging_Compress_Flush(void)
+{
+    Logging_Compress_t* self = GetInstance();
+
+    if (!self->isOpen) {
+        return OK;
+    }
+    return WriteContainer();
+}
+
+void Logging_Compress_GetStatistics(Logging_Compress_Statistics_t* stats)
+{
+    *stats = GetInstance()->stats;
+}
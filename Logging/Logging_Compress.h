@@ -0,0 +1,23 @@
+#ifndef LOGGING_COMPRESS_H
+#define LOGGING_COMPRESS_H
+
+#include <stdint.h>
+
+#include "Logging_public.h"
+
+typedef struct tagLogging_Compress_Statistics_t {
+    uint32_t frameCount;     /* Blocks encoded into the codec stream */
+    uint32_t containerCount; /* Compressed blocks written */
+    uint64_t rawBytes;       /* Original block bytes handed to the codec */
+    uint64_t encodedBytes;   /* Codec stream bytes, including frame headers */
+    uint64_t encodeTicks;    /* RTC ticks spent encoding on the main core */
+    uint32_t errorCount;     /* Blocks dropped because a container write failed mid-frame */
+    uint64_t lostBytes;      /* Payload bytes of those blocks */
+} Logging_Compress_Statistics_t;
+
+int  Logging_Compress_Add(const LoggingDesc_t* desc);
+int  Logging_Compress_AddEncoded(const LoggingDesc_t* desc, uint32_t encodedSize);
+int  Logging_Compress_Flush(void);
+void Logging_Compress_GetStatistics(Logging_Compress_Statistics_t* stats);
+
+#endif /* LOGGING_COMPRESS_H */
@@ -0,0 +1,114 @@
+#include "Logging_Crc.h"
+
+#ifndef LOGGING_WORKER
+#include <pthread.h>
+#endif
+
+#include "Logging_public.h"
+
+#define NUM_SLICES (8)
+
+static const uint32_t polynomial[Logging_Crc_NUM] = {
+    [Logging_Crc_CRC32]  = 0xEDB88320,
+    [Logging_Crc_CRC32C] = 0x82F63B78,
+};
+
+static uint32_t crcTable[Logging_Crc_NUM][NUM_SLICES][256];
+#ifndef LOGGING_WORKER
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/**
+ * @brief Slice-by-8 用のテーブルを生成する
+ *
+ * @note table[k][i] は i の後ろに k バイトの 0 が続く場合の CRC．
+ */
+static void InitTables(void)
+{
+    for (int type = 0; type < Logging_Crc_NUM; ++type) {
+        uint32_t (*table)[256] = crcTable[type];
+
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ polynomial[type] : crc >> 1;
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < NUM_SLICES; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+}
+
+/**
+ * @note ASMP Worker にはスレッドが無いため，起動時に 1 回だけ呼ぶ前提で直接生成する．
+ */
+void Logging_Crc_Init(void)
+{
+#ifdef LOGGING_WORKER
+    InitTables();
+#else
+    pthread_once(&crcOnce, InitTables);
+#endif
+}
+
+/**
+ * @brief CRC を更新する
+ *
+ * @note crc32part() と同様に初期値と最終反転は呼び出し側で行う．
+ *       8 バイト単位で処理し，バイト毎のテーブル参照に比べて依存チェーンを 1/8 にする．
+ */
+uint32_t Logging_Crc_Update(Logging_Crc_e type, uint32_t crc, const void* data, uint32_t size)
+{
+    const uint32_t (*table)[256] = (const uint32_t (*)[256]) crcTable[type];
+    const uint8_t* ptr = data;
+
+    while (size > 0 && ((uintptr_t) ptr & 3) != 0) {
+        crc = table[0][(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+
+    while (size >= 8) {
+        uint32_t one = *(const uint32_t *) ptr ^ crc;
+        uint32_t two = *(const uint32_t *) (ptr + 4);
+
+        crc = table[7][one & 0xFF]
+            ^ table[6][(one >> 8) & 0xFF]
+            ^ table[5][(one >> 16) & 0xFF]
+            ^ table[4][one >> 24]
+            ^ table[3][two & 0xFF]
+            ^ table[2][(two >> 8) & 0xFF]
+            ^ table[1][(two >> 16) & 0xFF]
+            ^ table[0][two >> 24];
+        ptr  += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = table[0][(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Finalize 済みの Block 全体の CRC を求める
+ *
+ * @note Logging_Buffer と同じく Header，有効な Body，CRC を除く Footer の順に計算し，最後に反転する．
+ *       種類は Header の LOG_HEADER_FLAG_CRC32C で決める．
+ */
+uint32_t Logging_Crc_ComputeBlock(const void* block)
+{
+    const LogHeader_t* header = block;
+    const LogFooter_t* footer = (const LogFooter_t *) ((const uint8_t *) block + header->size - sizeof(LogFooter_t));
+    Logging_Crc_e type        = (header->flags & LOG_HEADER_FLAG_CRC32C) ? Logging_Crc_CRC32C : Logging_Crc_CRC32;
+    uint32_t crc = 0xFFFFFFFF;
+
+    crc = Logging_Crc_Update(type, crc, block, sizeof(LogHeader_t) + footer->size);
+    crc = Logging_Crc_Update(type, crc, footer, sizeof(LogFooter_t) - sizeof(footer->crc));
+    return ~crc;
+}
@@ -0,0 +1,16 @@
+#ifndef LOGGING_CRC_H
+#define LOGGING_CRC_H
+
+#include <stdint.h>
+
+typedef enum tagLogging_Crc_e {
+    Logging_Crc_CRC32,  /* IEEE 802.3, reflected 0xEDB88320 (same as crc32part) */
+    Logging_Crc_CRC32C, /* Castagnoli, reflected 0x82F63B78 */
+    Logging_Crc_NUM,
+} Logging_Crc_e;
+
+void     Logging_Crc_Init(void);
+uint32_t Logging_Crc_Update(Logging_Crc_e type, uint32_t crc, const void* data, uint32_t size);
+uint32_t Logging_Crc_ComputeBlock(const void* block);
+
+#endif /* LOGGING_CRC_H */
@@ -0,0 +1,339 @@
+#include "Logging_Offload.h"
+#include "Logging_Offload_public.h"
+
+#include <nuttx/config.h>
+#include <pthread.h>
+#include <string.h>
+
+#ifdef CONFIG_ASMP
+#include <asmp/mpmq.h>
+#include <asmp/mpshm.h>
+#include <asmp/mptask.h>
+#endif
+
+#include "Common_DebugPrint.h"
+#include "Common_Rtc.h"
+#include "Logging_Crc.h"
+
+#define WORKER_FILE      "/mnt/sd0/BIN/LoggingCodec"
+#define MAX_SHM_REGIONS  (4)
+#define REPLY_TIMEOUT_MS (1000)
+
+typedef struct tagLogging_Offload_Region_t {
+#ifdef CONFIG_ASMP
+    mpshm_t shm;
+#endif
+    uint8_t*  virt;
+    uintptr_t phys;
+    uint32_t  size;
+} Logging_Offload_Region_t;
+
+/**
+ * @brief ASMP Worker への CRC と圧縮の委譲
+ *
+ * @note Worker は物理アドレスで Block を読み書きするため，対象の Block は
+ *       Logging_Offload_AllocateBuffers() で確保した共有メモリ上に置く．
+ *       要求と応答は 1 つの mpmq で行い，Worker は受け取った順に処理して応答する．
+ */
+typedef struct tagLogging_Offload_t {
+    pthread_mutex_t              mutex;
+    uint32_t                     numRegions;
+    Logging_Offload_Region_t     regions[MAX_SHM_REGIONS];
+    bool                         isWorkerRunning;
+    bool                         isWorkerStuck; /* Stopping the worker failed; it may still touch the blocks */
+#ifdef CONFIG_ASMP
+    mptask_t                     task;
+    mpmq_t                       mq;
+#endif
+    uint32_t                     head;
+    uint32_t                     tail;
+    uint64_t                     sendTimes[LOGGING_OFFLOAD_MAX_JOBS];
+    uint32_t                     sizes[LOGGING_OFFLOAD_MAX_JOBS];
+    void*                        blocks[LOGGING_OFFLOAD_MAX_JOBS];
+    bool                         isCompress[LOGGING_OFFLOAD_MAX_JOBS];
+    bool                         isDiscarded[LOGGING_OFFLOAD_MAX_JOBS];
+    Logging_Offload_Statistics_t stats;
+} Logging_Offload_t;
+
+static Logging_Offload_t logging_offload_instance = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static Logging_Offload_t* GetInstance(void)
+{
+    return &logging_offload_instance;
+}
+
+static uintptr_t GetPhysAddress(const void* ptr, uint32_t size)
+{
+    Logging_Offload_t* self = GetInstance();
+    const uint8_t* addr     = ptr;
+    uintptr_t phys          = 0;
+
+    pthread_mutex_lock(&self->mutex);
+    for (uint32_t i = 0; i < self->numRegions; ++i) {
+        Logging_Offload_Region_t* region = &self->regions[i];
+        if (region->virt <= addr && addr + size <= region->virt + region->size) {
+            phys = region->phys + (addr - region->virt);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return phys;
+}
+
+/**
+ * @brief Worker からも参照できる共有メモリに Buffer 領域を確保する
+ *
+ * @note Producer が起動時に呼ぶ．Worker の有無に関わらず，確保できれば Buffer として使ってよい．
+ *
+ * @return 確保した領域，ASMP が無効または確保できない場合は NULL
+ */
+void* Logging_Offload_AllocateBuffers(uint32_t size)
+{
+#ifdef CONFIG_ASMP
+    Logging_Offload_t* self = GetInstance();
+    void* virt = NULL;
+
+    pthread_mutex_lock(&self->mutex);
+    if (self->numRegions < MAX_SHM_REGIONS) {
+        Logging_Offload_Region_t* region = &self->regions[self->numRegions];
+        int ret = mpshm_init(&region->shm, LOGGING_OFFLOAD_KEY_SHM + self->numRegions, size);
+
+        if (ret < 0) {
+            PRINT_ERROR("mpshm_init failed: %d\n", ret);
+        } else if ((virt = mpshm_attach(&region->shm, 0)) == NULL) {
+            PRINT_ERROR("mpshm_attach failed\n");
+            mpshm_destroy(&region->shm);
+        } else {
+            region->virt = virt;
+            region->phys = mpshm_virt2phys(&region->shm, virt);
+            region->size = size;
+            self->numRegions++;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return virt;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Worker を起動する
+ *
+ * @note Worker のファイルが無い場合も ERROR を返すだけで，共有メモリ上の Block の CRC は
+ *       Logging_Offload_Submit() が Main core で計算する．
+ */
+int Logging_Offload_Initialize(void)
+{
+#ifdef CONFIG_ASMP
+    Logging_Offload_t* self = GetInstance();
+    int ret;
+
+    ret = mptask_init(&self->task, WORKER_FILE);
+    if (ret != 0) {
+        PRINT_WARNING("Worker %s not loaded: %d\n", WORKER_FILE, ret);
+        return ERROR;
+    }
+    ret = mptask_assign(&self->task);
+    if (ret == 0) {
+        ret = mpmq_init(&self->mq, LOGGING_OFFLOAD_KEY_MQ, mptask_getcpuid(&self->task));
+    }
+    if (ret == 0) {
+        ret = mptask_bindobj(&self->task, &self->mq);
+    }
+    if (ret == 0) {
+        ret = mptask_exec(&self->task);
+    }
+    if (ret != 0) {
+        PRINT_ERROR("Failed to start worker: %d\n", ret);
+        mptask_destroy(&self->task, true, NULL);
+        return ERROR;
+    }
+
+    self->isWorkerRunning = true;
+    PRINT_INFO("Worker started on CPU %d\n", mptask_getcpuid(&self->task));
+    return OK;
+#else
+    return ERROR;
+#endif
+}
+
+/**
+ * @brief Worker を使わずに Main core で Block の CRC を計算する
+ */
+static void ComputeLocally(void* block)
+{
+    Logging_Offload_t* self = GetInstance();
+    const LogHeader_t* header = block;
+    LogFooter_t* footer       = (LogFooter_t *) ((uint8_t *) block + header->size - sizeof(LogFooter_t));
+
+    Logging_Crc_Init();
+    footer->crc = Logging_Crc_ComputeBlock(block);
+    self->stats.localCount++;
+}
+
+#ifdef CONFIG_ASMP
+/**
+ * @brief 応答しない Worker を強制的に停止し，未完了の依頼を全て Main core で処理する
+ *
+ * @note 停止した後は Worker が Block に触れないため，CRC を計算して Producer へ返してよい．
+ *       圧縮を依頼した Block は途中まで符号化されているか区別できないため，正しい CRC を付けず破棄する．
+ *
+ * @retval OK    停止した
+ * @retval ERROR 停止できなかった．未完了の Block は Worker が書き換える可能性がある
+ */
+static int StopWorker(void)
+{
+    Logging_Offload_t* self = GetInstance();
+    int exitCode;
+
+    self->isWorkerRunning = false;
+    int ret = mptask_destroy(&self->task, true, &exitCode);
+    if (ret != 0) {
+        PRINT_ERROR("Failed to stop worker: %d\n", ret);
+        self->isWorkerStuck = true;
+        return ERROR;
+    }
+    mpmq_destroy(&self->mq);
+
+    for (uint32_t job = self->head; job != self->tail; ++job) {
+        uint32_t slot = job % LOGGING_OFFLOAD_MAX_JOBS;
+
+        if (self->isCompress[slot]) {
+            self->isDiscarded[slot] = true;
+            self->stats.discardedCount++;
+        } else {
+            ComputeLocally(self->blocks[slot]);
+        }
+    }
+    PRINT_WARNING("Worker stopped, %u blocks completed locally\n", self->tail - self->head);
+    return OK;
+}
+#endif
+
+/**
+ * @brief Block の CRC (と圧縮) を Worker に依頼する
+ *
+ * @note 共有メモリ上の Block で Worker が動いていない場合は，ここで CRC を計算して ERROR を返す．
+ *       ERROR の場合，呼び出し側は通常の Block として扱えばよい．
+ *
+ * @retval OK    依頼した．Logging_Offload_Wait() で依頼順に結果を受け取る
+ * @retval ERROR 依頼していない
+ */
+int Logging_Offload_Submit(const LoggingDesc_t* desc, bool isCompress)
+{
+    Logging_Offload_t* self = GetInstance();
+    uintptr_t phys          = GetPhysAddress(desc->ptr, desc->size);
+
+    if (phys == 0) {
+        return ERROR;
+    }
+#ifdef CONFIG_ASMP
+    if (self->isWorkerRunning && self->tail - self->head < LOGGING_OFFLOAD_MAX_JOBS) {
+        int8_t msgid  = LOGGING_OFFLOAD_MSG_CRC | (isCompress ? LOGGING_OFFLOAD_MSG_COMPRESS : 0);
+        uint32_t slot = self->tail % LOGGING_OFFLOAD_MAX_JOBS;
+
+        self->sendTimes[slot] = Common_Rtc_GetCount(Common_RtcChannel_1);
+        self->sizes[slot]     = desc->size;
+        self->blocks[slot]    = desc->ptr;
+        self->isCompress[slot]  = isCompress;
+        self->isDiscarded[slot] = false;
+        if (mpmq_send(&self->mq, msgid, phys) == 0) {
+            self->tail++;
+            return OK;
+        }
+        PRINT_ERROR("mpmq_send failed\n");
+    }
+#endif
+
+    ComputeLocally(desc->ptr);
+    return ERROR;
+}
+
+/**
+ * @brief 最も古い依頼の完了を待つ
+ *
+ * @note 応答が REPLY_TIMEOUT_MS 以内に来ない場合は Worker を停止し，以降の依頼は StopWorker() の結果を返す．
+ *       WITHHELD 以外の Block は Worker が触れないため，Producer へ返してよい．
+ *
+ * @param encodedSize 符号化後のサイズ．Body の先頭に上書きされている．圧縮していない場合は 0
+ */
+Logging_OffloadResult_e Logging_Offload_Wait(uint32_t* encodedSize)
+{
+    *encodedSize = 0;
+#ifdef CONFIG_ASMP
+    Logging_Offload_t* self = GetInstance();
+    uint32_t data;
+
+    if (self->head == self->tail) {
+        return Logging_OffloadResult_WITHHELD;
+    }
+
+    if (self->isWorkerRunning) {
+        int ret = mpmq_timedreceive(&self->mq, &data, REPLY_TIMEOUT_MS);
+        if (ret != LOGGING_OFFLOAD_MSG_DONE) {
+            PRINT_ERROR("Worker did not reply: %d\n", ret);
+            StopWorker();
+        }
+    }
+
+    /** @note Worker を停止した後の依頼は StopWorker() で CRC を計算済みか破棄済み． */
+    if (!self->isWorkerRunning) {
+        uint32_t slot = self->head++ % LOGGING_OFFLOAD_MAX_JOBS;
+
+        if (self->isWorkerStuck) {
+            return Logging_OffloadResult_WITHHELD;
+        }
+        return self->isDiscarded[slot] ? Logging_OffloadResult_DISCARDED : Logging_OffloadResult_DONE;
+    }
+
+    uint32_t slot      = self->head % LOGGING_OFFLOAD_MAX_JOBS;
+    uint64_t roundTrip = Common_Rtc_GetCount(Common_RtcChannel_1) - self->sendTimes[slot];
+
+    self->head++;
+    self->stats.jobCount++;
+    self->stats.bytes          += self->sizes[slot];
+    self->stats.totalRoundTrip += roundTrip;
+    if (self->stats.maxRoundTrip < roundTrip) {
+        self->stats.maxRoundTrip = roundTrip;
+    }
+    if (data != 0) {
+        self->stats.compressedCount++;
+    }
+
+    *encodedSize = data;
+    return Logging_OffloadResult_DONE;
+#else
+    return Logging_OffloadResult_WITHHELD;
+#endif
+}
+
+/**
+ * @brief Worker を停止する
+ *
+ * @note 共有メモリは Producer が終了まで使うため解放しない．
+ */
+void Logging_Offload_Finalize(void)
+{
+#ifdef CONFIG_ASMP
+    Logging_Offload_t* self = GetInstance();
+    int exitCode;
+
+    if (!self->isWorkerRunning) {
+        return;
+    }
+    mpmq_send(&self->mq, LOGGING_OFFLOAD_MSG_EXIT, 0);
+    mptask_destroy(&self->task, false, &exitCode);
+    mpmq_destroy(&self->mq);
+    self->isWorkerRunning = false;
+#endif
+}
+
+void Logging_Offload_GetStatistics(Logging_Offload_Statistics_t* stats)
+{
+    *stats = GetInstance()->stats;
+}
@@ -0,0 +1,46 @@
+#ifndef LOGGING_OFFLOAD_H
+#define LOGGING_OFFLOAD_H
+
+#include <stdint.h>
+
+#include "Logging_public.h"
+
+/**
+ * @note Logging タスクと ASMP Worker (LoggingCodec_worker) の間のメッセージ．
+ *       要求は msgid に処理内容，data に Block の物理アドレスを載せる．
+ *       応答は msgid に LOGGING_OFFLOAD_MSG_DONE，data に符号化後のサイズ (圧縮しなかった場合は 0) を載せる．
+ */
+#define LOGGING_OFFLOAD_KEY_MQ          (0x4C4F)
+#define LOGGING_OFFLOAD_KEY_SHM         (0x4C50)
+#define LOGGING_OFFLOAD_MAIN_CPUID      (2)
+
+#define LOGGING_OFFLOAD_MSG_CRC         (1 << 0) /* Compute the footer CRC */
+#define LOGGING_OFFLOAD_MSG_COMPRESS    (1 << 1) /* Encode the body in place after the CRC */
+#define LOGGING_OFFLOAD_MSG_EXIT        (1 << 6)
+#define LOGGING_OFFLOAD_MSG_DONE        (1 << 5)
+
+#define LOGGING_OFFLOAD_MAX_JOBS        (4)
+
+typedef enum tagLogging_OffloadResult_e {
+    Logging_OffloadResult_DONE,      /* The CRC is set (by the worker or locally); write the block */
+    Logging_OffloadResult_DISCARDED, /* The worker was stopped and may have half-encoded the body; release unwritten */
+    Logging_OffloadResult_WITHHELD,  /* The worker could not be stopped; neither write nor release */
+} Logging_OffloadResult_e;
+
+typedef struct tagLogging_Offload_Statistics_t {
+    uint32_t jobCount;          /* Blocks processed by the worker */
+    uint32_t compressedCount;   /* Blocks the worker encoded in place */
+    uint32_t localCount;        /* Blocks whose CRC was computed on the main core (no worker) */
+    uint32_t discardedCount;    /* Blocks sent for encoding when the worker had to be stopped */
+    uint64_t bytes;             /* Block bytes processed by the worker */
+    uint64_t totalRoundTrip;    /* RTC ticks from send to reply */
+    uint64_t maxRoundTrip;
+} Logging_Offload_Statistics_t;
+
+int  Logging_Offload_Initialize(void);
+int  Logging_Offload_Submit(const LoggingDesc_t* desc, bool isCompress);
+Logging_OffloadResult_e Logging_Offload_Wait(uint32_t* encodedSize);
+void Logging_Offload_Finalize(void);
+void Logging_Offload_GetStatistics(Logging_Offload_Statistics_t* stats);
+
+#endif /* LOGGING_OFFLOAD_H */
@@ -0,0 +1,95 @@
+#include "Logging_Pool_public.h"
+
+#include <nuttx/config.h>
+#include <string.h>
+
+#include "Common_DebugPrint.h"
+
+/**
+ * @brief Buffer pool を初期化する
+ *
+ * @note 全ての Buffer を空きとして登録する．
+ *
+ * @param buffers    連続した Buffer 領域の先頭
+ * @param bufferSize Buffer 1 個のサイズ
+ * @param numBuffers Buffer の個数 (最大 LOGGING_POOL_MAX_BUFFERS)
+ */
+int Logging_Pool_Init(Logging_Pool_t* pool, void* buffers, uint32_t bufferSize, uint32_t numBuffers)
+{
+    if (numBuffers == 0 || numBuffers > LOGGING_POOL_MAX_BUFFERS) {
+        PRINT_ERROR("Invalid number of buffers: %u", numBuffers);
+        return ERROR;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->buffers    = buffers;
+    pool->bufferSize = bufferSize;
+    pool->numBuffers = numBuffers;
+    pool->freeBitmap = (uint32_t) (((uint64_t) 1 << numBuffers) - 1);
+    memset(&pool->stats, 0, sizeof(pool->stats));
+
+    return OK;
+}
+
+/**
+ * @brief 空き Buffer を取得する
+ *
+ * @note 待ち合わせは行わない．空きが無い場合は Overrun として計上する．
+ *
+ * @return Buffer, 空きが無い場合は NULL
+ */
+void* Logging_Pool_Acquire(Logging_Pool_t* pool)
+{
+    void* buffer = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->freeBitmap == 0) {
+        pool->stats.overrunCount++;
+    } else {
+        uint32_t index = 31 - __builtin_clz(pool->freeBitmap);
+
+        pool->freeBitmap &= ~(1U << index);
+        buffer            = pool->buffers + index * pool->bufferSize;
+
+        pool->stats.acquireCount++;
+        pool->stats.inUse++;
+        if (pool->stats.maxInUse < pool->stats.inUse) {
+            pool->stats.maxInUse = pool->stats.inUse;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return buffer;
+}
+
+/**
+ * @brief Buffer を空きに戻す
+ *
+ * @note Writer が書き込みを完了した後に LoggingDesc_t.callback から呼ばれる．
+ */
+void Logging_Pool_Release(Logging_Pool_t* pool, void* buffer)
+{
+    uint32_t offset = (uint8_t *) buffer - pool->buffers;
+    uint32_t index  = offset / pool->bufferSize;
+
+    if (buffer < (void *) pool->buffers || index >= pool->numBuffers || offset % pool->bufferSize != 0) {
+        PRINT_ERROR("Invalid buffer released: %p", buffer);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->freeBitmap & (1U << index)) {
+        PRINT_ERROR("Buffer released twice: %p", buffer);
+    } else {
+        pool->freeBitmap |= 1U << index;
+        pool->stats.inUse--;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void Logging_Pool_GetStatistics(Logging_Pool_t* pool, Logging_Pool_Statistics_t* stats)
+{
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,211 @@
+#include "Logging_Trace.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "Common_DebugPrint.h"
+#include "Common_Sched.h"
+#include "Common_Trace.h"
+#include "Logging_Buffer_public.h"
+#include "Logging_Pool_public.h"
+#include "Logging_public.h"
+
+#define BUFFER_NUM        (2)
+#define BUFFER_SIZE       (32 * 1024)
+#define DRAIN_INTERVAL_US (100 * 1000) // 100ms
+#define DRAIN_BATCH       (16)
+#define FORMAT_SIZE       (128)
+
+#define TRACE_PRIORITY    (Common_Sched_GetPlan(Common_SchedTask_LOGGING_TRACE)->priority)
+#define TRACE_STACK_SIZE  (Common_Sched_GetPlan(Common_SchedTask_LOGGING_TRACE)->stackSize)
+
+typedef struct tagTraceLogBuffer_t {
+    LogHeader_t header;
+    uint8_t     body[BUFFER_SIZE - sizeof(LogHeader_t) - sizeof(LogFooter_t)];
+    LogFooter_t footer;
+} TraceLogBuffer_t;
+static_assert(sizeof(TraceLogBuffer_t) == BUFFER_SIZE, "TraceLogBuffer_t size mismatch");
+static_assert(BUFFER_SIZE % LOGGING_CLUSTER_SIZE == 0, "TraceLogBuffer_t must be a whole number of clusters");
+
+/**
+ * @brief Common_Trace の Ring を定期的に取り出して出力する
+ *
+ * @note 書式化は全てこのスレッドで行い，記録した側のタスクでは行わない．
+ *       isLogged が false の場合はコンソールへ，true の場合は LoggingUser_TRACE の Block として SD カードへ出力する．
+ *       Block の Body は Common_TraceRecord_t の固定長 Record の列で，LogDecode -t で書式化できる．
+ */
+typedef struct tagLogging_Trace_t {
+    pthread_t             thread;
+    bool                  isStarted;
+    bool                  isLogged;
+    atomic_bool           isStopRequested;
+    LoggingQueue_t        mq;
+    bool                  isOpen;
+    uint32_t              seqId;
+    uint32_t              overrun;
+    Logging_Buffer_Desc_t logdesc;
+    Logging_Pool_t        pool;
+    Common_TraceRecord_t  records[DRAIN_BATCH];
+} Logging_Trace_t;
+
+static TraceLogBuffer_t logging_Trace_buffer[BUFFER_NUM] LOGGING_BUFFER_ALIGNED;
+static Logging_Trace_t logging_Trace_instance;
+
+static Logging_Trace_t* GetInstance(void)
+{
+    return &logging_Trace_instance;
+}
+
+static void ReleaseBuffer(void* ptr)
+{
+    Logging_Trace_t* self = GetInstance();
+
+    Logging_Pool_Release(&self->pool, ptr);
+}
+
+static void SendBlock(Logging_Trace_t* self)
+{
+    Logging_Buffer_Finalize(&self->logdesc);
+    LoggingDesc_t desc = { 0 };
+    desc.ptr      = self->logdesc.header;
+    desc.user     = LoggingUser_TRACE;
+    desc.type     = LoggingType_WRITE;
+    desc.size     = sizeof(TraceLogBuffer_t);
+    desc.callback = ReleaseBuffer;
+    Logging_Buffer_Send(self->mq, &desc, &self->overrun);
+    self->isOpen = false;
+    self->seqId++;
+}
+
+static void LogRecord(Logging_Trace_t* self, Common_TraceRecord_t* record)
+{
+    if (!self->isOpen) {
+        TraceLogBuffer_t* buff = Logging_Pool_Acquire(&self->pool);
+        if (buff == NULL) {
+            self->overrun += sizeof(*record);
+            return;
+        }
+        Logging_Buffer_Init(&self->logdesc, LoggingUser_TRACE, self->seqId, self->overrun, buff,
+            sizeof(TraceLogBuffer_t));
+        self->overrun = 0;
+        self->isOpen  = true;
+    }
+    Logging_Buffer_Write(&self->logdesc, record, sizeof(*record));
+    if (Logging_Buffer_GetRemainingSize(&self->logdesc) < sizeof(*record)) {
+        SendBlock(self);
+    }
+}
+
+static void PrintRecord(Common_TraceRecord_t* record)
+{
+    char text[FORMAT_SIZE];
+
+    Common_Trace_Format(record, text, sizeof(text));
+    printf("[%llu.%06llu cpu%u] %s\n", record->time / 32768, record->time % 32768 * 1000000 / 32768, record->cpu,
+        text);
+}
+
+static void Drain(Logging_Trace_t* self)
+{
+    uint32_t num;
+
+    while ((num = Common_Trace_Read(self->records, DRAIN_BATCH)) > 0) {
+        for (uint32_t i = 0; i < num; ++i) {
+            if (self->isLogged) {
+                LogRecord(self, &self->records[i]);
+            } else {
+                PrintRecord(&self->records[i]);
+            }
+        }
+    }
+}
+
+static void* Logging_Trace_Run(void* arg)
+{
+    Logging_Trace_t* self = arg;
+
+    while (!atomic_load(&self->isStopRequested)) {
+        usleep(DRAIN_INTERVAL_US);
+        Drain(self);
+    }
+    Drain(self);
+
+    if (self->isLogged) {
+        if (self->isOpen) {
+            SendBlock(self);
+        }
+        LoggingDesc_t desc = { 0 };
+        desc.type = LoggingType_END;
+        Logging_SendQueue(self->mq, &desc);
+        Logging_CloseQueue(self->mq);
+    }
+
+    Common_Trace_Statistics_t stats;
+    Common_Trace_GetStatistics(&stats);
+    PRINT_INFO("Trace written:%u dropped:%u\n", stats.writeCount, stats.dropCount);
+    return NULL;
+}
+
+/**
+ * @brief Trace の出力スレッドを起動する
+ *
+ * @note Logging_CreateQueue() の後に呼ぶ．isLogged の場合は Producer として Queue を開き，停止時に END を送る．
+ */
+int Logging_Trace_Start(bool isLogged)
+{
+    Logging_Trace_t* self = GetInstance();
+
+    self->isLogged = isLogged;
+    atomic_store(&self->isStopRequested, false);
+    if (isLogged) {
+        self->mq = Logging_OpenQueue(true);
+        Logging_Pool_Init(&self->pool, logging_Trace_buffer, sizeof(TraceLogBuffer_t), BUFFER_NUM);
+        Logging_Buffer_SetOptions(&self->logdesc, Logging_BufferOption_DEFERRED_CRC);
+        Logging_Buffer_SetRecordSize(&self->logdesc, sizeof(Common_TraceRecord_t));
+    }
+
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, TRACE_STACK_SIZE);
+    param.sched_priority = TRACE_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    int ret = pthread_create(&self->thread, &attr, Logging_Trace_Run, self);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        PRINT_ERROR("Failed to create trace thread: %d\n", ret);
+        if (isLogged) {
+            /** @note 開いた分の Open count を戻さないと Logging タスクが終了できない． */
+            LoggingDesc_t desc = { 0 };
+            desc.type = LoggingType_END;
+            Logging_SendQueue(self->mq, &desc);
+            Logging_CloseQueue(self->mq);
+        }
+        return ERROR;
+    }
+    self->isStarted = true;
+    return OK;
+}
+
+/**
+ * @brief 残りの Record を出力してスレッドを終了するよう依頼する
+ */
+void Logging_Trace_RequestStop(void)
+{
+    atomic_store(&GetInstance()->isStopRequested, true);
+}
+
+void Logging_Trace_Join(void)
+{
+    Logging_Trace_t* self = GetInstance();
+
+    if (self->isStarted) {
+        pthread_join(self->thread, NULL);
+        self->isStarted = false;
+    }
+}
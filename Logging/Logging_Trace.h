@@ -0,0 +1,10 @@
+#ifndef LOGGING_TRACE_H
+#define LOGGING_TRACE_H
+
+#include <stdbool.h>
+
+int  Logging_Trace_Start(bool isLogged);
+void Logging_Trace_RequestStop(void);
+void Logging_Trace_Join(void);
+
+#endif /* LOGGING_TRACE_H */
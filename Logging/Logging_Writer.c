@@ -1,33 +1,133 @@
+#include "Logging_Writer.h"
+
 #include "Logging.h"
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <nuttx/config.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 
 #include "Common_DebugPrint.h"
+#include "Common_Sched.h"
 #include "PowerCtrl_public.h"
 
-#define MAX_PATH_LENGTH (32)
-#define MAX_FILE_SIZE   (1024 * 1024 * 1024) // 1GB
+#define MAX_PATH_LENGTH     (32)
+#define MAX_FILE_SIZE       (1024 * 1024 * 1024) // 1GB
+#define PREALLOC_CHUNK      (1024 * 1024)        // 1MB per ftruncate, bounds the stall of concurrent writes
+#define PREALLOC_AHEAD      (4 * 1024 * 1024)    // 4MB kept allocated beyond validSize
 
-typedef struct tagLogging_Writer_t {
-    uint32_t dirId;
+#define DEFAULT_SYNC_POLICY Logging_Writer_SyncPolicy_BYTES
+#define DEFAULT_SYNC_BYTES  (1024 * 1024) // 1MB
+
+#define MAX_SESSION_NUM     (10000)
+
+#define ROTATOR_PRIORITY    (Common_Sched_GetPlan(Common_SchedTask_LOGGING_ROTATOR)->priority)
+#define ROTATOR_STACK_SIZE  (Common_Sched_GetPlan(Common_SchedTask_LOGGING_ROTATOR)->stackSize)
+
+typedef struct tagLogging_Writer_File_t {
+    int      fd;
     uint32_t fileId;
-    uint32_t fileSize;
+    uint32_t validSize;     /* Bytes actually written */
+    uint32_t allocatedSize; /* Bytes preallocated by the rotator, PREALLOC_AHEAD ahead of validSize */
+    uint32_t unsyncedBytes;
     char     filename[MAX_PATH_LENGTH];
-    int      fd;
+} Logging_Writer_File_t;
+
+typedef struct tagLogging_Writer_t {
+    pthread_mutex_t             mutex;
+    pthread_cond_t              cond;
+    pthread_t                   rotator;
+    bool                        isRotatorRunning;
+    bool                        isOpening;   /* A file with fileId is being created outside the mutex */
+    bool                        isExtending; /* The rotator is preallocating current or next outside the mutex */
+    uint32_t                    dirId;
+    uint32_t                    fileId;    /* Next unused file id; advanced only when the file was created */
+    Logging_Writer_File_t       current; /* Written by the logging task */
+    Logging_Writer_File_t       next;    /* Opened and preallocated ahead of time by the rotator */
+    Logging_Writer_File_t       retired; /* Waiting for the rotator to truncate and close it */
+    uint64_t                    lastSyncMs;
+    Logging_Writer_Statistics_t stats;
 } Logging_Writer_t;
 
-const static char* outDir = "/mnt/sd0/log";
+const static char* outDir      = "/mnt/sd0/log";
+const static char* sessionFile = "next_session";
 
-static Logging_Writer_t logging_Writer_instance;
+static Logging_Writer_t logging_Writer_instance = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond  = PTHREAD_COND_INITIALIZER,
+};
 
 static Logging_Writer_t* GetInstance(void)
 {
     return &logging_Writer_instance;
 }
 
+static uint64_t GetTimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int SyncFile(Logging_Writer_File_t* file)
+{
+    Logging_Writer_t* self = GetInstance();
+    uint64_t start         = GetTimeMs();
+    int ret = fsync(file->fd);
+    uint64_t now     = GetTimeMs();
+    uint32_t elapsed = (uint32_t) (now - start);
+
+    pthread_mutex_lock(&self->mutex);
+    if (ret < 0) {
+        PRINT_ERROR("fsync err(%s) errno(%d)\n", file->filename, errno);
+        self->stats.syncErrorCount++;
+    } else {
+        if (self->stats.maxSyncTimeMs < elapsed) {
+            self->stats.maxSyncTimeMs = elapsed;
+        }
+        self->stats.syncCount++;
+        self->stats.syncedBytes   += file->unsyncedBytes;
+        self->stats.unsyncedBytes -= file->unsyncedBytes;
+        file->unsyncedBytes        = 0;
+        if (file == &self->current) {
+            self->lastSyncMs = now;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return ret < 0 ? ERROR : OK;
+}
+
+/**
+ * @brief Sync policy に従い fsync が必要か判定する
+ *
+ * @note ROTATION は CloseFile() でのみ同期するため常に false を返す．
+ */
+static bool IsSyncRequired(void)
+{
+    Logging_Writer_t* self = GetInstance();
+
+    switch (self->stats.policy) {
+        case Logging_Writer_SyncPolicy_BYTES:
+            return self->current.unsyncedBytes >= self->stats.threshold;
+
+        case Logging_Writer_SyncPolicy_INTERVAL:
+            return GetTimeMs() - self->lastSyncMs >= self->stats.threshold;
+
+        case Logging_Writer_SyncPolicy_ROTATION:
+        default:
+            return false;
+    }
+}
+
 static int CreateTopDir(void)
 {
     Logging_Writer_t* self = GetInstance();
@@ -54,96 +154,368 @@ static int CreateTopDir(void)
     return OK;
 }
 
+/**
+ * @brief 永続化された次のセッション ID を読み出す
+ *
+ * @retval 0 以上 次のセッション ID
+ * @retval ERROR  ファイルが無い，または内容が不正
+ */
+static int ReadSessionCounter(void)
+{
+    char path[MAX_PATH_LENGTH];
+    char text[8] = { 0 };
+
+    snprintf(path, MAX_PATH_LENGTH, "%s/%s", outDir, sessionFile);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PRINT_INFO("Session counter not found: %s\n", path);
+        return ERROR;
+    }
+    ssize_t ret = read(fd, text, sizeof(text) - 1);
+    close(fd);
+
+    char* end;
+    unsigned long id = strtoul(text, &end, 10);
+    if (ret <= 0 || end == text || id >= MAX_SESSION_NUM) {
+        PRINT_WARNING("Invalid session counter: %s\n", path);
+        return ERROR;
+    }
+
+    return (int) id;
+}
+
+static int WriteSessionCounter(uint32_t id)
+{
+    char path[MAX_PATH_LENGTH];
+    char text[8];
+
+    snprintf(path, MAX_PATH_LENGTH, "%s/%s", outDir, sessionFile);
+    int len = snprintf(text, sizeof(text), "%u\n", id);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        PRINT_ERROR("open err(%s) errno(%d)\n", path, errno);
+        return ERROR;
+    }
+    int ret = OK;
+    if (write(fd, text, len) != len || fsync(fd) < 0) {
+        PRINT_ERROR("write err(%s) errno(%d)\n", path, errno);
+        ret = ERROR;
+    }
+    close(fd);
+
+    return ret;
+}
+
+/**
+ * @brief 既存のセッションディレクトリを 1 回走査し，次のセッション ID を求める
+ *
+ * @note カウンタファイルが失われた場合や，内容が実際のディレクトリと矛盾する場合の復旧用．
+ */
+static int ScanSessionDir(void)
+{
+    DIR* dir = opendir(outDir);
+    struct dirent* entry;
+    int next = 0;
+
+    if (dir == NULL) {
+        PRINT_ERROR("opendir err(%s) errno(%d)\n", outDir, errno);
+        return ERROR;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        char* end;
+        unsigned long id = strtoul(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != '\0' || id >= MAX_SESSION_NUM) {
+            continue;
+        }
+        if (next <= (int) id) {
+            next = (int) id + 1;
+        }
+    }
+    closedir(dir);
+
+    return next;
+}
+
+/**
+ * @brief セッションディレクトリを作成する
+ *
+ * @note 通常はカウンタファイルを読むだけで ID が決まる．
+ *       ID が使用済みの場合のみ ScanSessionDir() で復旧する．
+ */
 static int CreateDir(void)
 {
     Logging_Writer_t* self = GetInstance();
-    int ret;
-    struct stat info;
+    char dirname[MAX_PATH_LENGTH];
+    int id = ReadSessionCounter();
+
+    for (int retry = 0; retry < 2; ++retry) {
+        if (id == ERROR || retry > 0) {
+            id = ScanSessionDir();
+        }
+        if (id == ERROR || id >= MAX_SESSION_NUM) {
+            PRINT_ERROR("No session ID available\n");
+            return ERROR;
+        }
 
-    for (int idx = 0; idx < 10000; ++idx) {
-        snprintf(self->filename,
+        snprintf(dirname,
             MAX_PATH_LENGTH,
             "%s/%04d",
             outDir,
-            idx
+            id
         );
 
-        if (stat(self->filename, &info) == 0) {
-            PRINT_DEBUG("File already exists: %s\n", self->filename);
-            continue;
-        } else if (errno == ENOENT) {
-            self->dirId = idx;
-            ret         = mkdir(self->filename, 0666);
-            if (ret == OK) {
-                PRINT_INFO("Create directory: %s\n", self->filename);
-                return OK;
-            } else {
-                if (errno != EEXIST) {
-                    PRINT_ERROR("mkdir err(errno:%d)\n", errno);
-                    return ERROR;
-                }
-            }
+        if (mkdir(dirname, 0666) == OK) {
+            PRINT_INFO("Create directory: %s\n", dirname);
+            self->dirId = id;
+            WriteSessionCounter(id + 1);
+            return OK;
+        }
+        if (errno != EEXIST) {
+            PRINT_ERROR("mkdir err(errno:%d)\n", errno);
+            return ERROR;
         }
+        PRINT_WARNING("Session counter is stale: %s\n", dirname);
     }
 
     return ERROR;
 } /* CreateDir */
 
-static int OpenFile(void)
+/**
+ * @brief ログファイルを作成する
+ *
+ * @note 事前確保は Rotator が PreallocateFile() で少しずつ行うため，ここでは作成だけ行う．
+ *       起動時の最初のファイルも Queue ができる前にすぐ開ける．
+ */
+static int OpenFile(Logging_Writer_File_t* file, uint32_t fileId)
 {
     Logging_Writer_t* self = GetInstance();
-    struct stat tmp;
 
-    snprintf(self->filename,
+    snprintf(file->filename,
         MAX_PATH_LENGTH,
         "%s/%04d/%02d.bin",
         outDir,
         self->dirId,
-        self->fileId
+        fileId
     );
 
-    self->fd = creat(self->filename, 0644);
-    if (self->fd < 0) {
-        PRINT_ERROR("open err(%s) errno(%d)\n", self->filename, errno);
+    file->fd = creat(file->filename, 0644);
+    if (file->fd < 0) {
+        PRINT_ERROR("open err(%s) errno(%d)\n", file->filename, errno);
         return ERROR;
     }
 
-    self->fileId++;
-    self->fileSize = 0;
+    file->fileId        = fileId;
+    file->validSize     = 0;
+    file->allocatedSize = 0;
+    file->unsyncedBytes = 0;
 
     return OK;
 }
 
-static int CloseFile(void)
+/**
+ * @brief ログファイルを有効長に切り詰めて閉じる
+ */
+static int CloseFile(Logging_Writer_File_t* file)
 {
-    Logging_Writer_t* self = GetInstance();
-
     int ret = OK;
 
-    if (self->fd >= 0) {
-        PRINT_INFO("Close file: %s\n", self->filename);
-        if (fsync(self->fd) < 0) {
-            PRINT_ERROR("fsync err(%s) errno(%d)\n", self->filename, errno);
+    if (file->fd >= 0) {
+        PRINT_INFO("Close file: %s (%u bytes)\n", file->filename, file->validSize);
+        if (ftruncate(file->fd, file->validSize) < 0) {
+            PRINT_ERROR("ftruncate err(%s) errno(%d)\n", file->filename, errno);
             ret = ERROR;
         }
-        if (close(self->fd) < 0) {
-            PRINT_ERROR("close err(%s) errno(%d)\n", self->filename, errno);
+        if (SyncFile(file) == ERROR) {
             ret = ERROR;
         }
-        self->fd = -1;
+        if (close(file->fd) < 0) {
+            PRINT_ERROR("close err(%s) errno(%d)\n", file->filename, errno);
+            ret = ERROR;
+        }
+        file->fd = -1;
     }
 
     return ret;
 }
 
+/**
+ * @brief fileId のファイルを mutex の外で作成する
+ *
+ * @note mutex を保持して呼ぶ．作成中は isOpening で他方の作成を待たせ，ファイル番号の順を保つ．
+ *       作成に失敗した場合は fileId を進めず，同じ番号で再試行する．
+ */
+static int OpenNextFile(Logging_Writer_File_t* file)
+{
+    Logging_Writer_t* self = GetInstance();
+    uint32_t fileId        = self->fileId;
+
+    self->isOpening = true;
+    pthread_mutex_unlock(&self->mutex);
+    int ret = OpenFile(file, fileId);
+    pthread_mutex_lock(&self->mutex);
+    self->isOpening = false;
+    if (ret == OK) {
+        self->fileId = fileId + 1;
+    }
+    pthread_cond_broadcast(&self->cond);
+    return ret;
+}
+
+/**
+ * @brief 事前確保が必要なファイルを返す
+ *
+ * @note mutex を保持して呼ぶ．書き込み中のファイルを優先し，次のファイルは最初の 1 区間だけ確保する．
+ */
+static Logging_Writer_File_t* GetPreallocTarget(void)
+{
+    Logging_Writer_t* self = GetInstance();
+    Logging_Writer_File_t* file = &self->current;
+
+    if (file->fd >= 0 && file->allocatedSize < MAX_FILE_SIZE
+        && file->allocatedSize < file->validSize + PREALLOC_AHEAD) {
+        return file;
+    }
+    file = &self->next;
+    if (file->fd >= 0 && file->allocatedSize < PREALLOC_AHEAD) {
+        return file;
+    }
+    return NULL;
+}
+
+/**
+ * @brief ファイルを PREALLOC_CHUNK だけ延ばし，FAT のクラスタチェーンを先に確保する
+ *
+ * @note mutex を保持して呼ぶ．FAT の延長はゼロ埋めの書き込みを伴い，その間は同じボリュームへの
+ *       書き込みも待たされるため，1 回の延長を PREALLOC_CHUNK に抑える．
+ *       延長中は isExtending で RotateFile() の差し替えを待たせ，file が指すファイルを変えない．
+ */
+static void PreallocateFile(Logging_Writer_File_t* file)
+{
+    Logging_Writer_t* self = GetInstance();
+    uint32_t size = file->allocatedSize + PREALLOC_CHUNK;
+    int fd        = file->fd;
+
+    if (size < file->validSize) {
+        size = file->validSize + PREALLOC_CHUNK;
+    }
+    self->isExtending = true;
+    pthread_mutex_unlock(&self->mutex);
+    uint64_t start = GetTimeMs();
+    int ret = ftruncate(fd, size);
+    uint32_t elapsed = (uint32_t) (GetTimeMs() - start);
+    pthread_mutex_lock(&self->mutex);
+    self->isExtending = false;
+
+    if (ret < 0) {
+        /** @note 確保できなくても書き込みでファイルは伸びるため，このファイルでは諦める． */
+        PRINT_WARNING("preallocate err(%s) errno(%d)\n", file->filename, errno);
+        self->stats.preallocErrorCount++;
+        file->allocatedSize = MAX_FILE_SIZE;
+    } else {
+        self->stats.preallocBytes += size - file->allocatedSize;
+        self->stats.preallocCount++;
+        self->stats.totalPreallocMs += elapsed;
+        if (self->stats.maxPreallocMs < elapsed) {
+            self->stats.maxPreallocMs = elapsed;
+        }
+        file->allocatedSize = size;
+    }
+    pthread_cond_broadcast(&self->cond);
+}
+
+/**
+ * @brief 次のファイルの事前作成と事前確保，退役したファイルのクローズを行う Thread
+ *
+ * @note cond は RotateFile() の待ち合わせと共用するため，状態を変えたら broadcast する．
+ */
+static void* Rotator(void* arg)
+{
+    Logging_Writer_t* self = GetInstance();
+    Logging_Writer_File_t file;
+    Logging_Writer_File_t* target;
+
+    pthread_mutex_lock(&self->mutex);
+    while (self->isRotatorRunning) {
+        if (self->retired.fd >= 0) {
+            file = self->retired;
+            pthread_mutex_unlock(&self->mutex);
+            CloseFile(&file);
+            pthread_mutex_lock(&self->mutex);
+            self->retired.fd = -1;
+            pthread_cond_broadcast(&self->cond);
+        } else if (self->next.fd < 0 && !self->isOpening) {
+            if (OpenNextFile(&file) == OK) {
+                self->next = file;
+            } else {
+                /** @note 作成に失敗した場合は次のローテーションで同期的に再試行する． */
+                pthread_cond_wait(&self->cond, &self->mutex);
+            }
+        } else if ((target = GetPreallocTarget()) != NULL) {
+            PreallocateFile(target);
+        } else {
+            pthread_cond_wait(&self->cond, &self->mutex);
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief 現在のファイルを事前作成済みのファイルと差し替える
+ *
+ * @note 前のファイルのクローズや次のファイルの作成，事前確保を Rotator が行っている間は，その完了を待つ．
+ *       次のファイルが無い場合のみ，この場で同期的に作成する．いずれの場合もファイル番号は昇順に使う．
+ *       作成に失敗した場合は現在のファイルに書き続け，次の書き込みで再試行する．
+ */
+static int RotateFile(void)
+{
+    Logging_Writer_t* self = GetInstance();
+
+    pthread_mutex_lock(&self->mutex);
+    while (self->isRotatorRunning && (self->retired.fd >= 0 || self->isOpening || self->isExtending)) {
+        pthread_cond_wait(&self->cond, &self->mutex);
+    }
+    if (self->next.fd >= 0) {
+        self->retired = self->current;
+        self->current = self->next;
+        self->next.fd = -1;
+        pthread_cond_broadcast(&self->cond);
+        pthread_mutex_unlock(&self->mutex);
+        return OK;
+    }
+
+    PRINT_WARNING("Next file is not ready, rotate synchronously\n");
+    Logging_Writer_File_t file;
+    int ret = OpenNextFile(&file);
+    pthread_mutex_unlock(&self->mutex);
+    if (ret != OK) {
+        return ERROR;
+    }
+
+    CloseFile(&self->current);
+    self->current = file;
+    return OK;
+}
+
 int Logging_Writer_Initialize(void)
 {
     Logging_Writer_t* self = GetInstance();
 
-    self->fd       = -1;
-    self->dirId    = 0;
-    self->fileId   = 0;
-    self->fileSize = 0;
+    self->current.fd = -1;
+    self->next.fd    = -1;
+    self->retired.fd = -1;
+    self->isOpening   = false;
+    self->isExtending = false;
+    self->dirId       = 0;
+    self->fileId     = 0;
+
+    memset(&self->stats, 0, sizeof(self->stats));
+    self->stats.policy    = DEFAULT_SYNC_POLICY;
+    self->stats.threshold = DEFAULT_SYNC_BYTES;
+    self->lastSyncMs      = GetTimeMs();
 
     if (CreateTopDir() == ERROR) {
         PRINT_ERROR("Failed to create top directory: %s\n", outDir);
@@ -155,36 +527,239 @@ int Logging_Writer_Initialize(void)
         return ERROR;
     }
 
-    if (OpenFile() == ERROR) {
+    if (OpenFile(&self->current, self->fileId) == ERROR) {
         PRINT_ERROR("Failed to open file\n");
         return ERROR;
     }
+    self->fileId++;
+
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, ROTATOR_STACK_SIZE);
+    param.sched_priority = ROTATOR_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    self->isRotatorRunning = true;
+    if (pthread_create(&self->rotator, &attr, Rotator, NULL) != 0) {
+        /** @note Rotator が無くても同期的なローテーションで動作は継続できる． */
+        PRINT_WARNING("Failed to create rotator thread\n");
+        self->isRotatorRunning = false;
+    }
+    pthread_attr_destroy(&attr);
+
+    return OK;
+}
+
+/**
+ * @brief fsync の実行方針を設定する
+ *
+ * @param policy    Sync policy
+ * @param threshold BYTES ならバイト数，INTERVAL ならミリ秒．ROTATION では無視する．
+ */
+int Logging_Writer_SetSyncPolicy(Logging_Writer_SyncPolicy_e policy, uint32_t threshold)
+{
+    Logging_Writer_t* self = GetInstance();
+
+    if (policy > Logging_Writer_SyncPolicy_ROTATION) {
+        PRINT_ERROR("Invalid sync policy: %d\n", policy);
+        return ERROR;
+    }
+    if (policy != Logging_Writer_SyncPolicy_ROTATION && threshold == 0) {
+        PRINT_ERROR("Invalid sync threshold: %u\n", threshold);
+        return ERROR;
+    }
+
+    self->stats.policy    = policy;
+    self->stats.threshold = threshold;
+    self->lastSyncMs      = GetTimeMs();
 
     return OK;
 }
 
-int Logging_Writer_Write(void* data, size_t size)
+void Logging_Writer_GetStatistics(Logging_Writer_Statistics_t* stats)
+{
+    Logging_Writer_t* self = GetInstance();
+
+    pthread_mutex_lock(&self->mutex);
+    *stats = self->stats;
+    pthread_mutex_unlock(&self->mutex);
+}
+
+static int PostWrite(size_t size)
 {
     Logging_Writer_t* self = GetInstance();
 
-    size_t ret = write(self->fd, data, size);
+    pthread_mutex_lock(&self->mutex);
+    self->current.validSize     += size;
+    self->current.unsyncedBytes += size;
+    self->stats.writtenBytes    += size;
+    self->stats.unsyncedBytes   += size;
+    if (self->stats.maxUnsyncedBytes < self->stats.unsyncedBytes) {
+        self->stats.maxUnsyncedBytes = self->stats.unsyncedBytes;
+    }
+    if (self->current.allocatedSize < self->current.validSize + PREALLOC_AHEAD) {
+        pthread_cond_broadcast(&self->cond);
+    }
+    pthread_mutex_unlock(&self->mutex);
 
-    if (true) {
-        fsync(self->fd);
+    if (IsSyncRequired()) {
+        SyncFile(&self->current);
     }
 
-    PRINT_DEBUG("Write data to file: %s, size: %zu %d\n", self->filename, size, ret);
+    /** @note 書き込み自体は済んでいるため，ローテーションの失敗は書き込みの失敗として返さない． */
+    if (self->current.validSize >= MAX_FILE_SIZE && RotateFile() != OK) {
+        PRINT_ERROR("Rotation failed, keep writing %s\n", self->current.filename);
+    }
+
+    return OK;
+}
+
+int Logging_Writer_Write(void* data, size_t size)
+{
+    struct iovec iov = {
+        .iov_base = data,
+        .iov_len  = size,
+    };
+
+    return Logging_Writer_WriteVector(&iov, 1);
+}
+
+/**
+ * @brief 複数の Buffer を 1 回の writev でファイルへ書き込む
+ */
+int Logging_Writer_WriteVector(const struct iovec* iov, int iovcnt)
+{
+    Logging_Writer_t* self = GetInstance();
+    size_t size = 0;
+
+    for (int i = 0; i < iovcnt; ++i) {
+        size += iov[i].iov_len;
+        if ((uintptr_t) iov[i].iov_base % LOGGING_BUFFER_ALIGNMENT != 0) {
+            PRINT_WARNING("Unaligned buffer: %p\n", iov[i].iov_base);
+        }
+    }
+    if (size % LOGGING_CLUSTER_SIZE != 0) {
+        PRINT_WARNING("Write size is not a multiple of the cluster size: %zu\n", size);
+    }
+
+    ssize_t ret = writev(self->current.fd, iov, iovcnt);
+
+    PRINT_DEBUG("Write data to file: %s, count: %d size: %zu %d\n", self->current.filename, iovcnt, size, ret);
 
     if (ret != size) {
-        PRINT_ERROR("write err(%s)\n", self->filename);
+        PRINT_ERROR("write err(%s) %zd/%zu errno(%d)\n", self->current.filename, ret, size, errno);
+        /**
+         * @note 途中まで書かれた分は有効長に含めず，位置を有効長に戻して次の書き込みで上書きする．
+         *       戻せない場合は書かれた分を有効長に含め，以降の Block が CloseFile() で切り詰められないようにする．
+         */
+        if (ret > 0 && lseek(self->current.fd, self->current.validSize, SEEK_SET) < 0) {
+            PRINT_ERROR("lseek err(%s) errno(%d)\n", self->current.filename, errno);
+            PostWrite(ret);
+        }
+        pthread_mutex_lock(&self->mutex);
+        self->stats.writeErrorCount++;
+        self->stats.lostBytes += size;
+        pthread_mutex_unlock(&self->mutex);
         return ERROR;
     }
-    self->fileSize += size;
-    if (self->fileSize >= MAX_FILE_SIZE) {
-        CloseFile();
-        OpenFile();
+
+    return PostWrite(size);
+}
+
+static double Benchmark(const char* path, uint8_t* buff, size_t size, uint32_t count)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        PRINT_ERROR("open err(%s) errno(%d)\n", path, errno);
+        return 0.0;
+    }
+
+    uint64_t start = GetTimeMs();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (write(fd, buff, size) != size) {
+            PRINT_ERROR("write err(%s) errno(%d)\n", path, errno);
+            break;
+        }
     }
+    fsync(fd);
+    uint64_t elapsed = GetTimeMs() - start;
 
+    close(fd);
+    unlink(path);
+
+    return elapsed > 0 ? (double) size * count / 1024 / 1024 / elapsed * 1000 : 0.0;
+}
+
+/**
+ * @brief Rotator と同じく PREALLOC_CHUNK 毎に ftruncate でファイルを延ばす時間を計測する
+ */
+static void BenchmarkPrealloc(const char* path, uint32_t totalSize)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    uint32_t count = 0;
+    uint64_t total = 0;
+    uint64_t max   = 0;
+
+    if (fd < 0) {
+        PRINT_ERROR("open err(%s) errno(%d)\n", path, errno);
+        return;
+    }
+    for (uint32_t size = PREALLOC_CHUNK; size <= totalSize; size += PREALLOC_CHUNK) {
+        uint64_t start = GetTimeMs();
+        if (ftruncate(fd, size) < 0) {
+            PRINT_ERROR("ftruncate err(%s) errno(%d)\n", path, errno);
+            break;
+        }
+        uint64_t elapsed = GetTimeMs() - start;
+        total += elapsed;
+        max    = max < elapsed ? elapsed : max;
+        count++;
+    }
+    close(fd);
+    unlink(path);
+
+    printf("Preallocate benchmark %u x %u bytes: avg %llums max %llums, %.2f MB/s\n",
+        count, PREALLOC_CHUNK, count ? total / count : 0, max,
+        total > 0 ? (double) PREALLOC_CHUNK * count / 1024 / 1024 / total * 1000 : 0.0);
+}
+
+/**
+ * @brief Aligned と Unaligned の書き込み速度と，事前確保の速度を計測する
+ *
+ * @note Aligned はセクタ境界の Buffer からクラスタ単位で書き込む．
+ *       Unaligned は Buffer の先頭をずらし，サイズもセクタ境界に合わせない．
+ */
+int Logging_Writer_Benchmark(uint32_t totalSize)
+{
+    const size_t size = 4 * LOGGING_CLUSTER_SIZE;
+    char path[MAX_PATH_LENGTH];
+    uint8_t* mem = malloc(size + LOGGING_BUFFER_ALIGNMENT);
+
+    if (mem == NULL) {
+        PRINT_ERROR("Failed to allocate benchmark buffer\n");
+        return ERROR;
+    }
+    if (CreateTopDir() == ERROR) {
+        free(mem);
+        return ERROR;
+    }
+    snprintf(path, MAX_PATH_LENGTH, "%s/bench.bin", outDir);
+
+    uint8_t* aligned = (uint8_t *) (((uintptr_t) mem + LOGGING_BUFFER_ALIGNMENT - 1)
+        & ~(uintptr_t) (LOGGING_BUFFER_ALIGNMENT - 1));
+    memset(aligned, 0x5A, size);
+
+    double alignedRate   = Benchmark(path, aligned, size, totalSize / size);
+    double unalignedRate = Benchmark(path, aligned + 1, size - 100, totalSize / size);
+
+    printf("Write benchmark %u bytes: aligned %.2f MB/s, unaligned %.2f MB/s\n",
+        totalSize, alignedRate, unalignedRate);
+    BenchmarkPrealloc(path, totalSize);
+
+    free(mem);
     return OK;
 }
 
@@ -192,6 +767,21 @@ int Logging_Writer_Close(void)
 {
     Logging_Writer_t* self = GetInstance();
 
-    CloseFile();
+    if (self->isRotatorRunning) {
+        pthread_mutex_lock(&self->mutex);
+        self->isRotatorRunning = false;
+        pthread_cond_broadcast(&self->cond);
+        pthread_mutex_unlock(&self->mutex);
+        pthread_join(self->rotator, NULL);
+    }
+
+    CloseFile(&self->retired);
+    CloseFile(&self->current);
+    if (self->next.fd >= 0) {
+        /** @note 未使用の事前作成ファイルは削除する． */
+        close(self->next.fd);
+        self->next.fd = -1;
+        unlink(self->next.filename);
+    }
     return OK;
 }
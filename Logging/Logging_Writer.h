@@ -1,10 +1,41 @@
 #ifndef LOGGING_WRITER_H
 #define LOGGING_WRITER_H
 
+#include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
-int Logging_Writer_Initialize(void);
-int Logging_Writer_Write(void* data, size_t size);
-int Logging_Writer_Close(void);
+typedef enum tagLogging_Writer_SyncPolicy_e {
+    Logging_Writer_SyncPolicy_BYTES,    /* fsync after every N bytes written */
+    Logging_Writer_SyncPolicy_INTERVAL, /* fsync when T milliseconds have elapsed since the last one */
+    Logging_Writer_SyncPolicy_ROTATION, /* fsync only on file rotation and shutdown */
+} Logging_Writer_SyncPolicy_e;
+
+typedef struct tagLogging_Writer_Statistics_t {
+    Logging_Writer_SyncPolicy_e policy;
+    uint32_t                    threshold;        /* Bytes or milliseconds, depending on policy */
+    uint64_t                    writtenBytes;     /* Total bytes handed to write() */
+    uint64_t                    syncedBytes;      /* Total bytes made durable by fsync() */
+    uint32_t                    unsyncedBytes;    /* Bytes at risk right now */
+    uint32_t                    maxUnsyncedBytes; /* Worst bytes at risk observed */
+    uint32_t                    syncCount;
+    uint32_t                    syncErrorCount;
+    uint32_t                    maxSyncTimeMs;    /* Longest single fsync() stall */
+    uint32_t                    writeErrorCount;  /* Failed or short writev() calls */
+    uint64_t                    lostBytes;        /* Bytes of failed writes, not counted in writtenBytes */
+    uint64_t                    preallocBytes;    /* Bytes preallocated ahead of the written size */
+    uint32_t                    preallocCount;
+    uint32_t                    preallocErrorCount;
+    uint32_t                    totalPreallocMs;
+    uint32_t                    maxPreallocMs;    /* Longest single preallocation step */
+} Logging_Writer_Statistics_t;
+
+int  Logging_Writer_Initialize(void);
+int  Logging_Writer_SetSyncPolicy(Logging_Writer_SyncPolicy_e policy, uint32_t threshold);
+void Logging_Writer_GetStatistics(Logging_Writer_Statistics_t* stats);
+int  Logging_Writer_Write(void* data, size_t size);
+int  Logging_Writer_WriteVector(const struct iovec* iov, int iovcnt);
+int  Logging_Writer_Close(void);
+int  Logging_Writer_Benchmark(uint32_t totalSize);
 
 #endif /* LOGGING_WRITER_H */
@@ -1,20 +1,48 @@
 #include <fcntl.h>
 #include <nuttx/config.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "Common_DebugPrint.h"
+#include "Common_Sched.h"
+#include "Logging_Buffer_public.h"
+#include "Logging_Compress.h"
+#include "Logging_Crc.h"
+#include "Logging_Offload.h"
+#include "Logging_Trace.h"
 #include "Logging_Writer.h"
 #include "PowerCtrl_public.h"
 
 #include "Logging.h"
 #include "Logging_public.h"
 
-#define MAX_PATH_LENGTH (32)
+#define MAX_PATH_LENGTH    (32)
+#define BENCHMARK_SIZE     (16 * 1024 * 1024) // 16MB
+
+#define COALESCE_MAX_DESCS (16)
+#define COALESCE_MAX_BYTES (512 * 1024) // 512KB
 
 typedef struct tagLogging_main_t {
-    int  shutdownHandlerId;
-    bool isShutdown;
+    int                         shutdownHandlerId;
+    bool                        isShutdown;
+    bool                        isStopped;
+    bool                        isCompressEnabled;
+    bool                        isTraceLogged;
+    bool                        isSyncPolicySet;
+    Logging_Writer_SyncPolicy_e syncPolicy;
+    uint32_t                    syncThreshold; /* Bytes or milliseconds, depending on syncPolicy */
+    uint32_t                    numDescs;
+    uint32_t                    numIovs;
+    uint32_t                    numPending;
+    uint32_t                    batchSize;
+    LoggingDesc_t               descs[COALESCE_MAX_DESCS];
+    bool                        isPending[COALESCE_MAX_DESCS]; /* Waiting for the ASMP worker */
+    struct iovec                iovs[COALESCE_MAX_DESCS];
+    LoggingDesc_t*              iovDescs[COALESCE_MAX_DESCS]; /* Block of each iov, for loss accounting */
+    uint32_t                    lostBytes[LoggingUser_NUM]; /* Added to the overrun of the user's next block */
+    uint64_t                    totalLostBytes;
 } Logging_main_t;
 
 static Logging_main_t logging_main_instance;
@@ -26,7 +54,10 @@ static Logging_main_t* GetInstance(void)
 
 static void ShutdownNotify(void)
 {
-    mqd_t mq = Logging_OpenQueue(true);
+    /** @note Trace の出力スレッドは残りを書き出してから END を送るため，SHUTDOWN の前に止める． */
+    Logging_Trace_RequestStop();
+
+    LoggingQueue_t mq = Logging_OpenQueue(true);
     LoggingDesc_t desc = { 0 };
 
     desc.type = LoggingType_SHUTDOWN;
@@ -35,10 +66,236 @@ static void ShutdownNotify(void)
     Logging_CloseQueue(mq);
 }
 
+/**
+ * @brief sync= 引数を解釈する
+ *
+ * @note sync=bytes,N (N バイト毎)，sync=interval,T (T ミリ秒毎)，sync=rotation (ローテーションと終了時のみ)．
+ */
+static int ParseSyncPolicy(const char* arg)
+{
+    Logging_main_t* self = GetInstance();
+    char name[16];
+    unsigned threshold = 0;
+
+    if (sscanf(arg, "sync=%15[a-z],%u", name, &threshold) < 1) {
+        return ERROR;
+    }
+    if (strcmp(name, "bytes") == 0) {
+        self->syncPolicy = Logging_Writer_SyncPolicy_BYTES;
+    } else if (strcmp(name, "interval") == 0) {
+        self->syncPolicy = Logging_Writer_SyncPolicy_INTERVAL;
+    } else if (strcmp(name, "rotation") == 0) {
+        self->syncPolicy = Logging_Writer_SyncPolicy_ROTATION;
+    } else {
+        return ERROR;
+    }
+    self->syncThreshold   = threshold;
+    self->isSyncPolicySet = true;
+    return OK;
+}
+
+static void PrintWriterStatistics(void)
+{
+    Logging_Writer_Statistics_t writer;
+
+    Logging_Writer_GetStatistics(&writer);
+    /** @note max at risk は書き込み中に fsync されていなかった最大のバイト数 (電源断で失われ得た量)． */
+    printf("Writer policy:%d threshold:%u written:%llu synced:%llu unsynced:%u max at risk:%u "
+        "syncs:%u errors:%u max sync:%ums write errors:%u lost:%llu\n",
+        writer.policy, writer.threshold, writer.writtenBytes, writer.syncedBytes, writer.unsyncedBytes,
+        writer.maxUnsyncedBytes, writer.syncCount, writer.syncErrorCount, writer.maxSyncTimeMs,
+        writer.writeErrorCount, writer.lostBytes);
+    printf("Writer preallocated:%llu steps:%u errors:%u avg:%ums max:%ums\n",
+        writer.preallocBytes, writer.preallocCount, writer.preallocErrorCount,
+        writer.preallocCount ? writer.totalPreallocMs / writer.preallocCount : 0, writer.maxPreallocMs);
+}
+
+/**
+ * @brief Block の Buffer を書き込みを待たずに Producer へ返す
+ */
+static void ReleaseEarly(LoggingDesc_t* desc)
+{
+    if (desc->callback != NULL) {
+        desc->callback(desc->ptr);
+        desc->callback = NULL;
+    }
+}
+
+static void AddIov(LoggingDesc_t* desc)
+{
+    Logging_main_t* self = GetInstance();
+
+    self->iovs[self->numIovs].iov_base = desc->ptr;
+    self->iovs[self->numIovs].iov_len  = desc->size;
+    self->iovDescs[self->numIovs]      = desc;
+    self->numIovs++;
+    self->batchSize += desc->size;
+}
+
+static void QueueWrite(LoggingDesc_t* desc)
+{
+    Logging_main_t* self = GetInstance();
+
+    /** @note Codec に取り込んだ Block は書き込みを待たずに Producer へ返す． */
+    if (self->isCompressEnabled && Logging_Compress_Add(desc) == OK) {
+        ReleaseEarly(desc);
+        return;
+    }
+    AddIov(desc);
+}
+
+/**
+ * @brief 書き込めなかった Block の Payload を記録する
+ */
+static void AddLost(const LoggingDesc_t* desc)
+{
+    Logging_main_t* self = GetInstance();
+    uint32_t size        = Logging_Buffer_GetPayloadSize(desc->ptr);
+
+    if (desc->user < LoggingUser_NUM) {
+        self->lostBytes[desc->user] += size;
+    }
+    self->totalLostBytes += size;
+}
+
+/**
+ * @brief 記録した失った Payload を同じ User の次の Block の overrun に加える
+ *
+ * @note overrun は CRC の対象のため加えた後に計算し直す．Block を失った後にだけ通る．
+ */
+static void CarryLost(LoggingDesc_t* desc)
+{
+    Logging_main_t* self = GetInstance();
+
+    if (desc->user >= LoggingUser_NUM || self->lostBytes[desc->user] == 0) {
+        return;
+    }
+
+    LogHeader_t* header = desc->ptr;
+    LogFooter_t* footer = (LogFooter_t *) ((uint8_t *) desc->ptr + header->size - sizeof(LogFooter_t));
+
+    header->overrun += self->lostBytes[desc->user];
+    self->lostBytes[desc->user] = 0;
+    Logging_Crc_Init();
+    footer->crc = Logging_Crc_ComputeBlock(desc->ptr);
+}
+
+/**
+ * @brief ASMP Worker に依頼した Block の結果を受け取る
+ *
+ * @note Worker が符号化した Block は Body が上書きされているため，Codec stream に追加できなければ失う．
+ *       Worker を停止できなかった Block は書き換えられる可能性があるため，書き込まず Producer へも返さない．
+ */
+static void CompleteOffload(LoggingDesc_t* desc)
+{
+    uint32_t encodedSize = 0;
+
+    switch (Logging_Offload_Wait(&encodedSize)) {
+        case Logging_OffloadResult_WITHHELD:
+            PRINT_ERROR("Offload failed, block withheld: user=%d\n", desc->user);
+            AddLost(desc);
+            desc->callback = NULL;
+            return;
+        case Logging_OffloadResult_DISCARDED:
+            PRINT_ERROR("Offload failed, block discarded: user=%d\n", desc->user);
+            AddLost(desc);
+            ReleaseEarly(desc);
+            return;
+        default:
+            break;
+    }
+
+    if (encodedSize > 0) {
+        if (Logging_Compress_AddEncoded(desc, encodedSize) != OK) {
+            PRINT_ERROR("Failed to add encoded block: user=%d\n", desc->user);
+            AddLost(desc);
+        }
+        ReleaseEarly(desc);
+        return;
+    }
+    AddIov(desc);
+}
+
+/**
+ * @brief 受信した Descriptor を処理する
+ *
+ * @note WRITE はバッチへ積むだけで，書き込みは FlushBatch() でまとめて行う．
+ *       共有メモリ上の Block は ASMP Worker に CRC (と圧縮) を依頼し，結果は FlushBatch() で受け取る．
+ */
+static void HandleDesc(LoggingDesc_t* desc)
+{
+    Logging_main_t* self = GetInstance();
+    int32_t count;
+
+    PRINT_DEBUG("Received message: %d, %d\n", desc->user, desc->size);
+    switch (desc->type) {
+        case LoggingType_WRITE:
+            if (desc->ptr == NULL || desc->size == 0) {
+                PRINT_ERROR("Invalid data received: ptr=%p, size=%d\n", desc->ptr, desc->size);
+                break;
+            }
+            PRINT_DEBUG("Writing data: type=%x user=%x ptr=%x size=%x callback=%p\n", desc->type, desc->user,
+                desc->ptr, desc->size, desc->callback);
+
+            CarryLost(desc);
+            if (Logging_Offload_Submit(desc, self->isCompressEnabled) == OK) {
+                self->isPending[desc - self->descs] = true;
+                self->numPending++;
+                break;
+            }
+            QueueWrite(desc);
+            break;
+        case LoggingType_SHUTDOWN:
+            self->isShutdown = true;
+        case LoggingType_END:
+            count = Logging_DecrementOpenCount();
+            PRINT_DEBUG("Open count decremented: %d, isShutdown=%d\n", count, self->isShutdown);
+            self->isStopped = count <= 0 && self->isShutdown;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief バッチを 1 回の writev で書き込み，完了後に Callback を呼ぶ
+ */
+static void FlushBatch(void)
+{
+    Logging_main_t* self = GetInstance();
+
+    for (uint32_t i = 0; i < self->numDescs; ++i) {
+        if (self->isPending[i]) {
+            CompleteOffload(&self->descs[i]);
+            self->isPending[i] = false;
+        }
+    }
+    self->numPending = 0;
+
+    /** @note 書き込めなかった Block も Buffer は返し，失った Payload を次の Block の overrun に残す． */
+    if (self->numIovs > 0 && Logging_Writer_WriteVector(self->iovs, self->numIovs) != OK) {
+        for (uint32_t i = 0; i < self->numIovs; ++i) {
+            AddLost(self->iovDescs[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < self->numDescs; ++i) {
+        if (self->descs[i].callback != NULL) {
+            self->descs[i].callback(self->descs[i].ptr);
+        }
+    }
+
+    self->numDescs  = 0;
+    self->numIovs   = 0;
+    self->batchSize = 0;
+}
+
 int main(int argc, char* argv[])
 {
     Logging_main_t* self = GetInstance();
 
+    Common_Sched_Apply(Common_SchedTask_LOGGING);
+
     struct stat info;
 
     /** @note SD カードのマウントを待ち合わせる */
@@ -47,51 +304,90 @@ int main(int argc, char* argv[])
         usleep(100000); // 100ms
     }
 
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "bench") == 0) {
+            return Logging_Writer_Benchmark(BENCHMARK_SIZE);
+        } else if (strcmp(argv[i], "compress") == 0) {
+            self->isCompressEnabled = true;
+        } else if (strcmp(argv[i], "trace") == 0) {
+            self->isTraceLogged = true;
+        } else if (strncmp(argv[i], "sync=", 5) == 0) {
+            if (ParseSyncPolicy(argv[i]) != OK) {
+                PRINT_ERROR("Invalid sync policy: %s\n", argv[i]);
+                return -1;
+            }
+        }
+    }
+
     int ret = Logging_Writer_Initialize();
     if (ret != OK) {
         PRINT_ERROR("Logging_Writer_Initialize failed: %d\n", ret);
         return -1;
     }
+    /** @note Logging_Writer_Initialize() が既定値に戻すため，その後で設定する． */
+    if (self->isSyncPolicySet && Logging_Writer_SetSyncPolicy(self->syncPolicy, self->syncThreshold) != OK) {
+        Logging_Writer_Close();
+        return -1;
+    }
+    Logging_Offload_Initialize();
     self->shutdownHandlerId = PowerCtrl_SetShutdownCallback(ShutdownNotify);
 
-    mqd_t mq = Logging_CreateQueue();
+    LoggingQueue_t mq = Logging_CreateQueue();
+    Logging_Trace_Start(self->isTraceLogged);
 
-    bool isStopped = false;
-    int32_t count;
-    while (isStopped == false) {
-        LoggingDesc_t desc;
-        int ret = mq_receive(mq, (FAR char *) &desc, sizeof(LoggingDesc_t), 0);
+    self->isStopped = false;
+    while (self->isStopped == false) {
+        /** @note 先頭の 1 件だけ待ち合わせ，残りは待たずに取り出してまとめて書き込む． */
+        ret = Logging_ReceiveQueue(mq, &self->descs[self->numDescs]);
         if (ret < 0) {
-            PRINT_ERROR("mq_receive err(errno:%d)\n", errno);
             return -1;
         }
-        PRINT_DEBUG("Received message: %d, %d\n", desc.user, desc.size);
-        switch (desc.type) {
-            case LoggingType_WRITE:
-                if (desc.ptr == NULL || desc.size == 0) {
-                    PRINT_ERROR("Invalid data received: ptr=%p, size=%d\n", desc.ptr, desc.size);
-                    continue;
-                }
-                PRINT_DEBUG("Writing data: type=%x user=%x ptr=%x size=%x callback=%p\n", desc.type, desc.user,
-                    desc.ptr, desc.size, desc.callback);
-
-                Logging_Writer_Write(desc.ptr, desc.size);
-                break;
-            case LoggingType_SHUTDOWN:
-                self->isShutdown = true;
-            case LoggingType_END:
-                count = Logging_DecrementOpenCount();
-                PRINT_DEBUG("Open count decremented: %d, isShutdown=%d\n", count, self->isShutdown);
-                isStopped = count <= 0 && self->isShutdown;
-                break;
-            default:
-                break;
-        }
-        if (desc.callback != NULL) {
-            desc.callback();
-        }
+        do {
+            HandleDesc(&self->descs[self->numDescs]);
+            self->numDescs++;
+        } while (self->numDescs < COALESCE_MAX_DESCS
+            && self->batchSize < COALESCE_MAX_BYTES
+            && self->numPending < LOGGING_OFFLOAD_MAX_JOBS
+            && Logging_TryReceiveQueue(mq, &self->descs[self->numDescs]) == OK);
+
+        FlushBatch();
+    }
+    Logging_Trace_Join();
+
+    Logging_QueueStatistics_t stats;
+    Logging_GetQueueStatistics(mq, &stats);
+    printf("Queue waits:%u\n", stats.waitCount);
+    for (int priority = 0; priority < LoggingPriority_NUM; ++priority) {
+        Logging_QueueClassStatistics_t* cls = &stats.classes[priority];
+        printf("Queue[%d] sent:%u full:%u timeout:%u max depth:%u overdue:%u latency avg:%lluus max:%lluus\n",
+            priority, cls->sendCount, cls->fullCount, cls->timeoutCount, cls->maxDepth, cls->overdueCount,
+            cls->receiveCount ? cls->totalLatency * 1000000 / 32768 / cls->receiveCount : 0,
+            cls->maxLatency * 1000000 / 32768);
     }
+
+    Logging_Offload_Statistics_t offload;
+    Logging_Offload_Finalize();
+    Logging_Offload_GetStatistics(&offload);
+    printf("Offload jobs:%u compressed:%u local crc:%u discarded:%u lost:%lluB throughput:%lluKB/s round trip avg:%lluus max:%lluus\n",
+        offload.jobCount, offload.compressedCount, offload.localCount, offload.discardedCount, self->totalLostBytes,
+        offload.totalRoundTrip ? offload.bytes * 32768 / 1024 / offload.totalRoundTrip : 0,
+        offload.jobCount ? offload.totalRoundTrip * 1000000 / 32768 / offload.jobCount : 0,
+        offload.maxRoundTrip * 1000000 / 32768);
+
+    if (self->isCompressEnabled) {
+        Logging_Compress_Statistics_t codec;
+
+        Logging_Compress_Flush();
+        Logging_Compress_GetStatistics(&codec);
+        printf("Codec frames:%u containers:%u raw:%llu encoded:%llu ratio:%llu%% speed:%lluKB/s errors:%u lost:%llu\n",
+            codec.frameCount, codec.containerCount, codec.rawBytes, codec.encodedBytes,
+            codec.rawBytes ? codec.encodedBytes * 100 / codec.rawBytes : 0,
+            codec.encodeTicks ? codec.rawBytes * 32768 / 1024 / codec.encodeTicks : 0,
+            codec.errorCount, codec.lostBytes);
+    }
+
     Logging_Writer_Close();
+    PrintWriterStatistics();
     PowerCtrl_NotifyStop(self->shutdownHandlerId);
     return 0;
 } /* main */
@@ -4,18 +4,33 @@
 #include <stdint.h>
 #include "Logging_public.h"
 
+typedef enum tagLogging_BufferOption_e {
+    Logging_BufferOption_CRC32C       = LOG_HEADER_FLAG_CRC32C,     /* Use CRC32C for the footer CRC */
+    Logging_BufferOption_COMPRESSED   = LOG_HEADER_FLAG_COMPRESSED, /* Body is a codec frame stream */
+    Logging_BufferOption_DEFERRED_CRC = 1 << 16,                    /* Compute the CRC once in Finalize */
+    Logging_BufferOption_OFFLOAD_CRC  = 1 << 17,                    /* Leave the CRC to the Logging task */
+} Logging_BufferOption_e;
+
 typedef struct tagLogging_Buffer_Desc_t {
     LogHeader_t* header;
     void*        body;
     LogFooter_t* footer;
+    uint32_t     options;
+    uint32_t     recordSize;
+    uint32_t     stream;
 } Logging_Buffer_Desc_t;
 
-void Logging_Buffer_Init(Logging_Buffer_Desc_t* desc, LoggingUser_e user, uint32_t seqId, void* buff,
-    uint32_t size);
+void Logging_Buffer_Init(Logging_Buffer_Desc_t* desc, LoggingUser_e user, uint32_t seqId, uint32_t overrun,
+    void* buff, uint32_t size);
+void     Logging_Buffer_SetOptions(Logging_Buffer_Desc_t* desc, uint32_t options);
+void     Logging_Buffer_SetRecordSize(Logging_Buffer_Desc_t* desc, uint32_t recordSize);
+void     Logging_Buffer_SetStream(Logging_Buffer_Desc_t* desc, uint32_t stream);
 bool     Logging_Buffer_Write(Logging_Buffer_Desc_t* desc, void* data, uint32_t size);
 void     Logging_Buffer_Update(Logging_Buffer_Desc_t* desc, uint32_t size);
 uint32_t Logging_Buffer_GetRemainingSize(Logging_Buffer_Desc_t* desc);
 void*    Logging_Buffer_GetNextPos(Logging_Buffer_Desc_t* desc);
+uint32_t Logging_Buffer_GetPayloadSize(const void* block);
+int      Logging_Buffer_Send(LoggingQueue_t mq, LoggingDesc_t* desc, uint32_t* overrun);
 void     Logging_Buffer_Finalize(Logging_Buffer_Desc_t* desc);
 
 #endif /* LOGGING_BUFFER_PUBLIC_H */
@@ -0,0 +1,8 @@
+#ifndef LOGGING_OFFLOAD_PUBLIC_H
+#define LOGGING_OFFLOAD_PUBLIC_H
+
+#include <stdint.h>
+
+void* Logging_Offload_AllocateBuffers(uint32_t size);
+
+#endif /* LOGGING_OFFLOAD_PUBLIC_H */
@@ -0,0 +1,30 @@
+#ifndef LOGGING_POOL_PUBLIC_H
+#define LOGGING_POOL_PUBLIC_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define LOGGING_POOL_MAX_BUFFERS (32)
+
+typedef struct tagLogging_Pool_Statistics_t {
+    uint32_t acquireCount;
+    uint32_t overrunCount; /* Acquire attempts that found no free buffer */
+    uint32_t inUse;
+    uint32_t maxInUse;     /* High-water mark of buffers owned by the producer or the writer */
+} Logging_Pool_Statistics_t;
+
+typedef struct tagLogging_Pool_t {
+    pthread_mutex_t           mutex;
+    uint8_t*                  buffers;
+    uint32_t                  bufferSize;
+    uint32_t                  numBuffers;
+    uint32_t                  freeBitmap;
+    Logging_Pool_Statistics_t stats;
+} Logging_Pool_t;
+
+int   Logging_Pool_Init(Logging_Pool_t* pool, void* buffers, uint32_t bufferSize, uint32_t numBuffers);
+void* Logging_Pool_Acquire(Logging_Pool_t* pool);
+void  Logging_Pool_Release(Logging_Pool_t* pool, void* buffer);
+void  Logging_Pool_GetStatistics(Logging_Pool_t* pool, Logging_Pool_Statistics_t* stats);
+
+#endif /* LOGGING_POOL_PUBLIC_H */
@@ -1,17 +1,37 @@
 #ifndef LOGGING_PUBLIC_H
 #define LOGGING_PUBLIC_H
 
-#include <mqueue.h>
 #include <stdbool.h>
 #include <stdint.h>
 
-typedef void (*LoggingCallback_t)(void);
+/**
+ * @note SDIO の DMA が Bounce buffer や部分セクタの Read-modify-write を使わないよう，
+ *       ログ Buffer はセクタ境界に配置し，サイズはクラスタの整数倍とする．
+ *       全ての書き込みが Buffer 単位なので，ファイル上のオフセットも常にクラスタ境界になる．
+ */
+#define LOGGING_BUFFER_ALIGNMENT (512)
+#define LOGGING_CLUSTER_SIZE     (32 * 1024)
+#define LOGGING_BUFFER_ALIGNED   __attribute__((aligned(LOGGING_BUFFER_ALIGNMENT)))
+
+/**
+ * @note Writer が ptr の書き込みを完了した後に呼ばれる．Producer はここで Buffer の所有権を取り戻す．
+ */
+typedef void (*LoggingCallback_t)(void* ptr);
 
 typedef enum tagLoggingUser_e {
     LoggingUser_IMU,
     LoggingUser_GNSS,
     LoggingUser_SYNCHRONIZE,
     LoggingUser_POWER,
+    LoggingUser_COMPRESSED,     /* Codec container written by the Logging task itself */
+    LoggingUser_IMU_PACKED,     /* IMU samples in fixed point, see Imu_Packed_public.h */
+    LoggingUser_IMU_DIAGNOSTIC, /* IMU acquisition diagnostics, see Imu_Diagnostic_public.h */
+    LoggingUser_IMU_DECIMATED_0, /* Low-rate IMU streams, same record as LoggingUser_IMU */
+    LoggingUser_IMU_DECIMATED_1,
+    LoggingUser_TRACE,          /* Common_TraceRecord_t records drained by the Logging task */
+    LoggingUser_GNSS_PVTLOG,    /* struct cxd56_pvtlog_data_s records read in GNSS batch mode */
+    LoggingUser_GNSS_COMPACT,   /* Delta-coded GNSS records, see Gnss_Compact_public.h */
+    LoggingUser_NUM,
 } LoggingUser_e;
 
 typedef enum tagLoggingType_e {
@@ -29,11 +49,19 @@ typedef struct tagLoggingDesc_t {
     LoggingCallback_t callback;
 } LoggingDesc_t;
 
+#define LOG_HEADER_FLAG_CRC32C     (1U << 0) /* Footer CRC uses CRC32C instead of CRC-32 */
+#define LOG_HEADER_FLAG_COMPRESSED (1U << 1) /* Body is a codec frame stream, see LogCodecFrame_t */
+#define LOG_HEADER_FLAG_MASK       (0xFFFF)
+
 typedef struct tagLogHeader_t {
     LoggingUser_e user  : 8;
     uint32_t      seqId : 24;
     uint32_t      size;
     uint64_t      time;
+    uint32_t      overrun; /* Payload bytes the producer discarded since the previous block (no free buffer) */
+    uint32_t      flags;      /* LOG_HEADER_FLAG_* */
+    uint32_t      recordSize; /* Fixed record size of the body in bytes, 0 if variable */
+    uint32_t      stream;     /* Producer instance of the user, e.g. the IMU device index */
 } LogHeader_t;
 
 typedef struct tagLogFooter_t {
@@ -42,9 +70,24 @@ typedef struct tagLogFooter_t {
     uint32_t crc;
 } LogFooter_t;
 
-mqd_t Logging_OpenQueue(bool isIncrementOpenCount);
-void  Logging_CloseQueue(mqd_t mq);
-int   Logging_SendQueue(mqd_t mq, LoggingDesc_t* desc);
-int   Logging_ReceiveQueue(mqd_t mq, LoggingDesc_t* desc);
+/**
+ * @note LOG_HEADER_FLAG_COMPRESSED の Block の Body は，先頭 Frame の位置 (uint32_t) に続く Frame の列．
+ *       位置は Body 先頭の uint32_t の直後からのオフセットで，Frame の開始が無い場合は LOG_CODEC_NO_FRAME．
+ *       Frame は元の Header と Footer の後に Record 毎の符号と端数バイトが続き，Block を跨ぐことがある．
+ *       元の Footer の CRC を持つため，展開後に元の Block を復元して検証できる．
+ */
+#define LOG_CODEC_NO_FRAME (0xFFFFFFFF)
+
+typedef struct tagLogCodecFrame_t {
+    LogHeader_t header; /* Original block header */
+    LogFooter_t footer; /* Original block footer, crc covers the original block */
+} LogCodecFrame_t;
+
+typedef struct tagLogging_Queue_t* LoggingQueue_t;
+
+LoggingQueue_t Logging_OpenQueue(bool isIncrementOpenCount);
+void           Logging_CloseQueue(LoggingQueue_t queue);
+int            Logging_SendQueue(LoggingQueue_t queue, LoggingDesc_t* desc);
+int            Logging_ReceiveQueue(LoggingQueue_t queue, LoggingDesc_t* desc);
 
 #endif /* LOGGING_PUBLIC_H */
@@ -0,0 +1,55 @@
+#include <stdint.h>
+
+#include <asmp/mpmq.h>
+#include <asmp/types.h>
+
+#include "asmp.h"
+
+#include "Logging_Codec.h"
+#include "Logging_Crc.h"
+#include "Logging_Offload.h"
+
+/**
+ * @brief Logging タスクから受け取った Block の CRC を計算し，必要であれば Body をその場で符号化する
+ *
+ * @note CRC は元の Block に対して求めるため，符号化より先に計算する．
+ *
+ * @return 符号化後のサイズ，符号化しなかった場合は 0
+ */
+static uint32_t Process(uint8_t* block, int msgid)
+{
+    LogHeader_t* header = (LogHeader_t *) block;
+    LogFooter_t* footer = (LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+
+    if (msgid & LOGGING_OFFLOAD_MSG_CRC) {
+        footer->crc = Logging_Crc_ComputeBlock(block);
+    }
+    if ((msgid & LOGGING_OFFLOAD_MSG_COMPRESS) && header->recordSize != 0) {
+        return Logging_Codec_EncodeInPlace(header->recordSize, block + sizeof(LogHeader_t), footer->size);
+    }
+    return 0;
+}
+
+int main(void)
+{
+    mpmq_t mq;
+    uint32_t data;
+
+    if (mpmq_init(&mq, LOGGING_OFFLOAD_KEY_MQ, LOGGING_OFFLOAD_MAIN_CPUID) != 0) {
+        wk_abort();
+    }
+    Logging_Crc_Init();
+
+    for (;;) {
+        int msgid = mpmq_receive(&mq, &data);
+        if (msgid < 0) {
+            continue;
+        }
+        if (msgid == LOGGING_OFFLOAD_MSG_EXIT) {
+            break;
+        }
+        mpmq_send(&mq, LOGGING_OFFLOAD_MSG_DONE, Process((uint8_t *) (uintptr_t) data, msgid));
+    }
+
+    return 0;
+} /* main */
@@ -6,6 +6,8 @@
 #include <nuttx/config.h>
 
 #include "Common_DebugPrint.h"
+#include "Common_Ring.h"
+#include "Common_Sched.h"
 #include "PowerCtrl.h"
 
 /* MACROS */
@@ -17,6 +19,8 @@
 #define PWR_MODE    PIN_SPI2_MISO
 #define SD_EN       PIN_SPI2_MOSI
 
+#define EVENT_RING_SIZE (8)
+
 /* TYPES */
 
 typedef enum tagPowerButton_e {
@@ -29,16 +33,23 @@ typedef enum tagPowerSource_e {
     PowerSource_USB,
 } PowerSource_e;
 
+/** @note 割り込み時の POWER_SW ピンの状態 */
+typedef struct tagPowerCtrl_Event_t {
+    uint32_t level;
+} PowerCtrl_Event_t;
+
 typedef struct tagPowerCtrl_main_t {
-    PowerButton_e state;
-    PowerSource_e source;
-    sem_t         smph;
+    PowerButton_e     state;
+    PowerSource_e     source;
+    Common_Ring_t     ring;
+    PowerCtrl_Event_t events[EVENT_RING_SIZE];
 } PowerCtrl_main_t;
 
 /* PROTOTYPES */
 
 static PowerCtrl_main_t* GetInstance(void);
 static int               HandleGpioInterrupt(int irq, FAR void* context, FAR void* arg);
+static int               Receive(int32_t timeoutMs);
 static int               Delay(uint32_t duration);
 static int               Wait(void);
 static int               Check1(void);
@@ -70,35 +81,49 @@ static int HandleGpioInterrupt(int irq, FAR void* context, FAR void* arg)
 {
     PowerCtrl_main_t* self = GetInstance();
     uint32_t pin = (uint32_t) (uintptr_t) arg;
+    PowerCtrl_Event_t event = { .level = board_gpio_read(pin) };
 
-    PRINT_DEBUG("POWER_SW pin %x %d", pin, board_gpio_read(pin));
     cxd56_gpioint_invert(pin);
-    sem_post(&self->smph);
+    Common_Ring_Push(&self->ring, &event);
 
     return OK;
 }
 
+/**
+ * @brief 割り込みを 1 つ受け取る
+ *
+ * @note ボタンの状態は割り込み時のピンのレベルから決める (High で OFF，Low で ON)．
+ *       割り込み毎に反転させると，Ring が溢れて取りこぼした場合に状態が逆のままになる．
+ *
+ * @retval OK    割り込みが発生した
+ * @retval ERROR 指定した期間が経過した
+ */
+static int Receive(int32_t timeoutMs)
+{
+    PowerCtrl_main_t* self = GetInstance();
+    PowerCtrl_Event_t event;
+
+    if (!Common_Ring_Wait(&self->ring, timeoutMs) || !Common_Ring_Pop(&self->ring, &event)) {
+        return ERROR;
+    }
+    PRINT_DEBUG("POWER_SW pin %x %u", POWER_SW, event.level);
+    self->state = event.level ? PowerButton_OFF : PowerButton_ON;
+    return OK;
+}
+
 /**
  * @brief Delay
  *
  * @note 割り込みが発生するか，指定した期間が経過するまで待機する．
  *
- * @param duration Ticks to wait
+ * @param duration Milliseconds to wait
  *
  * @retval OK    指定した期間が経過した
  * @retval ERROR 割り込みが発生した
  */
 static int Delay(uint32_t duration)
 {
-    PowerCtrl_main_t* self = GetInstance();
-    int ret;
-
-    ret = nxsem_tickwait(&self->smph, duration);
-    if (ret == OK) {
-        self->state ^= 1;
-        return ERROR;
-    }
-    return OK;
+    return Receive(duration) == OK ? ERROR : OK;
 }
 
 /**
@@ -111,13 +136,7 @@ static int Delay(uint32_t duration)
  */
 static int Wait(void)
 {
-    PowerCtrl_main_t* self = GetInstance();
-    int ret = sem_wait(&self->smph);
-
-    if (ret == OK) {
-        self->state ^= 1;
-    }
-    return ret;
+    return Receive(COMMON_RING_WAIT_FOREVER);
 }
 
 /**
@@ -135,7 +154,7 @@ static int Check1(void)
     for (uint32_t i = 0; i < 10; ++i) {
         for (uint32_t led = GPIO_LED1; led <= GPIO_LED4; ++led) {
             board_gpio_write(led, 1);
-            ret = Delay(MSEC2TICK(100));
+            ret = Delay(100);
             board_gpio_write(led, 0);
             if (ret == ERROR) {
                 break;
@@ -162,7 +181,7 @@ static void Check2(void)
         for (uint32_t led = GPIO_LED1; led <= GPIO_LED4; ++led) {
             board_gpio_write(led, i % 2);
         }
-        int ret = Delay(MSEC2TICK(100));
+        int ret = Delay(100);
         if (ret == ERROR) {
             break;
         }
@@ -242,8 +261,7 @@ static void InitInterrupt(void)
 {
     PowerCtrl_main_t* self = GetInstance();
 
-    sem_init(&self->smph, 0, 0);
-    sem_setprotocol(&self->smph, SEM_PRIO_NONE);
+    Common_Ring_Init(&self->ring, self->events, sizeof(self->events[0]), EVENT_RING_SIZE);
 
     self->state = PowerButton_ON;
     board_gpio_config(POWER_SW, 0, true, false, PIN_FLOAT);
@@ -285,6 +303,8 @@ static void WatchPowerButton(void)
 
 int main(int argc, char* argv[])
 {
+    Common_Sched_Apply(Common_SchedTask_POWERCTRL);
+    Common_Sched_Print();
     InitLed();
     InitInterrupt();
     int ret = ActivatePower();
@@ -0,0 +1,226 @@
+/**
+ * @file CrcBench.c
+ * @brief Logging_Crc (Slice-by-8) をビット毎，バイト毎のテーブル参照と比べて検証し，速度を計測するツール
+ *
+ * @note ビルド:
+ *       gcc -O2 -I../../Logging -I../../Logging/include -I../../Common/include -o crcbench CrcBench.c ../../Logging/Logging_Crc.c -lpthread
+ *
+ *       使い方:
+ *       crcbench [size] [MHz]
+ *         CRC-32 と CRC-32C それぞれについて，既知のテストベクタ ("123456789") と一致すること，
+ *         長さと先頭位置を変えた乱数データで 3 つの実装の結果が一致することを確認する．
+ *         その後 size バイトのバッファで 1 バイトあたりの処理時間を表示する．
+ *         MHz に実行した CPU の周波数 (Spresense は 156) を指定すると，換算した cycles/byte も表示する．
+ *         検証に失敗した場合は 1 を返す．
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Logging_Crc.h"
+
+#define DEFAULT_SIZE     (16 * 1024)
+#define BENCH_BYTES      (64 * 1024 * 1024)
+#define CHECK_MAX_LENGTH (300)
+#define CHECK_OFFSETS    (8)
+
+typedef uint32_t (*CrcBench_Update_t)(Logging_Crc_e type, uint32_t crc, const void* data, uint32_t size);
+
+typedef struct tagCrcBench_Method_t {
+    const char*       name;
+    CrcBench_Update_t update;
+} CrcBench_Method_t;
+
+static const char* crcBench_names[Logging_Crc_NUM] = {
+    [Logging_Crc_CRC32]  = "CRC-32",
+    [Logging_Crc_CRC32C] = "CRC-32C",
+};
+
+static const uint32_t crcBench_polynomial[Logging_Crc_NUM] = {
+    [Logging_Crc_CRC32]  = 0xEDB88320,
+    [Logging_Crc_CRC32C] = 0x82F63B78,
+};
+
+/** @note "123456789" に対する各 CRC の標準的なチェック値 */
+static const uint32_t crcBench_check[Logging_Crc_NUM] = {
+    [Logging_Crc_CRC32]  = 0xCBF43926,
+    [Logging_Crc_CRC32C] = 0xE3069283,
+};
+
+static uint32_t crcBench_table[Logging_Crc_NUM][256];
+
+static double GetTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 1 ビットずつ多項式で割る基準実装
+ */
+static uint32_t UpdateBitwise(Logging_Crc_e type, uint32_t crc, const void* data, uint32_t size)
+{
+    const uint8_t* ptr = data;
+
+    while (size-- > 0) {
+        crc ^= *ptr++;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ crcBench_polynomial[type] : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief 1 バイト毎に 256 要素のテーブルを引く実装 (Slice-by-8 導入前の方式)
+ */
+static uint32_t UpdateTable(Logging_Crc_e type, uint32_t crc, const void* data, uint32_t size)
+{
+    const uint32_t* table = crcBench_table[type];
+    const uint8_t* ptr    = data;
+
+    while (size-- > 0) {
+        crc = table[(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static const CrcBench_Method_t crcBench_methods[] = {
+    { "bitwise",     UpdateBitwise      },
+    { "table",       UpdateTable        },
+    { "slice-by-8",  Logging_Crc_Update },
+};
+
+#define NUM_METHODS (sizeof(crcBench_methods) / sizeof(crcBench_methods[0]))
+
+static void InitTable(void)
+{
+    for (int type = 0; type < Logging_Crc_NUM; ++type) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint8_t byte = (uint8_t) i;
+            crcBench_table[type][i] = UpdateBitwise(type, 0, &byte, 1);
+        }
+    }
+}
+
+static uint32_t Compute(const CrcBench_Method_t* method, Logging_Crc_e type, const void* data, uint32_t size)
+{
+    return ~method->update(type, 0xFFFFFFFF, data, size);
+}
+
+/**
+ * @brief テストベクタと，長さ・先頭位置・分割位置を変えた場合の一致を確認する
+ *
+ * @note Slice-by-8 は先頭の 4 バイト境界合わせと末尾の端数を別に処理するため，
+ *       全ての組み合わせを基準実装と比べる．
+ */
+static bool Verify(Logging_Crc_e type)
+{
+    static uint8_t data[CHECK_MAX_LENGTH + CHECK_OFFSETS];
+    bool isOk = true;
+
+    for (uint32_t n = 0; n < NUM_METHODS; ++n) {
+        uint32_t crc = Compute(&crcBench_methods[n], type, "123456789", 9);
+        if (crc != crcBench_check[type]) {
+            printf("%s %s: check %08X, expected %08X\n",
+                   crcBench_names[type], crcBench_methods[n].name, crc, crcBench_check[type]);
+            isOk = false;
+        }
+    }
+
+    srand(1);
+    for (uint32_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t) rand();
+    }
+    for (uint32_t offset = 0; offset < CHECK_OFFSETS; ++offset) {
+        for (uint32_t length = 0; length <= CHECK_MAX_LENGTH; ++length) {
+            const uint8_t* ptr = &data[offset];
+            uint32_t expected  = Compute(&crcBench_methods[0], type, ptr, length);
+
+            for (uint32_t n = 1; n < NUM_METHODS; ++n) {
+                const CrcBench_Method_t* method = &crcBench_methods[n];
+                uint32_t split = length / 3;
+                uint32_t whole = Compute(method, type, ptr, length);
+                uint32_t part  = method->update(type, 0xFFFFFFFF, ptr, split);
+
+                part = ~method->update(type, part, ptr + split, length - split);
+                if (whole != expected || part != expected) {
+                    printf("%s %s: offset %u length %u: %08X/%08X, expected %08X\n",
+                           crcBench_names[type], method->name, offset, length, whole, part, expected);
+                    isOk = false;
+                }
+            }
+        }
+    }
+    return isOk;
+}
+
+/**
+ * @return 1 バイトあたりの処理時間 [ns]
+ */
+static double Benchmark(const CrcBench_Method_t* method, Logging_Crc_e type, uint8_t* data, uint32_t size)
+{
+    /** @note ビット毎の実装は遅いため，同程度の時間で終わるよう処理量を減らす． */
+    uint32_t total  = (method->update == UpdateBitwise) ? BENCH_BYTES / 16 : BENCH_BYTES;
+    uint32_t rounds = (total + size - 1) / size;
+    volatile uint32_t sink = 0;
+
+    double start = GetTimeSec();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        /** @note 毎回データを変え，同じ計算がループの外へ出されないようにする． */
+        data[r % size] ^= 1;
+        sink ^= Compute(method, type, data, size);
+    }
+    double elapsed = GetTimeSec() - start;
+    (void) sink;
+
+    return elapsed * 1e9 / ((double) rounds * size);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t size = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : DEFAULT_SIZE;
+    double mhz    = (argc > 2) ? strtod(argv[2], NULL) : 0;
+    bool isOk     = true;
+
+    if (size == 0) {
+        printf("Usage: %s [size] [MHz]\n", argv[0]);
+        return 1;
+    }
+
+    Logging_Crc_Init();
+    InitTable();
+
+    uint8_t* data = malloc(size);
+    if (data == NULL) {
+        printf("Failed to allocate %u bytes\n", size);
+        return 1;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        data[i] = (uint8_t) (i * 131 + 7);
+    }
+
+    for (int type = 0; type < Logging_Crc_NUM; ++type) {
+        bool isVerified = Verify(type);
+
+        printf("%s: %s\n", crcBench_names[type], isVerified ? "OK" : "NG");
+        isOk = isOk && isVerified;
+        for (uint32_t n = 0; n < NUM_METHODS; ++n) {
+            double ns = Benchmark(&crcBench_methods[n], type, data, size);
+
+            if (mhz > 0) {
+                printf("  %-10s %8.3f ns/byte %8.3f cycles/byte (at %.0f MHz)\n",
+                       crcBench_methods[n].name, ns, ns * mhz / 1e3, mhz);
+            } else {
+                printf("  %-10s %8.3f ns/byte %8.1f MB/s\n", crcBench_methods[n].name, ns, 1e3 / ns);
+            }
+        }
+    }
+
+    free(data);
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file FirBench.c
+ * @brief IMU の間引きフィルタ (Imu_Fir) をホストで検証し，速度を計測するツール
+ *
+ * @note ビルド:
+ *       gcc -O2 -I../../Imu -o firbench FirBench.c ../../Imu/Imu_Fir.c -lm
+ *
+ *       使い方:
+ *       firbench [input rate] [factor...]
+ *         間引き率毎に DC 利得，通過域 (出力レートの 0.4 倍まで) のリップル，
+ *         阻止域 (出力レートの 0.6 倍以上) の減衰量と，1 入力サンプルあたりの処理時間を表示する．
+ *         特性が仕様を満たさない場合は 1 を返す．
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Imu_Fir.h"
+
+#define PI                  (3.14159265358979323846)
+#define PASSBAND_RIPPLE_DB  (0.1)
+#define STOPBAND_ATTEN_DB   (60.0)
+#define RESPONSE_POINTS     (200)
+#define BENCH_INPUT_SAMPLES (1920 * 60)
+
+static Imu_Fir_t firBench_fir;
+
+static double GetTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 正弦波を通し，定常状態の出力振幅を求める
+ *
+ * @param freq 入力レートで正規化した周波数
+ */
+static double MeasureGain(uint32_t factor, double freq)
+{
+    Imu_Fir_t* fir = &firBench_fir;
+    float in[IMU_FIR_CHANNELS];
+    float out[IMU_FIR_CHANNELS];
+    double peak = 0;
+
+    Imu_Fir_Init(fir, factor);
+    uint32_t settle = fir->taps * 2;
+    uint32_t length = settle + (uint32_t) (4 / freq) + factor * 64;
+
+    for (uint32_t n = 0; n < length; ++n) {
+        /** @note 偶数 ch に cos，奇数 ch に sin を入れ，組の二乗和から振幅を求める． */
+        for (int ch = 0; ch < IMU_FIR_CHANNELS; ch += 2) {
+            in[ch]     = (float) cos(2 * PI * freq * n + ch);
+            in[ch + 1] = (float) sin(2 * PI * freq * n + ch);
+        }
+        if (Imu_Fir_Process(fir, in, out) && n >= settle) {
+            for (int ch = 0; ch < IMU_FIR_CHANNELS; ch += 2) {
+                double amplitude = sqrt((double) out[ch] * out[ch] + (double) out[ch + 1] * out[ch + 1]);
+                peak = amplitude > peak ? amplitude : peak;
+            }
+        }
+    }
+    return peak;
+}
+
+static double Benchmark(uint32_t factor)
+{
+    Imu_Fir_t* fir = &firBench_fir;
+    float in[IMU_FIR_CHANNELS] = { 0 };
+    float out[IMU_FIR_CHANNELS];
+    volatile float sink = 0;
+
+    Imu_Fir_Init(fir, factor);
+    double start = GetTimeSec();
+    for (uint32_t n = 0; n < BENCH_INPUT_SAMPLES; ++n) {
+        in[n % IMU_FIR_CHANNELS] = (float) (n & 0xFF);
+        if (Imu_Fir_Process(fir, in, out)) {
+            sink += out[0];
+        }
+    }
+    return (GetTimeSec() - start) / BENCH_INPUT_SAMPLES;
+}
+
+static bool Evaluate(double inputRate, uint32_t factor)
+{
+    double outputRate = inputRate / factor;
+    double dcGain     = MeasureGain(factor, 0.5 / BENCH_INPUT_SAMPLES);
+    double passMin    = INFINITY;
+    double passMax    = 0;
+    double stopMax    = 0;
+
+    for (int i = 1; i <= RESPONSE_POINTS; ++i) {
+        double freq = 0.4 / factor * i / RESPONSE_POINTS;
+        double gain = MeasureGain(factor, freq);
+        passMin = gain < passMin ? gain : passMin;
+        passMax = gain > passMax ? gain : passMax;
+    }
+    for (int i = 0; i <= RESPONSE_POINTS; ++i) {
+        double freq = 0.6 / factor + (0.5 - 0.6 / factor) * i / RESPONSE_POINTS;
+        double gain = MeasureGain(factor, freq);
+        stopMax = gain > stopMax ? gain : stopMax;
+    }
+
+    double rippleDb = 20 * log10(passMax / passMin);
+    double attenDb  = -20 * log10(stopMax);
+    double usPerIn  = Benchmark(factor) * 1e6;
+    bool isOk       = fabs(dcGain - 1) < 1e-3 && rippleDb < PASSBAND_RIPPLE_DB && attenDb > STOPBAND_ATTEN_DB;
+
+    printf("factor:%2u out:%7.2fHz taps:%3u dc:%.5f ripple:%.4fdB atten:%.1fdB %.3fus/sample (%.3f%% CPU at %.0fHz) %s\n",
+        factor, outputRate, IMU_FIR_TAPS_PER_FACTOR * factor + 1, dcGain, rippleDb, attenDb, usPerIn,
+        usPerIn * inputRate / 1e4, inputRate, isOk ? "OK" : "NG");
+    return isOk;
+}
+
+int main(int argc, char* argv[])
+{
+    double inputRate = argc > 1 ? atof(argv[1]) : 1920;
+    bool isOk        = true;
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; ++i) {
+            isOk &= Evaluate(inputRate, atoi(argv[i]));
+        }
+    } else {
+        for (uint32_t factor = 2; factor <= IMU_FIR_MAX_FACTOR; factor *= 2) {
+            isOk &= Evaluate(inputRate, factor);
+        }
+        isOk &= Evaluate(inputRate, 10);
+        isOk &= Evaluate(inputRate, IMU_FIR_MAX_FACTOR);
+    }
+
+    return isOk ? 0 : 1;
+}
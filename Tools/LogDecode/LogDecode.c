@@ -0,0 +1,622 @@
+/**
+ * @file LogDecode.c
+ * @brief ログファイルを検証し，圧縮 Block を元の Block に展開するホスト用ツール
+ *
+ * @note ビルド:
+ *       gcc -O2 -I../../Logging -I../../Logging/include -I../../Imu/include -I../../Common/include -I../../Gnss \
+ *           -I../../Gnss/include -o logdecode LogDecode.c ../../Logging/Logging_Codec.c ../../Logging/Logging_Crc.c \
+ *           ../../Common/Common_TraceFormat.c ../../Gnss/Gnss_Compact.c -lpthread
+ *
+ *       使い方:
+ *       logdecode [-b] [-d] [-t] [-s] [-u imu.csv] [-g gnss.bin] <input> [output]
+ *         output を指定すると，圧縮 Block を展開した非圧縮のログを書き出す．
+ *         -b を指定すると，Record を持つ Block で Codec の圧縮率と速度を計測する．
+ *         -d を指定すると，IMU の診断 Record を表示する．
+ *         -t を指定すると，Logging タスクが記録した Trace (LoggingUser_TRACE) を書式化して表示する．
+ *         -s を指定すると，PPS から推定した RTC と GPS 時刻の対応 (LoggingUser_SYNCHRONIZE) を表示し，
+ *            以降の Block の LogHeader_t.time を直前の推定で GPS 時刻に換算して表示する．
+ *         -u を指定すると，IMU のサンプルを物理量に戻して CSV に書き出す．固定小数点の Block も同じ形式になる．
+ *            device は Block の LogHeader_t.stream で，複数の IMU のサンプルを区別する．
+ *         -g を指定すると，差分で符号化した GNSS の Block (LoggingUser_GNSS_COMPACT) から元の Record を復元し，
+ *            Record (GnssPositionData_t または struct cxd56_pvtlog_data_s) をそのまま連結して書き出す．
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Common_Trace.h"
+#include "Gnss_Compact.h"
+#include "Gnss_Sync_public.h"
+#include "Imu_Diagnostic_public.h"
+#include "Imu_Packed_public.h"
+#include "Logging_Codec.h"
+#include "Logging_Crc.h"
+#include "Logging_public.h"
+
+/** @note cxd5602pwbimu_data_t と同じ配置 */
+typedef struct tagLogDecode_ImuRecord_t {
+    uint32_t timestamp;
+    float    temp;
+    float    gx, gy, gz;
+    float    ax, ay, az;
+} LogDecode_ImuRecord_t;
+
+typedef struct tagLogDecode_Statistics_t {
+    uint32_t blockCount;
+    uint32_t crcErrorCount;
+    uint32_t containerCount;
+    uint32_t containerGapCount;
+    uint32_t frameCount;
+    uint32_t frameErrorCount;
+    uint32_t imuSampleCount;
+    uint32_t gnssRecordCount;
+    uint32_t gnssErrorCount;
+    uint64_t gnssRawBytes;
+    uint64_t gnssEncodedBytes;
+    uint64_t benchRawBytes;
+    uint64_t benchEncodedBytes;
+    double   benchEncodeSec;
+    double   benchDecodeSec;
+} LogDecode_Statistics_t;
+
+typedef struct tagLogDecode_t {
+    FILE*                  output;
+    FILE*                  imuOutput;
+    FILE*                  gnssOutput;
+    bool                   isBenchmark;
+    bool                   isDiagnostic;
+    bool                   isTrace;
+    bool                   isSync;
+    bool                   hasSyncRecord;
+    GnssSync_Record_t      syncRecord; /* Latest RTC to GPS time model */
+    bool                   hasContainer;
+    uint32_t               nextContainerSeqId;
+    uint8_t*               stream; /* Codec stream bytes not yet decoded */
+    uint32_t               streamSize;
+    uint32_t               streamCapacity;
+    LogDecode_Statistics_t stats;
+    Gnss_Compact_State_t   gnssState;
+} LogDecode_t;
+
+static LogDecode_t logDecode_instance;
+
+static LogDecode_t* GetInstance(void)
+{
+    return &logDecode_instance;
+}
+
+static double GetTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool VerifyCrc(const uint8_t* block)
+{
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+
+    if (footer->size > header->size - sizeof(LogHeader_t) - sizeof(LogFooter_t)) {
+        return false;
+    }
+    return Logging_Crc_ComputeBlock(block) == footer->crc;
+}
+
+static void Benchmark(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    uint32_t capacity         = footer->size + footer->size / 8 + LOGGING_CODEC_MAX_ENCODED_BYTES;
+    uint8_t* encoded          = malloc(capacity);
+    uint8_t* decoded          = malloc(footer->size + 1);
+
+    double start    = GetTimeSec();
+    uint32_t length = Logging_Codec_Encode(header->recordSize, body, footer->size, encoded, capacity);
+    double middle   = GetTimeSec();
+    int32_t ret     = Logging_Codec_Decode(header->recordSize, encoded, length, decoded, footer->size);
+    double end      = GetTimeSec();
+
+    if (length == 0 || ret != (int32_t) length || memcmp(body, decoded, footer->size) != 0) {
+        fprintf(stderr, "Codec round trip mismatch: user=%u seqId=%u\n", header->user, header->seqId);
+    } else {
+        self->stats.benchRawBytes     += footer->size;
+        self->stats.benchEncodedBytes += length;
+        self->stats.benchEncodeSec    += middle - start;
+        self->stats.benchDecodeSec    += end - middle;
+    }
+
+    free(encoded);
+    free(decoded);
+}
+
+static void WriteImuSample(const LogHeader_t* header, uint32_t timestamp, float temp, const float gyro[3],
+    const float accel[3])
+{
+    LogDecode_t* self = GetInstance();
+
+    fprintf(self->imuOutput, "%u,%u,%u,%.2f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+        header->user, header->stream, timestamp, temp, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+    self->stats.imuSampleCount++;
+}
+
+/**
+ * @brief IMU の Block のサンプルを物理量で書き出す
+ *
+ * @note 固定小数点の Block は Format の Scale を掛けて戻す．温度は Block 先頭のサンプルの値になる．
+ *       間引いたストリームも同じ形式で，user 列で区別する．
+ */
+static void ExportImu(const uint8_t* block)
+{
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    float gyro[3];
+    float accel[3];
+
+    bool isFloat = header->user == LoggingUser_IMU || header->user == LoggingUser_IMU_DECIMATED_0
+        || header->user == LoggingUser_IMU_DECIMATED_1;
+
+    if (isFloat && header->recordSize == sizeof(LogDecode_ImuRecord_t)) {
+        for (uint32_t pos = 0; pos + sizeof(LogDecode_ImuRecord_t) <= footer->size; pos += sizeof(LogDecode_ImuRecord_t)) {
+            LogDecode_ImuRecord_t record;
+
+            memcpy(&record, body + pos, sizeof(record));
+            gyro[0]  = record.gx;
+            gyro[1]  = record.gy;
+            gyro[2]  = record.gz;
+            accel[0] = record.ax;
+            accel[1] = record.ay;
+            accel[2] = record.az;
+            WriteImuSample(header, record.timestamp, record.temp, gyro, accel);
+        }
+    } else if (header->user == LoggingUser_IMU_PACKED && header->recordSize == sizeof(ImuPackedRecord_t)
+        && footer->size >= sizeof(ImuPackedFormat_t)) {
+        ImuPackedFormat_t format;
+
+        memcpy(&format, body, sizeof(format));
+        for (uint32_t pos = sizeof(format); pos + sizeof(ImuPackedRecord_t) <= footer->size;
+            pos += sizeof(ImuPackedRecord_t)) {
+            ImuPackedRecord_t record;
+
+            memcpy(&record, body + pos, sizeof(record));
+            for (int axis = 0; axis < 3; ++axis) {
+                gyro[axis]  = record.gyro[axis] * format.gyroScale;
+                accel[axis] = record.accel[axis] * format.accelScale;
+            }
+            WriteImuSample(header, record.timestamp, format.temp, gyro, accel);
+        }
+    }
+}
+
+static void PrintDiagnostic(const uint8_t* block)
+{
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    ImuDiagnostic_Header_t record;
+
+    for (uint32_t pos = 0; pos + sizeof(record) <= footer->size; pos += record.size) {
+        memcpy(&record, body + pos, sizeof(record));
+        if (record.size < sizeof(record) || pos + record.size > footer->size) {
+            break;
+        }
+        if (record.type == ImuDiagnostic_Type_STATISTICS
+            && record.size >= offsetof(ImuDiagnostic_Statistics_t, jitterStdUs)) {
+            /** @note Jitter の無い古い Record も読む． */
+            ImuDiagnostic_Statistics_t stats = { 0 };
+
+            memcpy(&stats, body + pos, record.size < sizeof(stats) ? record.size : sizeof(stats));
+            printf("stats device:%u time:%llu seqId:%u rate:%u watermark:%u wakeups:%u samples:%u (%.2f/wakeup) "
+                "overflows:%u missed:%u timeouts:%u jitter std:%uus max:%uus\n",
+                record.device, (unsigned long long) stats.time, stats.seqId, stats.sampleRate, stats.fifoThreshold,
+                stats.wakeupCount, stats.sampleCount,
+                stats.wakeupCount ? (double) stats.sampleCount / stats.wakeupCount : 0.0,
+                stats.overflowCount, stats.missedSamples, stats.timeoutCount, stats.jitterStdUs, stats.jitterMaxUs);
+        } else if (record.type == ImuDiagnostic_Type_GAP && record.size >= sizeof(ImuDiagnostic_Gap_t)) {
+            ImuDiagnostic_Gap_t gap;
+
+            memcpy(&gap, body + pos, sizeof(gap));
+            printf("gap device:%u time:%llu seqId:%u index:%u timestamp:%u..%u missed:%u\n",
+                record.device, (unsigned long long) gap.time, gap.seqId, gap.sampleIndex, gap.prevTimestamp, gap.nextTimestamp,
+                gap.missedSamples);
+        } else if (record.type == ImuDiagnostic_Type_DISCARD && record.size >= sizeof(ImuDiagnostic_Discard_t)) {
+            ImuDiagnostic_Discard_t discard;
+
+            memcpy(&discard, body + pos, sizeof(discard));
+            printf("discard device:%u time:%llu seqId:%u timestamp:%u..%u samples:%u\n",
+                record.device, (unsigned long long) discard.time, discard.seqId, discard.firstTimestamp, discard.lastTimestamp,
+                discard.discardedSamples);
+        } else if (record.type == ImuDiagnostic_Type_TIMEOUT && record.size >= sizeof(ImuDiagnostic_Timeout_t)) {
+            ImuDiagnostic_Timeout_t timeout;
+
+            memcpy(&timeout, body + pos, sizeof(timeout));
+            printf("timeout device:%u time:%llu seqId:%u last timestamp:%u after %ums\n",
+                record.device, (unsigned long long) timeout.time, timeout.seqId, timeout.lastTimestamp, timeout.timeoutMs);
+        } else if (record.type == ImuDiagnostic_Type_SUMMARY && record.size >= sizeof(ImuDiagnostic_Summary_t)) {
+            ImuDiagnostic_Summary_t summary;
+
+            memcpy(&summary, body + pos, sizeof(summary));
+            printf("summary device:%u time:%llu seqId:%u timestamp:%u samples:%u accel:%.3f/%.3f/%.3f gyro max:%.3f "
+                "triggers:%u%s\n",
+                record.device, (unsigned long long) summary.time, summary.seqId, summary.firstTimestamp, summary.sampleCount,
+                summary.accelMin, summary.accelMean, summary.accelMax, summary.gyroMax, summary.triggerCount,
+                summary.isCapturing ? " capturing" : "");
+        }
+    }
+}
+
+static void PrintTrace(const uint8_t* block)
+{
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    Common_TraceRecord_t record;
+    char text[256];
+
+    if (header->recordSize != sizeof(record)) {
+        return;
+    }
+    for (uint32_t pos = 0; pos + sizeof(record) <= footer->size; pos += sizeof(record)) {
+        memcpy(&record, body + pos, sizeof(record));
+        Common_Trace_Format(&record, text, sizeof(text));
+        printf("trace time:%llu cpu:%u dropped:%u %s\n", (unsigned long long) record.time, record.cpu, record.dropped,
+            text);
+    }
+}
+
+static void PrintSync(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    GnssSync_Record_t record;
+
+    if (header->recordSize != sizeof(record)) {
+        return;
+    }
+    for (uint32_t pos = 0; pos + sizeof(record) <= footer->size; pos += sizeof(record)) {
+        memcpy(&record, body + pos, sizeof(record));
+        printf("sync rtc:%llu gps:%lld.%09lld drift:%.3fppm rms:%uns pairs:%u rejected:%u%s\n",
+            (unsigned long long) record.rtc, (long long) (record.gpsTimeNs / 1000000000),
+            (long long) (record.gpsTimeNs % 1000000000), record.driftPpm, record.rmsNs,
+            record.pairCount, record.rejectCount, (record.flags & GNSS_SYNC_FLAG_RESET) ? " reset" : "");
+        self->syncRecord    = record;
+        self->hasSyncRecord = true;
+    }
+}
+
+/**
+ * @brief Block の時刻を直前の推定で GPS 時刻に換算して表示する
+ */
+static void PrintSyncTime(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+
+    if (!self->hasSyncRecord) {
+        return;
+    }
+    int64_t gpsNs = GnssSync_ToGpsNs(&self->syncRecord, header->time);
+    printf("block user:%u seqId:%u rtc:%llu gps:%lld.%09lld\n", header->user, header->seqId,
+        (unsigned long long) header->time, (long long) (gpsNs / 1000000000), (long long) (gpsNs % 1000000000));
+}
+
+/**
+ * @brief 差分で符号化した GNSS の Block から元の Record を復元する
+ */
+static void ExportGnss(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    uint8_t record[GNSS_COMPACT_MAX_RECORD_SIZE];
+    uint32_t numRecords;
+
+    int32_t pos = Gnss_Compact_ReadFormat(&self->gnssState, body, footer->size, &numRecords);
+    if (pos < 0) {
+        fprintf(stderr, "Invalid GNSS format: seqId=%u\n", header->seqId);
+        self->stats.gnssErrorCount++;
+        return;
+    }
+    for (uint32_t i = 0; i < numRecords; ++i) {
+        int32_t length = Gnss_Compact_DecodeRecord(&self->gnssState, body + pos, footer->size - pos, record);
+        if (length < 0) {
+            fprintf(stderr, "Invalid GNSS record: seqId=%u index=%u\n", header->seqId, i);
+            self->stats.gnssErrorCount++;
+            return;
+        }
+        pos += length;
+        fwrite(record, 1, self->gnssState.recordSize, self->gnssOutput);
+        self->stats.gnssRecordCount++;
+        self->stats.gnssRawBytes += self->gnssState.recordSize;
+    }
+    self->stats.gnssEncodedBytes += footer->size;
+}
+
+static void EmitBlock(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+
+    if (self->isBenchmark && header->recordSize != 0) {
+        Benchmark(block);
+    }
+    if (self->imuOutput != NULL) {
+        ExportImu(block);
+    }
+    if (self->isDiagnostic && header->user == LoggingUser_IMU_DIAGNOSTIC) {
+        PrintDiagnostic(block);
+    }
+    if (self->gnssOutput != NULL && header->user == LoggingUser_GNSS_COMPACT) {
+        ExportGnss(block);
+    }
+    if (self->isTrace && header->user == LoggingUser_TRACE) {
+        PrintTrace(block);
+    }
+    if (self->isSync) {
+        if (header->user == LoggingUser_SYNCHRONIZE) {
+            PrintSync(block);
+        } else {
+            PrintSyncTime(block);
+        }
+    }
+    if (self->output != NULL) {
+        fwrite(block, 1, header->size, self->output);
+    }
+}
+
+/**
+ * @brief 先頭の Frame を 1 つ復号する
+ *
+ * @return 消費したバイト数，データが足りない場合は 0，不正な場合は -1
+ */
+static int32_t DecodeFrame(const uint8_t* src, uint32_t size)
+{
+    LogDecode_t* self = GetInstance();
+    LogCodecFrame_t frame;
+    Logging_Codec_State_t codec;
+
+    if (size < sizeof(frame)) {
+        return 0;
+    }
+    memcpy(&frame, src, sizeof(frame));
+    if (frame.header.size < sizeof(LogHeader_t) + sizeof(LogFooter_t)
+        || frame.footer.size > frame.header.size - sizeof(LogHeader_t) - sizeof(LogFooter_t)
+        || !Logging_Codec_Reset(&codec, frame.header.recordSize)) {
+        return -1;
+    }
+
+    uint8_t* block      = calloc(1, frame.header.size);
+    uint8_t* body       = block + sizeof(LogHeader_t);
+    uint32_t recordSize = frame.header.recordSize;
+    uint32_t tail       = frame.footer.size % recordSize;
+    uint32_t consumed   = sizeof(frame);
+
+    memcpy(block, &frame.header, sizeof(LogHeader_t));
+    memcpy(block + frame.header.size - sizeof(LogFooter_t), &frame.footer, sizeof(LogFooter_t));
+    for (uint32_t pos = 0; pos + recordSize <= frame.footer.size; pos += recordSize) {
+        int32_t length = Logging_Codec_DecodeRecord(&codec, src + consumed, size - consumed, body + pos);
+        if (length < 0) {
+            free(block);
+            return 0;
+        }
+        consumed += length;
+    }
+    if (consumed + tail > size) {
+        free(block);
+        return 0;
+    }
+    memcpy(body + frame.footer.size - tail, src + consumed, tail);
+    consumed += tail;
+
+    self->stats.frameCount++;
+    if (!VerifyCrc(block)) {
+        fprintf(stderr, "CRC mismatch in frame: user=%u seqId=%u\n", frame.header.user, frame.header.seqId);
+        self->stats.crcErrorCount++;
+    }
+    EmitBlock(block);
+    free(block);
+
+    return consumed;
+}
+
+static void AppendStream(const uint8_t* data, uint32_t size)
+{
+    LogDecode_t* self = GetInstance();
+
+    if (self->streamSize + size > self->streamCapacity) {
+        self->streamCapacity = (self->streamSize + size) * 2;
+        self->stream         = realloc(self->stream, self->streamCapacity);
+    }
+    memcpy(self->stream + self->streamSize, data, size);
+    self->streamSize += size;
+}
+
+/**
+ * @brief 圧縮 Block の Body を Codec stream に繋ぎ，揃った Frame を展開する
+ *
+ * @note seqId が飛んだ場合は途中の Frame を捨て，この Block の先頭 Frame から再開する．
+ */
+static void HandleContainer(const uint8_t* block)
+{
+    LogDecode_t* self         = GetInstance();
+    const LogHeader_t* header = (const LogHeader_t *) block;
+    const LogFooter_t* footer = (const LogFooter_t *) (block + header->size - sizeof(LogFooter_t));
+    const uint8_t* body       = block + sizeof(LogHeader_t);
+    uint32_t frameOffset;
+
+    if (footer->size < sizeof(frameOffset)) {
+        return;
+    }
+    memcpy(&frameOffset, body, sizeof(frameOffset));
+    body += sizeof(frameOffset);
+    uint32_t size = footer->size - sizeof(frameOffset);
+
+    self->stats.containerCount++;
+    if (self->hasContainer && header->seqId != self->nextContainerSeqId) {
+        fprintf(stderr, "Container gap: expected %u, got %u\n", self->nextContainerSeqId, header->seqId);
+        self->stats.containerGapCount++;
+        self->streamSize = 0;
+        if (frameOffset == LOG_CODEC_NO_FRAME || frameOffset > size) {
+            self->nextContainerSeqId = (header->seqId + 1) & 0xFFFFFF;
+            return;
+        }
+        body += frameOffset;
+        size -= frameOffset;
+    }
+    self->hasContainer       = true;
+    self->nextContainerSeqId = (header->seqId + 1) & 0xFFFFFF;
+
+    AppendStream(body, size);
+
+    uint32_t pos = 0;
+    while (pos < self->streamSize) {
+        int32_t length = DecodeFrame(self->stream + pos, self->streamSize - pos);
+        if (length == 0) {
+            break;
+        } else if (length < 0) {
+            fprintf(stderr, "Invalid frame in container %u\n", header->seqId);
+            self->stats.frameErrorCount++;
+            pos = self->streamSize;
+            break;
+        }
+        pos += length;
+    }
+    memmove(self->stream, self->stream + pos, self->streamSize - pos);
+    self->streamSize -= pos;
+}
+
+static void PrintStatistics(void)
+{
+    LogDecode_t* self = GetInstance();
+    LogDecode_Statistics_t* stats = &self->stats;
+
+    printf("blocks:%u crc errors:%u containers:%u gaps:%u frames:%u frame errors:%u\n",
+        stats->blockCount, stats->crcErrorCount, stats->containerCount, stats->containerGapCount,
+        stats->frameCount, stats->frameErrorCount);
+    if (self->imuOutput != NULL) {
+        printf("imu samples:%u\n", stats->imuSampleCount);
+    }
+    if (self->gnssOutput != NULL) {
+        printf("gnss records:%u errors:%u raw:%llu encoded:%llu (%.1f bytes/record, ratio:%.1f%%)\n",
+            stats->gnssRecordCount, stats->gnssErrorCount, (unsigned long long) stats->gnssRawBytes,
+            (unsigned long long) stats->gnssEncodedBytes,
+            stats->gnssRecordCount ? (double) stats->gnssEncodedBytes / stats->gnssRecordCount : 0.0,
+            stats->gnssRawBytes ? 100.0 * stats->gnssEncodedBytes / stats->gnssRawBytes : 0.0);
+    }
+    if (self->streamSize > 0) {
+        printf("Incomplete frame at end of stream: %u bytes\n", self->streamSize);
+    }
+    if (self->isBenchmark && stats->benchRawBytes > 0) {
+        printf("codec raw:%llu encoded:%llu ratio:%.1f%% encode:%.1fMB/s decode:%.1fMB/s\n",
+            (unsigned long long) stats->benchRawBytes, (unsigned long long) stats->benchEncodedBytes,
+            100.0 * stats->benchEncodedBytes / stats->benchRawBytes,
+            stats->benchRawBytes / 1048576.0 / stats->benchEncodeSec,
+            stats->benchRawBytes / 1048576.0 / stats->benchDecodeSec);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    LogDecode_t* self = GetInstance();
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        if (strcmp(argv[arg], "-b") == 0) {
+            self->isBenchmark = true;
+        } else if (strcmp(argv[arg], "-d") == 0) {
+            self->isDiagnostic = true;
+        } else if (strcmp(argv[arg], "-t") == 0) {
+            self->isTrace = true;
+        } else if (strcmp(argv[arg], "-s") == 0) {
+            self->isSync = true;
+        } else if (strcmp(argv[arg], "-u") == 0 && arg + 1 < argc) {
+            self->imuOutput = fopen(argv[++arg], "w");
+            if (self->imuOutput == NULL) {
+                perror(argv[arg]);
+                return 1;
+            }
+            fprintf(self->imuOutput, "user,device,timestamp,temp,gx,gy,gz,ax,ay,az\n");
+        } else if (strcmp(argv[arg], "-g") == 0 && arg + 1 < argc) {
+            self->gnssOutput = fopen(argv[++arg], "wb");
+            if (self->gnssOutput == NULL) {
+                perror(argv[arg]);
+                return 1;
+            }
+        } else {
+            break;
+        }
+    }
+    if (arg >= argc || argv[arg][0] == '-') {
+        fprintf(stderr, "Usage: %s [-b] [-d] [-t] [-s] [-u imu.csv] [-g gnss.bin] <input> [output]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* input = fopen(argv[arg], "rb");
+    if (input == NULL) {
+        perror(argv[arg]);
+        return 1;
+    }
+    if (arg + 1 < argc) {
+        self->output = fopen(argv[arg + 1], "wb");
+        if (self->output == NULL) {
+            perror(argv[arg + 1]);
+            return 1;
+        }
+    }
+
+    Logging_Crc_Init();
+
+    LogHeader_t header;
+    while (fread(&header, sizeof(header), 1, input) == 1) {
+        /** @note 事前確保の残りや末尾の 0 埋めに達したら終了する． */
+        if (header.size < sizeof(LogHeader_t) + sizeof(LogFooter_t)) {
+            break;
+        }
+
+        uint8_t* block = malloc(header.size);
+        memcpy(block, &header, sizeof(header));
+        if (fread(block + sizeof(header), header.size - sizeof(header), 1, input) != 1) {
+            fprintf(stderr, "Truncated block: user=%u seqId=%u\n", header.user, header.seqId);
+            free(block);
+            break;
+        }
+
+        self->stats.blockCount++;
+        if (!VerifyCrc(block)) {
+            fprintf(stderr, "CRC mismatch: user=%u seqId=%u\n", header.user, header.seqId);
+            self->stats.crcErrorCount++;
+        } else if (header.flags & LOG_HEADER_FLAG_COMPRESSED) {
+            HandleContainer(block);
+        } else {
+            EmitBlock(block);
+        }
+        free(block);
+    }
+
+    PrintStatistics();
+
+    fclose(input);
+    if (self->output != NULL) {
+        fclose(self->output);
+    }
+    if (self->imuOutput != NULL) {
+        fclose(self->imuOutput);
+    }
+    if (self->gnssOutput != NULL) {
+        fclose(self->gnssOutput);
+    }
+    free(self->stream);
+
+    return self->stats.crcErrorCount || self->stats.frameErrorCount || self->stats.gnssErrorCount ? 1 : 0;
+} /* main */
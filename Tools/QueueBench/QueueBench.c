@@ -0,0 +1,312 @@
+/**
+ * @file QueueBench.c
+ * @brief Logging タスクの Descriptor queue をホスト上で POSIX mq と比較し，複数 Producer での整合性を検証するツール
+ *
+ * @note ビルド:
+ *       gcc -O2 -D_GNU_SOURCE -DOK=0 -DERROR=-1 -I../../Logging -I../../Logging/include -I../../Common/include \
+ *           -o queuebench QueueBench.c ../../Logging/Logging.c -lpthread -lrt
+ *
+ *       OK/ERROR は NuttX が定義するため，ホストではコマンドラインで与える．
+ *
+ *       使い方:
+ *       queuebench [count] [producers] [slow]
+ *         producers 個のスレッドがそれぞれ count 個の WRITE と END を送り，1 つの Consumer が受け取る．
+ *         Producer 毎に user を変え (IMU, GNSS, POWER の順)，全ての優先度クラスを使う．
+ *         Logging_SendQueue と mq_send (mq は Linux の既定の上限の 10 件) のそれぞれで，
+ *         1 秒あたりの Descriptor 数と，1 回の送信にかかった時間 (平均，p99，最大) を表示する．
+ *         送信時間は呼び出し毎に clock_gettime で測るため，その分 (数十 ns) を含む．
+ *         Logging queue では Producer 毎に送った順に届くこと，WRITE の callback が丁度 1 回呼ばれるか，
+ *         送信が ERROR を返すかのいずれかであること，全ての END が届くことを確認する．
+ *         slow を指定すると Consumer が一定間隔で止まり，Queue が満杯の場合の待ち合わせを検証する．
+ *         検証に失敗した場合は 1 を返す．
+ */
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Common_Rtc.h"
+#include "Logging.h"
+#include "Logging_public.h"
+
+#define DEFAULT_COUNT     (200000)
+#define DEFAULT_PRODUCERS (3)
+#define MAX_PRODUCERS     (8)
+#define SLOW_INTERVAL     (256)  /* Receives between consumer stalls in slow mode */
+#define SLOW_STALL_US     (2000)
+#define MQ_NAME           "/queuebench"
+#define MQ_MAX_MSGS       (10)
+
+/** @note ptr に Producer 番号と通し番号を詰める．Buffer は使わない． */
+#define MAKE_TOKEN(producer, seq) ((void*) (((uintptr_t) (producer) << 32) | (uintptr_t) (seq) | 1ULL << 60))
+#define TOKEN_PRODUCER(ptr)       ((uint32_t) (((uintptr_t) (ptr) >> 32) & 0xFFFF))
+#define TOKEN_SEQ(ptr)            ((uint32_t) (uintptr_t) (ptr))
+
+typedef struct tagQueueBench_Producer_t {
+    uint32_t    index;
+    atomic_uint callbackCount;
+    uint32_t    errorCount;  /* WRITEs returned by Logging_SendQueue */
+    uint32_t    nextSeq;     /* Consumer side: next sequence number expected */
+    uint32_t    reordered;
+    uint32_t*   sendNs;      /* Time of each send call */
+} QueueBench_Producer_t;
+
+typedef struct tagQueueBench_t {
+    uint32_t              count;
+    uint32_t              numProducers;
+    bool                  isSlow;
+    LoggingQueue_t        queue;
+    mqd_t                 mq;
+    QueueBench_Producer_t producers[MAX_PRODUCERS];
+    uint32_t              endCount;
+} QueueBench_t;
+
+static QueueBench_t queueBench_instance;
+
+static const LoggingUser_e queueBench_users[] = { LoggingUser_IMU, LoggingUser_GNSS, LoggingUser_POWER };
+
+static QueueBench_t* GetInstance(void)
+{
+    return &queueBench_instance;
+}
+
+static double GetTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t GetTimeNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** @note Logging.c が時刻と期限に使う RTC (32768Hz) の代わり */
+uint64_t Common_Rtc_GetCount(Common_RtcChannel_e channel)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 32768 + (uint64_t) ts.tv_nsec * 32768 / 1000000000;
+}
+
+static void Callback(void* ptr)
+{
+    QueueBench_t* self = GetInstance();
+
+    atomic_fetch_add_explicit(&self->producers[TOKEN_PRODUCER(ptr)].callbackCount, 1, memory_order_relaxed);
+}
+
+static void* ProduceQueue(void* arg)
+{
+    QueueBench_t* self               = GetInstance();
+    QueueBench_Producer_t* producer = arg;
+    LoggingQueue_t queue            = Logging_OpenQueue(true);
+    LoggingDesc_t desc              = { 0 };
+
+    desc.type     = LoggingType_WRITE;
+    desc.user     = queueBench_users[producer->index % (sizeof(queueBench_users) / sizeof(queueBench_users[0]))];
+    desc.size     = 1;
+    desc.callback = Callback;
+    for (uint32_t seq = 0; seq < self->count; ++seq) {
+        desc.ptr = MAKE_TOKEN(producer->index, seq);
+        uint64_t start = GetTimeNs();
+        int ret        = Logging_SendQueue(queue, &desc);
+        producer->sendNs[seq] = (uint32_t) (GetTimeNs() - start);
+        if (ret != OK) {
+            producer->errorCount++;
+        }
+    }
+    LoggingDesc_t end = { 0 };
+    end.type = LoggingType_END;
+    Logging_SendQueue(queue, &end);
+    Logging_CloseQueue(queue);
+    return NULL;
+}
+
+static void ConsumeQueue(QueueBench_t* self)
+{
+    LoggingDesc_t desc;
+    uint32_t received = 0;
+
+    while (self->endCount < self->numProducers) {
+        if (Logging_ReceiveQueue(self->queue, &desc) != OK) {
+            break;
+        }
+        if (desc.type == LoggingType_END) {
+            self->endCount++;
+            Logging_DecrementOpenCount();
+            continue;
+        }
+        QueueBench_Producer_t* producer = &self->producers[TOKEN_PRODUCER(desc.ptr)];
+        uint32_t seq = TOKEN_SEQ(desc.ptr);
+        if (seq < producer->nextSeq) {
+            producer->reordered++;
+        }
+        producer->nextSeq = seq + 1;
+        desc.callback(desc.ptr);
+        if (self->isSlow && ++received % SLOW_INTERVAL == 0) {
+            usleep(SLOW_STALL_US);
+        }
+    }
+}
+
+static void* ProduceMq(void* arg)
+{
+    QueueBench_t* self               = GetInstance();
+    QueueBench_Producer_t* producer = arg;
+    LoggingDesc_t desc              = { 0 };
+
+    desc.type = LoggingType_WRITE;
+    desc.size = 1;
+    for (uint32_t seq = 0; seq < self->count; ++seq) {
+        desc.ptr = MAKE_TOKEN(producer->index, seq);
+        uint64_t start = GetTimeNs();
+        mq_send(self->mq, (const char *) &desc, sizeof(desc), 0);
+        producer->sendNs[seq] = (uint32_t) (GetTimeNs() - start);
+    }
+    desc.type = LoggingType_END;
+    mq_send(self->mq, (const char *) &desc, sizeof(desc), 0);
+    return NULL;
+}
+
+static void ConsumeMq(QueueBench_t* self)
+{
+    LoggingDesc_t desc;
+    uint32_t ends     = 0;
+    uint32_t received = 0;
+
+    while (ends < self->numProducers) {
+        if (mq_receive(self->mq, (char *) &desc, sizeof(desc), NULL) != sizeof(desc)) {
+            perror("mq_receive");
+            break;
+        }
+        if (desc.type == LoggingType_END) {
+            ends++;
+        } else if (self->isSlow && ++received % SLOW_INTERVAL == 0) {
+            usleep(SLOW_STALL_US);
+        }
+    }
+}
+
+static int CompareU32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief 全 Producer の送信時間をまとめて平均，p99，最大を表示する
+ */
+static void PrintSendLatency(QueueBench_t* self, const char* name)
+{
+    uint64_t total = (uint64_t) self->count * self->numProducers;
+    uint32_t* all  = malloc(total * sizeof(uint32_t));
+    uint64_t sum   = 0;
+
+    if (all == NULL || total == 0) {
+        free(all);
+        return;
+    }
+    for (uint32_t i = 0; i < self->numProducers; ++i) {
+        memcpy(all + (uint64_t) i * self->count, self->producers[i].sendNs, self->count * sizeof(uint32_t));
+    }
+    qsort(all, total, sizeof(uint32_t), CompareU32);
+    for (uint64_t i = 0; i < total; ++i) {
+        sum += all[i];
+    }
+    printf("  %s send: avg %.3fus p99 %.3fus max %.3fus\n", name, sum / (double) total * 1e-3,
+        all[total * 99 / 100] * 1e-3, all[total - 1] * 1e-3);
+    free(all);
+}
+
+static double Run(QueueBench_t* self, void* (*produce)(void*), void (*consume)(QueueBench_t*))
+{
+    pthread_t threads[MAX_PRODUCERS];
+    double start = GetTimeSec();
+
+    for (uint32_t i = 0; i < self->numProducers; ++i) {
+        pthread_create(&threads[i], NULL, produce, &self->producers[i]);
+    }
+    consume(self);
+    for (uint32_t i = 0; i < self->numProducers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    return GetTimeSec() - start;
+}
+
+int main(int argc, char* argv[])
+{
+    QueueBench_t* self = GetInstance();
+
+    self->count        = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_COUNT;
+    self->numProducers = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_PRODUCERS;
+    self->isSlow       = argc > 3 && strcmp(argv[3], "slow") == 0;
+    if (self->numProducers == 0 || self->numProducers > MAX_PRODUCERS) {
+        fprintf(stderr, "producers must be 1 to %u\n", MAX_PRODUCERS);
+        return 1;
+    }
+    for (uint32_t i = 0; i < self->numProducers; ++i) {
+        self->producers[i].index  = i;
+        self->producers[i].sendNs = calloc(self->count ? self->count : 1, sizeof(uint32_t));
+        if (self->producers[i].sendNs == NULL) {
+            fprintf(stderr, "Failed to allocate latency buffers\n");
+            return 1;
+        }
+    }
+    uint64_t total = (uint64_t) self->count * self->numProducers;
+
+    self->queue = Logging_CreateQueue();
+    double queueSec = Run(self, ProduceQueue, ConsumeQueue);
+
+    bool isOk = self->endCount == self->numProducers;
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < self->numProducers; ++i) {
+        QueueBench_Producer_t* producer = &self->producers[i];
+        uint32_t callbacks = atomic_load(&producer->callbackCount);
+        errors += producer->errorCount;
+        isOk   &= producer->reordered == 0 && callbacks + producer->errorCount == self->count;
+    }
+
+    Logging_QueueStatistics_t stats;
+    Logging_GetQueueStatistics(self->queue, &stats);
+    printf("logging queue: %.2f Mdesc/s errors:%u consumer waits:%u\n", total / queueSec * 1e-6, errors,
+        stats.waitCount);
+    for (int priority = 0; priority < LoggingPriority_NUM; ++priority) {
+        Logging_QueueClassStatistics_t* cls = &stats.classes[priority];
+        printf("  class %d sent:%u received:%u full:%u timeout:%u max depth:%u overdue:%u max latency:%lluus\n",
+            priority, cls->sendCount, cls->receiveCount, cls->fullCount, cls->timeoutCount, cls->maxDepth,
+            cls->overdueCount, (unsigned long long) (cls->maxLatency * 1000000 / 32768));
+    }
+    PrintSendLatency(self, "logging queue");
+
+    struct mq_attr attr = { .mq_maxmsg = MQ_MAX_MSGS, .mq_msgsize = sizeof(LoggingDesc_t) };
+    mq_unlink(MQ_NAME);
+    self->mq = mq_open(MQ_NAME, O_CREAT | O_RDWR, 0600, &attr);
+    if (self->mq == (mqd_t) -1) {
+        perror("mq_open");
+    } else {
+        double mqSec = Run(self, ProduceMq, ConsumeMq);
+        printf("posix mq:      %.2f Mdesc/s (%.1fx)\n", total / mqSec * 1e-6, mqSec / queueSec);
+        PrintSendLatency(self, "posix mq");
+        mq_close(self->mq);
+        mq_unlink(MQ_NAME);
+    }
+
+    printf("%s\n", isOk ? "OK" : "NG");
+    return isOk ? 0 : 1;
+} /* main */
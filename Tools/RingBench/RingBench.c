@@ -0,0 +1,168 @@
+/**
+ * @file RingBench.c
+ * @brief Common_Ring を書き込みと読み出しの 2 スレッドでホスト上で検証し，速度を計測するツール
+ *
+ * @note ビルド:
+ *       gcc -O2 -D_GNU_SOURCE -I../../Common/include -o ringbench RingBench.c ../../Common/Common_Ring.c -lpthread
+ *
+ *       使い方:
+ *       ringbench [count] [slots] [drop]
+ *         書き込みスレッドは通し番号を持つ要素を count 個書き込む．満杯の場合は空くまで再試行する．
+ *         drop を指定すると，割り込みハンドラと同じく満杯の要素を捨てて次の番号へ進む．
+ *         読み出しスレッドは Common_Ring_Wait() で待ち，番号が増え続けること，要素が途中で壊れていないこと，
+ *         番号の飛びの合計が捨てた数 (drop 以外では 0) と一致することを確認する．
+ *         ARM 等の弱いメモリモデルの CPU で実行すると，順序付けの誤りを検出しやすい．
+ *         検証に失敗した場合は 1 を返す．
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Common_Ring.h"
+
+#define DEFAULT_COUNT (10000000)
+#define DEFAULT_SLOTS (32)
+#define MAX_SLOTS     (65536)
+#define PAYLOAD_WORDS (5)
+
+/** @note 全ての語が seq から決まる．Slot を読む途中で上書きされると一致しなくなる． */
+typedef struct tagRingBench_Element_t {
+    uint32_t seq;
+    uint32_t payload[PAYLOAD_WORDS];
+} RingBench_Element_t;
+
+typedef struct tagRingBench_t {
+    Common_Ring_t       ring;
+    RingBench_Element_t slots[MAX_SLOTS];
+    uint32_t            count;
+    bool                isDrop;
+    atomic_bool         isDone;
+    uint32_t            received;
+    uint32_t            skipped;  /* Sequence numbers missing at the consumer */
+    uint32_t            corrupted;
+    uint32_t            reordered;
+    uint32_t            emptyWakeups;
+} RingBench_t;
+
+static RingBench_t ringBench_instance;
+
+static RingBench_t* GetInstance(void)
+{
+    return &ringBench_instance;
+}
+
+static double GetTimeSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t MakePayload(uint32_t seq, uint32_t index)
+{
+    return (seq ^ 0x9e3779b9u) * (index * 2 + 1);
+}
+
+static void* Produce(void* arg)
+{
+    RingBench_t* self = arg;
+    RingBench_Element_t element;
+
+    for (uint32_t seq = 0; seq < self->count; ++seq) {
+        element.seq = seq;
+        for (uint32_t i = 0; i < PAYLOAD_WORDS; ++i) {
+            element.payload[i] = MakePayload(seq, i);
+        }
+        while (!Common_Ring_Push(&self->ring, &element) && !self->isDrop) {
+            sched_yield();
+        }
+    }
+    atomic_store_explicit(&self->isDone, true, memory_order_release);
+    Common_Ring_Wakeup(&self->ring);
+    return NULL;
+}
+
+static void Check(RingBench_t* self, const RingBench_Element_t* element, int64_t* next)
+{
+    for (uint32_t i = 0; i < PAYLOAD_WORDS; ++i) {
+        if (element->payload[i] != MakePayload(element->seq, i)) {
+            self->corrupted++;
+            break;
+        }
+    }
+    if ((int64_t) element->seq < *next) {
+        self->reordered++;
+        return;
+    }
+    self->skipped += element->seq - *next;
+    *next = (int64_t) element->seq + 1;
+    self->received++;
+}
+
+static void* Consume(void* arg)
+{
+    RingBench_t* self = arg;
+    RingBench_Element_t element;
+    int64_t next = 0;
+
+    /** @note Push 1 回につき 1 つ読み出すため，空で起きるのは書き込み完了の Wakeup のみ． */
+    for (;;) {
+        Common_Ring_Wait(&self->ring, COMMON_RING_WAIT_FOREVER);
+        if (!Common_Ring_Pop(&self->ring, &element)) {
+            self->emptyWakeups++;
+            if (atomic_load_explicit(&self->isDone, memory_order_acquire)) {
+                break;
+            }
+            continue;
+        }
+        Check(self, &element, &next);
+    }
+    /** @note 書き込みの完了後に残っている分を読み出す． */
+    while (Common_Ring_Pop(&self->ring, &element)) {
+        Check(self, &element, &next);
+    }
+    self->skipped += self->count - next;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    RingBench_t* self = GetInstance();
+    uint32_t slots    = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_SLOTS;
+    pthread_t producer;
+    pthread_t consumer;
+
+    self->count  = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_COUNT;
+    self->isDrop = argc > 3 && strcmp(argv[3], "drop") == 0;
+    if (slots > MAX_SLOTS || !Common_Ring_Init(&self->ring, self->slots, sizeof(RingBench_Element_t), slots)) {
+        fprintf(stderr, "slots must be a power of two up to %u\n", MAX_SLOTS);
+        return 1;
+    }
+
+    double start = GetTimeSec();
+    pthread_create(&consumer, NULL, Consume, self);
+    pthread_create(&producer, NULL, Produce, self);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    double elapsed = GetTimeSec() - start;
+
+    Common_Ring_Statistics_t stats;
+    Common_Ring_GetStatistics(&self->ring, &stats);
+    Common_Ring_Destroy(&self->ring);
+
+    uint32_t dropped = self->isDrop ? stats.overflowCount : 0;
+    bool isOk = self->corrupted == 0 && self->reordered == 0 && self->skipped == dropped &&
+        self->received == stats.popCount && stats.pushCount + dropped == self->count;
+    printf("count:%u slots:%u received:%u overflow:%u skipped:%u corrupted:%u reordered:%u empty wakeups:%u\n",
+        self->count, slots, self->received, stats.overflowCount, self->skipped, self->corrupted, self->reordered,
+        self->emptyWakeups);
+    printf("%.1f Mpush/s %s\n", self->count / elapsed * 1e-6, isOk ? "OK" : "NG");
+    return isOk ? 0 : 1;
+} /* main */